@@ -0,0 +1,147 @@
+// XML vs JSON document backends: time to serialize a flat diagram to text and to
+// parse it back into component data, plus the size of the resulting document.
+//
+//   document_format_benchmark [components=200000] [iterations=5]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Diagram/Block.hpp"
+#include "Utils/JSONSerialization.hpp"
+#include "Utils/XMLSerialization.hpp"
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+	using Blocks = std::vector<Diagram::Block::Data>;
+
+	struct Result {
+		double serialize = 1e9;
+		double deserialize = 1e9;
+		std::size_t bytes = 0;
+	};
+
+	Blocks GenerateBlocks(const std::size_t count) {
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> coordinate(-5000.0f, 5000.0f);
+		std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+
+		Blocks blocks(count);
+		for(std::size_t i = 0; i < count; ++i) {
+			auto& data = blocks[i];
+			data.position = {coordinate(random), coordinate(random)};
+			data.size = {10.0f + channel(random) * 40.0f, 5.0f + channel(random) * 20.0f};
+			data.label = "Block " + std::to_string(i);
+			data.type = static_cast<Diagram::Block::Type>(i % 4);
+			data.backgroundColor = {channel(random), channel(random), channel(random), channel(random)};
+		}
+		return blocks;
+	}
+
+	double Seconds(const Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Both passes include producing or parsing the document text, as a save or load does.
+	void RunXml(const Blocks& blocks, Blocks& decoded, Result& result) {
+		auto start = Clock::now();
+		std::string text;
+		{
+			pugi::xml_document doc;
+			auto root = doc.append_child("Diagram").append_child("Root");
+			for(std::size_t i = 0; i < blocks.size(); ++i) {
+				auto componentNode = root.append_child("Component");
+				componentNode.append_attribute("id").set_value(("block_" + std::to_string(i)).c_str());
+				componentNode.append_attribute("type").set_value("Block");
+				XML::auto_serialize(blocks[i], componentNode);
+			}
+			std::ostringstream stream;
+			doc.save(stream, "\t");
+			text = std::move(stream).str();
+		}
+		result.serialize = std::min(result.serialize, Seconds(start));
+		result.bytes = text.size();
+
+		start = Clock::now();
+		pugi::xml_document doc;
+		doc.load_buffer(text.data(), text.size());
+		std::size_t index = 0;
+		for(const auto componentNode: doc.child("Diagram").child("Root").children("Component")) {
+			XML::auto_deserialize(decoded[index++], componentNode);
+		}
+		result.deserialize = std::min(result.deserialize, Seconds(start));
+	}
+
+	void RunJson(const Blocks& blocks, Blocks& decoded, Result& result) {
+		auto start = Clock::now();
+		std::string text;
+		{
+			nlohmann::json doc;
+			auto& components = doc["Diagram"]["Root"]["components"] = nlohmann::json::array();
+			for(std::size_t i = 0; i < blocks.size(); ++i) {
+				nlohmann::json componentNode;
+				componentNode["id"] = "block_" + std::to_string(i);
+				componentNode["type"] = "Block";
+				JSON::auto_serialize(blocks[i], componentNode["data"]);
+				components.push_back(std::move(componentNode));
+			}
+			text = doc.dump(1, '\t');
+		}
+		result.serialize = std::min(result.serialize, Seconds(start));
+		result.bytes = text.size();
+
+		start = Clock::now();
+		const auto doc = nlohmann::json::parse(text);
+		std::size_t index = 0;
+		for(const auto& componentNode: doc["Diagram"]["Root"]["components"]) {
+			JSON::auto_deserialize(decoded[index++], componentNode["data"]);
+		}
+		result.deserialize = std::min(result.deserialize, Seconds(start));
+	}
+
+	bool Matches(const Blocks& blocks, const Blocks& decoded, const char* format) {
+		for(std::size_t i = 0; i < blocks.size(); ++i) {
+			if(decoded[i].label != blocks[i].label || decoded[i].type != blocks[i].type || decoded[i].position != blocks[i].position) {
+				std::fprintf(stderr, "%s round-trip mismatch at component %zu\n", format, i);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Print(const char* format, const std::size_t count, const Result& result) {
+		const double megabytes = static_cast<double>(result.bytes) / (1024.0 * 1024.0);
+		std::printf("%-5s  %7.1f MiB  save %8.2f ms (%10.0f comp/s)  load %8.2f ms (%10.0f comp/s)\n", format, megabytes,
+			result.serialize * 1e3, count / result.serialize, result.deserialize * 1e3, count / result.deserialize);
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	const auto blocks = GenerateBlocks(count);
+	Blocks decodedXml(count);
+	Blocks decodedJson(count);
+	Result xml;
+	Result json;
+
+	for(int iteration = 0; iteration < iterations; ++iteration) {
+		RunXml(blocks, decodedXml, xml);
+		RunJson(blocks, decodedJson, json);
+	}
+
+	if(!Matches(blocks, decodedXml, "XML") || !Matches(blocks, decodedJson, "JSON")) return EXIT_FAILURE;
+
+	std::printf("components: %zu\n", count);
+	Print("XML", count, xml);
+	Print("JSON", count, json);
+	return EXIT_SUCCESS;
+}
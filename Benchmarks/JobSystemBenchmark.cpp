@@ -0,0 +1,111 @@
+// Job system: cost of scheduling a job from outside the pool and from inside it, of a
+// dependency link, and how a parallel-for over a compute-bound loop scales with the
+// number of workers.
+//
+//   job_system_benchmark [jobs=100000] [items=4000000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "Main/JobSystem.hpp"
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	double Seconds(const Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Independent jobs scheduled by the main thread through the shared queue.
+	double ScheduleExternal(JobSystem& jobSystem, const std::size_t count) {
+		std::atomic<std::size_t> done = 0;
+		std::vector<JobSystem::Handle> jobs;
+		jobs.reserve(count);
+		const auto start = Clock::now();
+		for(std::size_t i = 0; i < count; ++i) jobs.push_back(jobSystem.Schedule([&done] { done.fetch_add(1, std::memory_order_relaxed); }));
+		for(const auto& job: jobs) jobSystem.Wait(job);
+		return Seconds(start);
+	}
+
+	// Jobs spawned by a job, onto its worker's own deque, and stolen by the others.
+	double ScheduleInternal(JobSystem& jobSystem, const std::size_t count) {
+		std::atomic<std::size_t> done = 0;
+		const auto start = Clock::now();
+		const auto root = jobSystem.Schedule([&jobSystem, &done, count] {
+			std::vector<JobSystem::Handle> jobs;
+			jobs.reserve(count);
+			for(std::size_t i = 0; i < count; ++i) jobs.push_back(jobSystem.Schedule([&done] { done.fetch_add(1, std::memory_order_relaxed); }));
+			for(const auto& job: jobs) jobSystem.Wait(job);
+		});
+		jobSystem.Wait(root);
+		return Seconds(start);
+	}
+
+	// A chain where each job depends on the one before.
+	double Chain(JobSystem& jobSystem, const std::size_t count) {
+		std::size_t value = 0;
+		const auto start = Clock::now();
+		JobSystem::Handle previous;
+		for(std::size_t i = 0; i < count; ++i) previous = jobSystem.Schedule([&value] { ++value; }, {previous});
+		jobSystem.Wait(previous);
+		const double seconds = Seconds(start);
+		if(value != count) std::fprintf(stderr, "chain ran %zu of %zu jobs\n", value, count);
+		return seconds;
+	}
+
+	double Kernel(const std::size_t begin, const std::size_t end, std::vector<float>& output) {
+		double sum = 0.0;
+		for(std::size_t i = begin; i < end; ++i) {
+			float x = static_cast<float>(i) * 1e-6f;
+			for(int k = 0; k < 16; ++k) x = std::sqrt(x * x + 1.0f) * 0.5f;
+			output[i] = x;
+			sum += x;
+		}
+		return sum;
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t jobCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+	const std::size_t itemCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4000000;
+	const std::size_t maxWorkers = JobSystem::DefaultWorkerCount();
+
+	std::printf("hardware threads: %u, default workers: %zu\n", std::thread::hardware_concurrency(), maxWorkers);
+	{
+		JobSystem jobSystem(maxWorkers);
+		const double external = ScheduleExternal(jobSystem, jobCount);
+		const double internal = ScheduleInternal(jobSystem, jobCount);
+		const double chain = Chain(jobSystem, jobCount);
+		std::printf("schedule from main   %8.0f ns/job\n", external * 1e9 / jobCount);
+		std::printf("schedule from a job  %8.0f ns/job\n", internal * 1e9 / jobCount);
+		std::printf("dependency chain     %8.0f ns/link\n", chain * 1e9 / jobCount);
+	}
+
+	std::vector<float> output(itemCount);
+	auto start = Clock::now();
+	Kernel(0, itemCount, output);
+	const double serial = Seconds(start);
+	std::printf("parallel-for over %zu items, serial %.2f ms\n", itemCount, serial * 1e3);
+
+	// The calling thread takes chunks too, so n workers use n + 1 threads.
+	std::vector<std::size_t> workerCounts {0};
+	for(std::size_t workers = 1; workers < maxWorkers; workers *= 2) workerCounts.push_back(workers);
+	if(maxWorkers > 0) workerCounts.push_back(maxWorkers);
+	for(const std::size_t workers: workerCounts) {
+		JobSystem jobSystem(workers);
+		double best = 1e9;
+		for(int iteration = 0; iteration < 3; ++iteration) {
+			start = Clock::now();
+			jobSystem.ParallelFor(itemCount, 16384, [&output](const std::size_t begin, const std::size_t end) { Kernel(begin, end, output); });
+			best = std::min(best, Seconds(start));
+		}
+		std::printf("  %2zu workers  %8.2f ms  speedup %5.2fx\n", workers, best * 1e3, serial / best);
+	}
+	return EXIT_SUCCESS;
+}
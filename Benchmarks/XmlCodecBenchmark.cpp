@@ -0,0 +1,89 @@
+// Serialize/deserialize throughput of the reflection-driven XML codec.
+//
+//   xml_codec_benchmark [components=200000] [iterations=5]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Diagram/Block.hpp"
+#include "Diagram/Camera.hpp"
+#include "Utils/XMLSerialization.hpp"
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<Diagram::Block::Data> GenerateBlocks(const std::size_t count) {
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> coordinate(-5000.0f, 5000.0f);
+		std::uniform_real_distribution<float> channel(0.0f, 1.0f);
+
+		std::vector<Diagram::Block::Data> blocks(count);
+		for(std::size_t i = 0; i < count; ++i) {
+			auto& data = blocks[i];
+			data.position = {coordinate(random), coordinate(random)};
+			data.size = {10.0f + channel(random) * 40.0f, 5.0f + channel(random) * 20.0f};
+			data.label = "Block " + std::to_string(i);
+			data.type = static_cast<Diagram::Block::Type>(i % 4);
+			data.backgroundColor = {channel(random), channel(random), channel(random), channel(random)};
+		}
+		return blocks;
+	}
+
+	double Seconds(const Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	const int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	const auto blocks = GenerateBlocks(count);
+	std::vector<Diagram::Block::Data> decoded(count);
+
+	double bestSerialize = 1e9;
+	double bestDeserialize = 1e9;
+	std::size_t documentBytes = 0;
+
+	for(int iteration = 0; iteration < iterations; ++iteration) {
+		pugi::xml_document doc;
+		auto root = doc.append_child("Root");
+
+		auto start = Clock::now();
+		for(const auto& data: blocks) {
+			auto componentNode = root.append_child("Component");
+			XML::auto_serialize(data, componentNode);
+		}
+		bestSerialize = std::min(bestSerialize, Seconds(start));
+
+		std::ostringstream stream;
+		doc.save(stream);
+		documentBytes = stream.str().size();
+
+		start = Clock::now();
+		std::size_t index = 0;
+		for(auto componentNode = root.first_child(); componentNode; componentNode = componentNode.next_sibling()) {
+			XML::auto_deserialize(decoded[index++], componentNode);
+		}
+		bestDeserialize = std::min(bestDeserialize, Seconds(start));
+	}
+
+	for(std::size_t i = 0; i < count; ++i) {
+		if(decoded[i].label != blocks[i].label || decoded[i].type != blocks[i].type || decoded[i].position != blocks[i].position) {
+			std::fprintf(stderr, "Round-trip mismatch at component %zu\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	const double megabytes = static_cast<double>(documentBytes) / (1024.0 * 1024.0);
+	std::printf("components:   %zu (%.1f MiB of XML)\n", count, megabytes);
+	std::printf("serialize:    %8.2f ms  %10.0f comp/s  %8.1f MiB/s\n", bestSerialize * 1e3, count / bestSerialize, megabytes / bestSerialize);
+	std::printf("deserialize:  %8.2f ms  %10.0f comp/s  %8.1f MiB/s\n", bestDeserialize * 1e3, count / bestDeserialize, megabytes / bestDeserialize);
+	return EXIT_SUCCESS;
+}
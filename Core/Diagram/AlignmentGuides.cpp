@@ -0,0 +1,172 @@
+#include "AlignmentGuides.hpp"
+#include "Block.hpp"
+#include "Camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diagram {
+    namespace {
+        // Values this close count as aligned when collecting guides after a snap.
+        constexpr float ALIGNED_EPSILON = 1e-3f;
+        constexpr float TICK_SIZE = 4.0f;
+
+        template<typename Entries>
+        auto LowerBound(Entries& entries, const float value) {
+            return std::ranges::lower_bound(entries, value, std::less<>{}, [](const auto& entry) { return entry.value; });
+        }
+    }
+
+    void AlignmentGuides::Begin(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const Block& dragged) {
+        for (auto& entries : m_entries) entries.clear();
+        m_guides.clear();
+        for (const auto& component : componentList) {
+            const auto* block = dynamic_cast<const Block*>(component.get());
+            if (!block || block == &dragged) continue;
+            const glm::vec2 corner = block->data.position + block->data.size;
+            const glm::vec2 min{std::min(block->data.position.x, corner.x), std::min(block->data.position.y, corner.y)};
+            const glm::vec2 max{std::max(block->data.position.x, corner.x), std::max(block->data.position.y, corner.y)};
+            for (int axis = 0; axis < 2; ++axis) {
+                m_entries[axis].push_back({min[axis], Kind::Min, min, max});
+                m_entries[axis].push_back({(min[axis] + max[axis]) * 0.5f, Kind::Center, min, max});
+                m_entries[axis].push_back({max[axis], Kind::Max, min, max});
+            }
+        }
+        for (auto& entries : m_entries) std::ranges::sort(entries, {}, &Entry::value);
+        m_isActive = true;
+    }
+
+    void AlignmentGuides::End() noexcept {
+        for (auto& entries : m_entries) entries.clear();
+        m_guides.clear();
+        m_isActive = false;
+    }
+
+    AlignmentGuides::Snap AlignmentGuides::Apply(glm::vec2 position, const glm::vec2 size, const float tolerance) {
+        m_guides.clear();
+        Snap snap;
+        if (!m_isActive) return snap;
+
+        // Both axes are decided first so the guides span the final position.
+        const auto snapX = SnapAxis(0, position, size, tolerance);
+        const auto snapY = SnapAxis(1, position, size, tolerance);
+        if (snapX) snap.x = position.x += snapX->delta;
+        if (snapY) snap.y = position.y += snapY->delta;
+
+        for (int axis = 0; axis < 2; ++axis) {
+            const auto& axisSnap = axis == 0 ? snapX : snapY;
+            if (!axisSnap) continue;
+            if (axisSnap->spacing) AddSpacingGuides(axis, position, size, *axisSnap->spacing);
+            else AddAlignmentGuides(axis, position, size);
+        }
+        return snap;
+    }
+
+    std::optional<AlignmentGuides::AxisSnap> AlignmentGuides::SnapAxis(const int axis, const glm::vec2 position, const glm::vec2 size, const float tolerance) const {
+        const auto& entries = m_entries[axis];
+        if (entries.empty()) return std::nullopt;
+
+        std::optional<AxisSnap> best;
+        const auto consider = [&best, tolerance](const float delta, const std::optional<std::pair<float, float>>& spacing) {
+            if (std::abs(delta) > tolerance || (best && std::abs(best->delta) <= std::abs(delta))) return;
+            best = AxisSnap{delta, spacing};
+        };
+
+        // Edges and centers: the nearest entry to a value is at its lower bound or just before.
+        const float values[3] = {position[axis], position[axis] + size[axis] * 0.5f, position[axis] + size[axis]};
+        for (const float value : values) {
+            const auto it = LowerBound(entries, value);
+            if (it != entries.end()) consider(it->value - value, std::nullopt);
+            if (it != entries.begin()) consider(std::prev(it)->value - value, std::nullopt);
+        }
+
+        // Equal gaps: the nearest block ending before this one and the nearest starting after
+        // it, among those overlapping it across the axis.
+        const int other = 1 - axis;
+        const auto isAcross = [&](const Entry& entry) {
+            return entry.min[other] < position[other] + size[other] && position[other] < entry.max[other];
+        };
+        const Entry* before = nullptr;
+        auto it = LowerBound(entries, values[0] + tolerance);
+        for (std::size_t scanned = 0; it != entries.begin() && scanned < MAX_SCAN; ++scanned) {
+            --it;
+            if (it->kind == Kind::Max && isAcross(*it)) {
+                before = &*it;
+                break;
+            }
+        }
+        const Entry* after = nullptr;
+        it = LowerBound(entries, values[2] - tolerance);
+        for (std::size_t scanned = 0; it != entries.end() && scanned < MAX_SCAN; ++it, ++scanned) {
+            if (it->kind == Kind::Min && isAcross(*it)) {
+                after = &*it;
+                break;
+            }
+        }
+        if (before && after && after->value - before->value >= size[axis]) {
+            const float centered = (before->value + after->value - size[axis]) * 0.5f;
+            consider(centered - values[0], std::pair{before->value, after->value});
+        }
+        return best;
+    }
+
+    void AlignmentGuides::AddAlignmentGuides(const int axis, const glm::vec2 position, const glm::vec2 size) {
+        const int other = 1 - axis;
+        const float values[3] = {position[axis], position[axis] + size[axis] * 0.5f, position[axis] + size[axis]};
+        for (const float value : values) {
+            float from = position[other];
+            float to = position[other] + size[other];
+            bool isAligned = false;
+            auto it = LowerBound(m_entries[axis], value - ALIGNED_EPSILON);
+            for (std::size_t scanned = 0; it != m_entries[axis].end() && it->value <= value + ALIGNED_EPSILON && scanned < MAX_SCAN; ++it, ++scanned) {
+                from = std::min(from, it->min[other]);
+                to = std::max(to, it->max[other]);
+                isAligned = true;
+            }
+            if (!isAligned) continue;
+
+            Guide guide;
+            guide.start[axis] = guide.end[axis] = value;
+            guide.start[other] = from;
+            guide.end[other] = to;
+            m_guides.push_back(guide);
+        }
+    }
+
+    void AlignmentGuides::AddSpacingGuides(const int axis, const glm::vec2 position, const glm::vec2 size, const std::pair<float, float> spacing) {
+        const int other = 1 - axis;
+        const float across = position[other] + size[other] * 0.5f;
+        const std::pair<float, float> gaps[2] = {{spacing.first, position[axis]}, {position[axis] + size[axis], spacing.second}};
+        for (const auto& [from, to] : gaps) {
+            Guide guide;
+            guide.start[axis] = from;
+            guide.end[axis] = to;
+            guide.start[other] = guide.end[other] = across;
+            guide.isSpacing = true;
+            m_guides.push_back(guide);
+        }
+    }
+
+    void AlignmentGuides::Render(SDL_Renderer* renderer, const Camera& camera) const noexcept {
+        if (m_guides.empty()) return;
+
+        int w, h;
+        SDL_GetRendererOutputSize(renderer, &w, &h);
+        const glm::vec2 screenSize{static_cast<float>(w), static_cast<float>(h)};
+
+        SDL_SetRenderDrawColor(renderer, 255, 64, 160, 255);
+        for (const auto& guide : m_guides) {
+            const glm::vec2 start = camera.WorldToScreen(guide.start, screenSize);
+            const glm::vec2 end = camera.WorldToScreen(guide.end, screenSize);
+            SDL_RenderDrawLineF(renderer, start.x, start.y, end.x, end.y);
+            if (!guide.isSpacing) continue;
+
+            // Ticks across both ends mark the gap.
+            const bool isHorizontal = start.y == end.y;
+            for (const glm::vec2 point : {start, end}) {
+                if (isHorizontal) SDL_RenderDrawLineF(renderer, point.x, point.y - TICK_SIZE, point.x, point.y + TICK_SIZE);
+                else SDL_RenderDrawLineF(renderer, point.x - TICK_SIZE, point.y, point.x + TICK_SIZE, point.y);
+            }
+        }
+    }
+}
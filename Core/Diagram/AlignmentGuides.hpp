@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <SDL.h>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Diagram {
+    class Block;
+    class ComponentBase;
+    struct Camera;
+
+    // Snapping of a dragged block to the others: its left/center/right and top/center/bottom
+    // lining up with theirs, and equal gaps to its nearest neighbors in the same row or
+    // column. When a drag starts, the edges and centers of all other blocks are sorted per
+    // axis, each with the block's extent; every motion event then binary-searches that
+    // index around the dragged block's values and only looks at the few entries in range.
+    class AlignmentGuides {
+    public:
+        // Distance on screen within which a guide catches, in pixels.
+        static constexpr float SNAP_DISTANCE = 6.0f;
+        // Entries a motion event looks at past its binary search, per value.
+        static constexpr std::size_t MAX_SCAN = 64;
+
+        struct Snap {
+            std::optional<float> x;
+            std::optional<float> y;
+        };
+
+        // World-space line; spacing guides mark a gap that was matched.
+        struct Guide {
+            glm::vec2 start{0.0f};
+            glm::vec2 end{0.0f};
+            bool isSpacing = false;
+        };
+
+        void Begin(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const Block& dragged);
+        void End() noexcept;
+        bool IsActive() const noexcept { return m_isActive; }
+
+        // Snapped coordinates of a block at `position` for the axes where a guide caught
+        // within `tolerance` (world units), and the guides to show for them.
+        Snap Apply(glm::vec2 position, glm::vec2 size, float tolerance);
+        const std::vector<Guide>& GetGuides() const noexcept { return m_guides; }
+
+        void Render(SDL_Renderer* renderer, const Camera& camera) const noexcept;
+
+    private:
+        enum class Kind : unsigned char {
+            Min,
+            Center,
+            Max
+        };
+
+        struct Entry {
+            float value = 0.0f;
+            Kind kind = Kind::Min;
+            // The block's bounds, so the other axis can be checked for overlap.
+            glm::vec2 min{0.0f};
+            glm::vec2 max{0.0f};
+        };
+
+        struct AxisSnap {
+            float delta = 0.0f;
+            // Set when a gap matched: the facing edges of the neighbors before and after.
+            std::optional<std::pair<float, float>> spacing;
+        };
+
+        std::optional<AxisSnap> SnapAxis(int axis, glm::vec2 position, glm::vec2 size, float tolerance) const;
+        void AddAlignmentGuides(int axis, glm::vec2 position, glm::vec2 size);
+        void AddSpacingGuides(int axis, glm::vec2 position, glm::vec2 size, std::pair<float, float> spacing);
+
+        std::array<std::vector<Entry>, 2> m_entries;
+        std::vector<Guide> m_guides;
+        bool m_isActive = false;
+    };
+}
@@ -1,7 +1,11 @@
 #include "Block.hpp"
+#include "AlignmentGuides.hpp"
 #include "Camera.hpp"
+#include "SceneSnapshot.hpp"
+#include "TreeRenderer.hpp"
 #include "../Main/DiagramData.hpp"
 #include <cstring>
+#include <glm/common.hpp>
 
 #include <imgui.h>
 
@@ -14,12 +18,23 @@ namespace Diagram {
             if (contains) {
                 m_dragging = true;
                 m_dragOffset = worldPos - data.position;
+                m_dragStart = data.position;
+                if (auto* diagramData = DiagramData::GetInstance()) diagramData->GetAlignmentGuides().Begin(diagramData->GetComponentList(), *this);
                 return true;
             }
         }
         else if (event.type == SDL_MOUSEBUTTONUP && event.button.button == SDL_BUTTON_LEFT) {
             if (m_dragging) {
                 m_dragging = false;
+                if (auto* diagramData = DiagramData::GetInstance()) diagramData->GetAlignmentGuides().End();
+                if (data.position != m_dragStart) {
+                    if (auto* journal = DiagramData::GetActiveJournal()) journal->RecordMove(id, data.position);
+                    if (auto* history = DiagramData::GetActiveHistory()) {
+                        Data before = data;
+                        before.position = m_dragStart;
+                        history->RecordFields(*this, before);
+                    }
+                }
                 return true;
             }
         }
@@ -28,50 +43,25 @@ namespace Diagram {
             glm::vec2 newPosition = worldPos - m_dragOffset;
             
             if (auto* diagramData = DiagramData::GetInstance()) {
-                newPosition = diagramData->GetGrid().SnapToGrid(newPosition);
+                // Other blocks take precedence over the grid, axis by axis.
+                const auto snap = diagramData->GetAlignmentGuides().Apply(newPosition, data.size, AlignmentGuides::SNAP_DISTANCE / camera.data.zoom);
+                const glm::vec2 gridPosition = diagramData->GetGrid().SnapToGrid(newPosition);
+                newPosition = {snap.x.value_or(gridPosition.x), snap.y.value_or(gridPosition.y)};
             }
             
-            data.position = newPosition;
+            if (newPosition != data.position) {
+                data.position = newPosition;
+                MarkDirty();
+            }
             return true;
         }
         return false;
     }
 
-    void Block::Render(SDL_Renderer* renderer, const Camera& camera, const glm::vec2 screenSize) const noexcept {
-        const auto screenPos = camera.WorldToScreen(data.position, screenSize);
-        const SDL_FRect rect = {screenPos.x, screenPos.y, data.size.x * camera.data.zoom, data.size.y * camera.data.zoom};
-
-        const auto bgR = static_cast<Uint8>(data.backgroundColor.r * 255.0f);
-        const auto bgG = static_cast<Uint8>(data.backgroundColor.g * 255.0f);
-        const auto bgB = static_cast<Uint8>(data.backgroundColor.b * 255.0f);
-        const auto bgA = static_cast<Uint8>(data.backgroundColor.a * 255.0f);
-
-        SDL_SetRenderDrawColor(renderer, bgR, bgG, bgB, bgA);
-        SDL_RenderFillRectF(renderer, &rect);
-
-        const auto borderR = static_cast<Uint8>(data.borderColor.r * 255.0f);
-        const auto borderG = static_cast<Uint8>(data.borderColor.g * 255.0f);
-        const auto borderB = static_cast<Uint8>(data.borderColor.b * 255.0f);
-        const auto borderA = static_cast<Uint8>(data.borderColor.a * 255.0f);
-        
-        SDL_SetRenderDrawColor(renderer, borderR, borderG, borderB, borderA);
-        SDL_RenderDrawRectF(renderer, &rect);
-
-        if (!data.label.empty()) {
-            ImDrawList* drawList = ImGui::GetBackgroundDrawList();
-            
-            const float baseFontSize = 1.0f;
-            const float scaledFontSize = baseFontSize * camera.data.zoom;
-            
-            ImFont* font = ImGui::GetFont();
-            const ImVec2 textSize = font->CalcTextSizeA(scaledFontSize, FLT_MAX, 0.0f, data.label.c_str());
-            
-            const ImVec2 textPos(
-                screenPos.x + (rect.w - textSize.x) * 0.5f,
-                screenPos.y + (rect.h - textSize.y) * 0.5f
-            );
-            drawList->AddText(font, scaledFontSize, textPos, IM_COL32(255, 255, 255, 255), data.label.c_str());
-        }
+    void Block::AppendToScene(SceneSnapshot& scene) const {
+        const glm::vec2 corner = data.position + data.size;
+        if (!scene.IsVisible(glm::min(data.position, corner), glm::max(data.position, corner))) return;
+        scene.AddRect(data.position, data.size, data.backgroundColor, data.borderColor, data.label);
     }
 
     void Block::XmlSerialize(pugi::xml_node& node) const {
@@ -82,32 +72,74 @@ namespace Diagram {
         XML::auto_deserialize(data, node);
     }
 
+    void Block::JsonSerialize(nlohmann::json& node) const {
+        JSON::auto_serialize(data, node);
+    }
+
+    void Block::JsonDeserialize(const nlohmann::json& node) {
+        JSON::auto_deserialize(data, node);
+    }
+
     std::string Block::GetDisplayName() const noexcept {
         return data.label.empty() ? "Block" : data.label;
     }
 
+    std::size_t Block::GetStringBytes() const noexcept {
+        return ComponentBase::GetStringBytes() + Utils::MemoryAccounting::HeapBytes(data.label);
+    }
+
 
     void Block::RenderUI(const int id) noexcept {
         ImGui::PushID(id);
+        bool changed = false;
+        auto* journal = DiagramData::GetActiveJournal();
+        auto* history = DiagramData::GetActiveHistory();
+        if (m_editBaseRevision != GetRevision()) {
+            m_editBase = data;
+            m_editBaseRevision = GetRevision();
+        }
         
         char labelBuffer[256];
         std::strncpy(labelBuffer, data.label.c_str(), sizeof(labelBuffer) - 1);
         labelBuffer[sizeof(labelBuffer) - 1] = '\0';
         if (ImGui::InputText("Label", labelBuffer, sizeof(labelBuffer))) {
             data.label = labelBuffer;
+            changed = true;
+            if (journal) journal->RecordRelabel(this->id, data.label);
+            TreeRenderer::Relabel(*this);
         }
         
-        ImGui::DragFloat2("Position", &data.position.x, 1.0f);
-        ImGui::DragFloat2("Size", &data.size.x, 1.0f, 10.0f, 500.0f);
-        ImGui::ColorEdit4("Background", &data.backgroundColor.x);
-        ImGui::ColorEdit4("Border", &data.borderColor.x);
+        if (ImGui::DragFloat2("Position", &data.position.x, 1.0f)) {
+            changed = true;
+            if (journal) journal->RecordMove(this->id, data.position);
+        }
+        if (ImGui::DragFloat2("Size", &data.size.x, 1.0f, 10.0f, 500.0f)) {
+            changed = true;
+            if (journal) journal->RecordResize(this->id, data.size);
+        }
+
+        bool restyled = ImGui::ColorEdit4("Background", &data.backgroundColor.x);
+        restyled |= ImGui::ColorEdit4("Border", &data.borderColor.x);
         
         const char* typeNames[] = {"Start", "Process", "Decision", "End"};
         int currentType = static_cast<int>(data.type);
         if (ImGui::Combo("Type", &currentType, typeNames, 4)) {
             data.type = static_cast<Type>(currentType);
+            restyled = true;
+        }
+
+        if (restyled) {
+            changed = true;
+            if (journal) journal->RecordUpdate(*this);
         }
         
+        if (changed) {
+            MarkDirty();
+            // A drag or a run of keystrokes stays one history entry while its widget is active.
+            if (history) history->RecordFields(*this, m_editBase, ImGui::IsAnyItemActive());
+        } else if (history && !ImGui::IsAnyItemActive()) {
+            history->Seal();
+        }
         ImGui::PopID();
     }
 }
\ No newline at end of file
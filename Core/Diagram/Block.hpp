@@ -6,6 +6,7 @@
 #include <pugixml.hpp>
 #include <SDL.h>
 #include "../Utils/XMLSerialization.hpp"
+#include "../Utils/JSONSerialization.hpp"
 #include "Component.hpp"
 
 namespace Diagram {
@@ -31,15 +32,22 @@ namespace Diagram {
         } data;
 
         bool HandleEvent(const SDL_Event& event, const Camera& camera, glm::vec2 screenSize) noexcept override;
-        void Render(SDL_Renderer* renderer, const Camera& camera, glm::vec2 screenSize) const noexcept override;
+        void AppendToScene(SceneSnapshot& scene) const override;
         void XmlSerialize(pugi::xml_node& node) const override;
         void XmlDeserialize(const pugi::xml_node& node) override;
+        void JsonSerialize(nlohmann::json& node) const override;
+        void JsonDeserialize(const nlohmann::json& node) override;
         std::string GetDisplayName() const noexcept override;
+        std::size_t GetStringBytes() const noexcept override;
 
         void RenderUI(int id) noexcept;
 
     private:
         bool m_dragging = false;
         glm::vec2 m_dragOffset{0.0f};
+        glm::vec2 m_dragStart{0.0f};
+        // State the editor panel diffs its edits against, refreshed when the revision moves.
+        Data m_editBase;
+        std::uint64_t m_editBaseRevision = 0;
     };
 }
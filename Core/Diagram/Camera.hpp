@@ -3,6 +3,7 @@
 #include <glm/vec2.hpp>
 #include <pugixml.hpp>
 #include "../Utils/XMLSerialization.hpp"
+#include "../Utils/JSONSerialization.hpp"
 
 namespace Diagram {
     struct Camera {
@@ -39,5 +40,13 @@ namespace Diagram {
         void XmlDeserialize(const pugi::xml_node& node) {
             XML::auto_deserialize(data, node);
         }
+
+        void JsonSerialize(nlohmann::json& node) const {
+            JSON::auto_serialize(data, node);
+        }
+
+        void JsonDeserialize(const nlohmann::json& node) {
+            JSON::auto_deserialize(data, node);
+        }
     };
 }
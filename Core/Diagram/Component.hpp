@@ -3,17 +3,22 @@
 #include <glm/vec2.hpp>
 #include <SDL.h>
 #include <pugixml.hpp>
+#include <nlohmann/json_fwd.hpp>
 #include <vector>
 #include <string>
 #include <memory>
 #include <typeinfo>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cxxabi.h>
+#include "../Utils/MemoryAccounting.hpp"
 
 struct ImVec2;
 
 namespace Diagram {
     struct Camera;
+    struct SceneSnapshot;
     class Block;
     
     class ComponentBase {
@@ -23,23 +28,50 @@ namespace Diagram {
         std::string id;
 
         virtual ~ComponentBase() = default;
+
+        // Components are charged to their own line of the memory accounting. The virtual
+        // destructor makes the sized delete see the derived size.
+        static void* operator new(const std::size_t bytes) {
+            return Utils::MemoryAccounting::Allocate(Utils::MemoryAccounting::Subsystem::Components, bytes);
+        }
+        static void operator delete(void* pointer, const std::size_t bytes) noexcept {
+            Utils::MemoryAccounting::Deallocate(Utils::MemoryAccounting::Subsystem::Components, pointer, bytes);
+        }
         
         // Core interface
         virtual bool HandleEvent(const SDL_Event& event, const Camera& camera, glm::vec2 screenSize) noexcept = 0;
-        virtual void Render(SDL_Renderer* renderer, const Camera& camera, glm::vec2 screenSize) const noexcept = 0;
+        // Main thread: copies what the canvas draws of this component into `scene`, if visible.
+        virtual void AppendToScene(SceneSnapshot& scene) const = 0;
         virtual void XmlSerialize(pugi::xml_node& node) const = 0;
         virtual void XmlDeserialize(const pugi::xml_node& node) = 0;
+        virtual void JsonSerialize(nlohmann::json& node) const = 0;
+        virtual void JsonDeserialize(const nlohmann::json& node) = 0;
         virtual std::string GetDisplayName() const noexcept = 0;
         virtual std::string GetTypeName() const noexcept = 0;
+        virtual std::unique_ptr<ComponentBase> Clone() const = 0;
+        // Heap bytes held by this component's strings. No allocator hook sees them, so the
+        // Strings line of the memory accounting measures them through this instead.
+        virtual std::size_t GetStringBytes() const noexcept {
+            return Utils::MemoryAccounting::HeapBytes(id) + Utils::MemoryAccounting::HeapBytes(groupId);
+        }
         
         // Selection management
         static ComponentBase* GetSelected() noexcept { return s_selected; }
         static void Select(ComponentBase* component) noexcept { s_selected = component; }
         static void ClearSelection() noexcept { s_selected = nullptr; }
-        
+
+        // Change tracking: every edit draws a fresh revision from a global counter, so a
+        // revision identifies one state of one component and caches can key on it alone.
+        // Documents are built on load workers while the main thread edits, hence atomic.
+        std::uint64_t GetRevision() const noexcept { return m_revision; }
+        void MarkDirty() noexcept { m_revision = NextRevision(); }
         
     private:
+        static std::uint64_t NextRevision() noexcept { return s_revisionCounter.fetch_add(1, std::memory_order_relaxed) + 1; }
+
         inline static ComponentBase* s_selected;
+        inline static std::atomic<std::uint64_t> s_revisionCounter = 0;
+        std::uint64_t m_revision = NextRevision();
     };
     
     template<typename T>
@@ -60,6 +92,7 @@ namespace Diagram {
     class Component : public ComponentBase {
     public:
         std::string GetTypeName() const noexcept override { return demangle<Derived>(); }
+        std::unique_ptr<ComponentBase> Clone() const override { return std::make_unique<Derived>(static_cast<const Derived&>(*this)); }
         static std::string GetStaticTypeName() noexcept { return demangle<Derived>(); }
     };
     
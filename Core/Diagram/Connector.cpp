@@ -0,0 +1,121 @@
+#include "Connector.hpp"
+#include "Camera.hpp"
+#include "SceneSnapshot.hpp"
+#include "TreeRenderer.hpp"
+#include "../Main/DiagramData.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/common.hpp>
+
+#include <imgui.h>
+
+namespace Diagram {
+    namespace {
+        // How close to a segment, in pixels, a click still selects the connector.
+        constexpr float HIT_TOLERANCE = 4.0f;
+        constexpr glm::vec4 SELECTED_COLOR{0.0f, 120.0f / 255.0f, 214.0f / 255.0f, 1.0f};
+
+        float DistanceToSegment(const glm::vec2 point, const glm::vec2 a, const glm::vec2 b) noexcept {
+            const glm::vec2 ab = b - a;
+            const float lengthSquared = ab.x * ab.x + ab.y * ab.y;
+            const float t = lengthSquared > 0.0f ? std::clamp(((point.x - a.x) * ab.x + (point.y - a.y) * ab.y) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+            const glm::vec2 closest = a + ab * t;
+            return std::hypot(point.x - closest.x, point.y - closest.y);
+        }
+
+        bool EditId(const char* label, std::string& value) {
+            char buffer[256];
+            std::strncpy(buffer, value.c_str(), sizeof(buffer) - 1);
+            buffer[sizeof(buffer) - 1] = '\0';
+            if (!ImGui::InputText(label, buffer, sizeof(buffer))) return false;
+            value = buffer;
+            return true;
+        }
+    }
+
+    bool Connector::HandleEvent(const SDL_Event& event, const Camera& camera, const glm::vec2 screenSize) noexcept {
+        if (event.type != SDL_MOUSEBUTTONDOWN || event.button.button != SDL_BUTTON_LEFT || route.size() < 2) return false;
+
+        const glm::vec2 mousePos{static_cast<float>(event.button.x), static_cast<float>(event.button.y)};
+        for (std::size_t i = 1; i < route.size(); ++i) {
+            const glm::vec2 a = camera.WorldToScreen(route[i - 1], screenSize);
+            const glm::vec2 b = camera.WorldToScreen(route[i], screenSize);
+            if (DistanceToSegment(mousePos, a, b) <= HIT_TOLERANCE) return true;
+        }
+        return false;
+    }
+
+    void Connector::AppendToScene(SceneSnapshot& scene) const {
+        if (route.size() < 2) return;
+
+        glm::vec2 min = route.front();
+        glm::vec2 max = route.front();
+        for (const auto& point : route) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+        if (!scene.IsVisible(min, max)) return;
+
+        const glm::vec4 color = GetSelected() == this ? SELECTED_COLOR : data.color;
+        scene.arrows.push_back({static_cast<std::uint32_t>(scene.points.size()), static_cast<std::uint32_t>(route.size()), color});
+        scene.points.insert(scene.points.end(), route.begin(), route.end());
+    }
+
+    void Connector::XmlSerialize(pugi::xml_node& node) const {
+        XML::auto_serialize(data, node);
+    }
+
+    void Connector::XmlDeserialize(const pugi::xml_node& node) {
+        XML::auto_deserialize(data, node);
+    }
+
+    void Connector::JsonSerialize(nlohmann::json& node) const {
+        JSON::auto_serialize(data, node);
+    }
+
+    void Connector::JsonDeserialize(const nlohmann::json& node) {
+        JSON::auto_deserialize(data, node);
+    }
+
+    std::string Connector::GetDisplayName() const noexcept {
+        return data.source + " -> " + data.target;
+    }
+
+    std::size_t Connector::GetStringBytes() const noexcept {
+        return ComponentBase::GetStringBytes() + Utils::MemoryAccounting::HeapBytes(data.source) + Utils::MemoryAccounting::HeapBytes(data.target);
+    }
+
+    void Connector::RenderUI(const int id) noexcept {
+        ImGui::PushID(id);
+        bool changed = false;
+        auto* history = DiagramData::GetActiveHistory();
+        if (m_editBaseRevision != GetRevision()) {
+            m_editBase = data;
+            m_editBaseRevision = GetRevision();
+        }
+
+        bool isRelinked = EditId("Source", data.source);
+        isRelinked |= EditId("Target", data.target);
+        if (isRelinked) {
+            changed = true;
+            // The router relinks from the revision; only the tree row shows the new ends.
+            TreeRenderer::Relabel(*this);
+        }
+        changed |= ImGui::ColorEdit4("Color", &data.color.x);
+
+        if (changed) {
+            MarkDirty();
+            if (auto* journal = DiagramData::GetActiveJournal()) journal->RecordUpdate(*this);
+            // A run of keystrokes stays one history entry while its widget is active.
+            if (history) history->RecordFields(*this, m_editBase, ImGui::IsAnyItemActive());
+        } else if (history && !ImGui::IsAnyItemActive()) {
+            history->Seal();
+        }
+
+        if (route.empty()) {
+            ImGui::TextDisabled("Not routed: both ends must name a loaded block");
+        }
+        ImGui::PopID();
+    }
+}
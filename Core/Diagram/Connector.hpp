@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <string>
+#include <vector>
+#include <pugixml.hpp>
+#include <SDL.h>
+#include "../Utils/XMLSerialization.hpp"
+#include "../Utils/JSONSerialization.hpp"
+#include "Component.hpp"
+
+namespace Diagram {
+    struct Camera;
+
+    // A directed connection between two blocks, referenced by id. Only the endpoints and
+    // the style are stored; the route is derived by the ConnectorRouter and kept here
+    // for drawing and hit testing.
+    class Connector final : public Component<Connector> {
+    public:
+        struct Data {
+            std::string source;
+            std::string target;
+            glm::vec4 color{0.85f, 0.85f, 0.85f, 1.0f};
+        } data;
+
+        // World-space polyline from the source block's border to the target's; empty while
+        // an endpoint is missing or the connector has not been routed yet.
+        std::vector<glm::vec2> route;
+
+        bool HandleEvent(const SDL_Event& event, const Camera& camera, glm::vec2 screenSize) noexcept override;
+        void AppendToScene(SceneSnapshot& scene) const override;
+        void XmlSerialize(pugi::xml_node& node) const override;
+        void XmlDeserialize(const pugi::xml_node& node) override;
+        void JsonSerialize(nlohmann::json& node) const override;
+        void JsonDeserialize(const nlohmann::json& node) override;
+        std::string GetDisplayName() const noexcept override;
+        std::size_t GetStringBytes() const noexcept override;
+
+        void RenderUI(int id) noexcept;
+
+    private:
+        // State the editor panel diffs its edits against, refreshed when the revision moves.
+        Data m_editBase;
+        std::uint64_t m_editBaseRevision = 0;
+    };
+}
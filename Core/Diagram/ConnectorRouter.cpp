@@ -0,0 +1,380 @@
+#include "ConnectorRouter.hpp"
+#include "Block.hpp"
+#include "Connector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+namespace Diagram {
+    namespace {
+        // Right, down, left, up; a turn is +1 or +3 modulo 4.
+        constexpr glm::ivec2 DIRECTIONS[4] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+
+        // 31 bits per coordinate and 2 for the direction of travel.
+        std::uint64_t StateKey(const glm::ivec2 point, const int direction) noexcept {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(point.x) & 0x7fffffffu) << 33 |
+                   static_cast<std::uint64_t>(static_cast<std::uint32_t>(point.y) & 0x7fffffffu) << 2 |
+                   static_cast<std::uint64_t>(direction);
+        }
+
+        glm::ivec2 StatePoint(const std::uint64_t key) noexcept {
+            const auto x = static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 33) << 1) >> 1;
+            const auto y = static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 2) << 1) >> 1;
+            return {x, y};
+        }
+
+        int StateDirection(const std::uint64_t key) noexcept {
+            return static_cast<int>(key & 3u);
+        }
+
+        // Drops repeated points and the middle of straight runs.
+        void Simplify(std::vector<glm::vec2>& points) {
+            std::vector<glm::vec2> result;
+            result.reserve(points.size());
+            for (const auto& point : points) {
+                if (!result.empty() && result.back() == point) continue;
+                if (result.size() >= 2) {
+                    const glm::vec2 a = result[result.size() - 2];
+                    const glm::vec2 b = result.back();
+                    if ((a.x == b.x && b.x == point.x) || (a.y == b.y && b.y == point.y)) {
+                        result.back() = point;
+                        continue;
+                    }
+                }
+                result.push_back(point);
+            }
+            points = std::move(result);
+        }
+    }
+
+    void ConnectorRouter::Update(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const std::uint64_t structureVersion) {
+        if (scannedVersion != structureVersion) {
+            Rescan(componentList);
+            scannedVersion = structureVersion;
+        }
+
+        for (const auto* block : blockList) {
+            auto& state = blocks[block];
+            if (state.revision == block->GetRevision()) continue;
+            state.revision = block->GetRevision();
+            const Rect rect = BoundsOf(*block);
+            if (rect == state.rect) continue;
+            const Rect before = std::exchange(state.rect, rect);
+            MoveBlock(block, state.id, before, rect);
+        }
+
+        bool isRelinked = false;
+        for (auto* connector : connectorList) {
+            auto& state = connectors[connector];
+            if (state.linkedRevision != connector->GetRevision()) {
+                state.linkedRevision = connector->GetRevision();
+                isRelinked = true;
+            }
+            if (state.revision != connector->GetRevision()) Enqueue(connector);
+        }
+        if (isRelinked) RebuildLinks();
+
+        const auto deadline = std::chrono::steady_clock::now() + FRAME_BUDGET;
+        while (!queue.empty() && std::chrono::steady_clock::now() < deadline) {
+            Connector* connector = queue.front();
+            queue.pop_front();
+            queued.erase(connector);
+            Route(*connector);
+            connectors[connector].revision = connector->GetRevision();
+            ++routedCount;
+        }
+    }
+
+    void ConnectorRouter::Rescan(const std::vector<std::unique_ptr<ComponentBase>>& componentList) {
+        blockList.clear();
+        connectorList.clear();
+        for (const auto& component : componentList) {
+            if (auto* block = dynamic_cast<Block*>(component.get())) blockList.push_back(block);
+            else if (auto* connector = dynamic_cast<Connector*>(component.get())) connectorList.push_back(connector);
+        }
+
+        // Removed components are gone already; only their pointers are compared.
+        const std::unordered_set<const Connector*> liveConnectors(connectorList.begin(), connectorList.end());
+        for (auto it = connectors.begin(); it != connectors.end();) {
+            if (liveConnectors.contains(it->first)) {
+                ++it;
+                continue;
+            }
+            Unregister(it->first, it->second);
+            if (queued.erase(it->first)) std::erase(queue, it->first);
+            it = connectors.erase(it);
+        }
+
+        RebuildLinks();
+
+        const std::unordered_set<const Block*> liveBlocks(blockList.begin(), blockList.end());
+        for (auto it = blocks.begin(); it != blocks.end();) {
+            if (liveBlocks.contains(it->first)) {
+                ++it;
+                continue;
+            }
+            MoveBlock(it->first, it->second.id, it->second.rect, std::nullopt);
+            it = blocks.erase(it);
+        }
+
+        for (const auto* block : blockList) {
+            const auto [it, isNew] = blocks.try_emplace(block);
+            auto& state = it->second;
+            if (isNew) {
+                state = {block->id, BoundsOf(*block), block->GetRevision()};
+                MoveBlock(block, state.id, std::nullopt, state.rect);
+            } else if (state.id != block->id) {
+                // Connectors naming either id resolve differently now.
+                for (const auto& id : {state.id, block->id}) {
+                    if (const auto link = links.find(id); link != links.end()) {
+                        for (auto* connector : link->second) Enqueue(connector);
+                    }
+                }
+                state.id = block->id;
+            }
+        }
+
+        for (auto* connector : connectorList) {
+            if (connectors.try_emplace(connector).second) Enqueue(connector);
+        }
+    }
+
+    void ConnectorRouter::RebuildLinks() {
+        blocksById.clear();
+        for (const auto* block : blockList) blocksById.try_emplace(block->id, block);
+
+        links.clear();
+        for (auto* connector : connectorList) {
+            links[connector->data.source].push_back(connector);
+            if (connector->data.target != connector->data.source) links[connector->data.target].push_back(connector);
+        }
+    }
+
+    void ConnectorRouter::MoveBlock(const Block* block, const std::string& id, const std::optional<Rect>& before, const std::optional<Rect>& after) {
+        const auto expand = [](Rect rect) {
+            rect.min -= CLEARANCE;
+            rect.max += CLEARANCE;
+            return rect;
+        };
+
+        if (before) {
+            ForEachBucket(expand(*before), [&](const std::uint64_t key) {
+                const auto it = blockBuckets.find(key);
+                if (it == blockBuckets.end()) return;
+                std::erase_if(it->second, [block](const BucketBlock& entry) { return entry.block == block; });
+                if (it->second.empty()) blockBuckets.erase(it);
+            });
+            MarkRegion(expand(*before));
+        }
+        if (after) {
+            ForEachBucket(expand(*after), [&](const std::uint64_t key) {
+                blockBuckets[key].push_back({block, *after});
+            });
+            MarkRegion(expand(*after));
+        }
+
+        if (const auto link = links.find(id); link != links.end()) {
+            for (auto* connector : link->second) Enqueue(connector);
+        }
+    }
+
+    void ConnectorRouter::MarkRegion(const Rect& region) {
+        ForEachBucket(region, [&](const std::uint64_t key) {
+            const auto it = routeBuckets.find(key);
+            if (it == routeBuckets.end()) return;
+            for (auto* connector : it->second) {
+                if (queued.contains(connector)) continue;
+                const auto& route = connector->route;
+                for (std::size_t i = 1; i < route.size(); ++i) {
+                    // Segments are axis-aligned, so each is its own bounding box.
+                    if (Rect {glm::min(route[i - 1], route[i]), glm::max(route[i - 1], route[i])}.Overlaps(region)) {
+                        Enqueue(connector);
+                        break;
+                    }
+                }
+            }
+        });
+    }
+
+    void ConnectorRouter::Enqueue(Connector* connector) {
+        if (queued.insert(connector).second) queue.push_back(connector);
+    }
+
+    void ConnectorRouter::Route(Connector& connector) {
+        auto& state = connectors[&connector];
+        Unregister(&connector, state);
+        connector.route.clear();
+
+        const auto source = blocksById.find(connector.data.source);
+        const auto target = blocksById.find(connector.data.target);
+        if (source == blocksById.end() || target == blocksById.end() || source->second == target->second) return;
+        const Rect from = blocks.at(source->second).rect;
+        const Rect to = blocks.at(target->second).rect;
+
+        // Leave through the side facing the target and enter through the opposite one.
+        const glm::vec2 delta = (to.min + to.max) * 0.5f - (from.min + from.max) * 0.5f;
+        const bool isHorizontal = std::abs(delta.x) >= std::abs(delta.y);
+        const int direction = isHorizontal ? (delta.x >= 0.0f ? 0 : 2) : (delta.y >= 0.0f ? 1 : 3);
+
+        const auto port = [](const Rect& rect, const int side) {
+            glm::vec2 point = (rect.min + rect.max) * 0.5f;
+            if (side == 0) point.x = rect.max.x;
+            else if (side == 1) point.y = rect.max.y;
+            else if (side == 2) point.x = rect.min.x;
+            else point.y = rect.min.y;
+
+            // Rounded outward so the lattice point clears the block, across to the nearest line.
+            const glm::vec2 exit = (point + glm::vec2(DIRECTIONS[side]) * CLEARANCE) / ROUTE_STEP;
+            const glm::ivec2 lattice {
+                static_cast<int>(side == 0 ? std::ceil(exit.x) : side == 2 ? std::floor(exit.x) : std::round(exit.x)),
+                static_cast<int>(side == 1 ? std::ceil(exit.y) : side == 3 ? std::floor(exit.y) : std::round(exit.y))};
+            return std::pair {point, lattice};
+        };
+        const auto [sourcePort, start] = port(from, direction);
+        const auto [targetPort, goal] = port(to, (direction + 2) % 4);
+
+        std::vector<glm::ivec2> path;
+        if (!Search(start, direction, goal, direction, MARGIN_STEPS, path) && !Search(start, direction, goal, direction, MAX_MARGIN_STEPS, path)) {
+            // Boxed in; a Z through the middle at least shows the connection.
+            if (isHorizontal) {
+                const int middle = (start.x + goal.x) / 2;
+                path = {start, {middle, start.y}, {middle, goal.y}, goal};
+            } else {
+                const int middle = (start.y + goal.y) / 2;
+                path = {start, {start.x, middle}, {goal.x, middle}, goal};
+            }
+        }
+
+        // Ports sit at side centers, which may be off the lattice across the side.
+        auto& route = connector.route;
+        const glm::vec2 first = glm::vec2(path.front()) * ROUTE_STEP;
+        const glm::vec2 last = glm::vec2(path.back()) * ROUTE_STEP;
+        route.push_back(sourcePort);
+        route.push_back(isHorizontal ? glm::vec2(first.x, sourcePort.y) : glm::vec2(sourcePort.x, first.y));
+        for (const auto& point : path) route.push_back(glm::vec2(point) * ROUTE_STEP);
+        route.push_back(isHorizontal ? glm::vec2(last.x, targetPort.y) : glm::vec2(targetPort.x, last.y));
+        route.push_back(targetPort);
+        Simplify(route);
+
+        Register(connector, state);
+    }
+
+    bool ConnectorRouter::Search(const glm::ivec2 start, const int startDirection, const glm::ivec2 goal, const int goalDirection, const int margin, std::vector<glm::ivec2>& path) {
+        struct Open {
+            int estimate = 0;
+            int cost = 0;
+            std::uint64_t key = 0;
+            bool operator>(const Open& other) const noexcept { return estimate > other.estimate; }
+        };
+
+        const glm::ivec2 low = glm::min(start, goal) - margin;
+        const glm::ivec2 high = glm::max(start, goal) + margin;
+        const auto heuristic = [goal](const glm::ivec2 point) { return std::abs(goal.x - point.x) + std::abs(goal.y - point.y); };
+
+        searchNodes.clear();
+        std::priority_queue<Open, std::vector<Open>, std::greater<>> open;
+        const std::uint64_t startKey = StateKey(start, startDirection);
+        searchNodes[startKey] = {0, startKey};
+        open.push({heuristic(start), 0, startKey});
+
+        std::size_t expansions = 0;
+        while (!open.empty()) {
+            const Open current = open.top();
+            open.pop();
+            auto& node = searchNodes[current.key];
+            if (node.isClosed || current.cost > node.cost) continue;
+            node.isClosed = true;
+
+            const glm::ivec2 point = StatePoint(current.key);
+            if (point == goal) {
+                path.clear();
+                for (std::uint64_t key = current.key;; key = searchNodes[key].parent) {
+                    path.push_back(StatePoint(key));
+                    if (key == startKey) break;
+                }
+                std::ranges::reverse(path);
+                return true;
+            }
+            if (++expansions > MAX_EXPANSIONS) return false;
+
+            // Straight on or a quarter turn either way; never back.
+            const int direction = StateDirection(current.key);
+            for (const int turn : {0, 1, 3}) {
+                const int next = (direction + turn) % 4;
+                const glm::ivec2 neighbor = point + DIRECTIONS[next];
+                if (neighbor.x < low.x || neighbor.y < low.y || neighbor.x > high.x || neighbor.y > high.y) continue;
+                if (neighbor != goal && IsBlocked(neighbor)) continue;
+
+                int cost = current.cost + 1 + (turn != 0 ? BEND_COST : 0);
+                if (neighbor == goal && next != goalDirection) cost += BEND_COST;
+                const std::uint64_t key = StateKey(neighbor, next);
+                const auto [it, isNew] = searchNodes.try_emplace(key, SearchNode {cost, current.key});
+                if (!isNew) {
+                    if (it->second.isClosed || it->second.cost <= cost) continue;
+                    it->second.cost = cost;
+                    it->second.parent = current.key;
+                }
+                open.push({cost + heuristic(neighbor), cost, key});
+            }
+        }
+        return false;
+    }
+
+    bool ConnectorRouter::IsBlocked(const glm::ivec2 point) const {
+        const glm::vec2 world = glm::vec2(point) * ROUTE_STEP;
+        const auto it = blockBuckets.find(BucketKey(static_cast<int>(std::floor(world.x / BUCKET_SIZE)), static_cast<int>(std::floor(world.y / BUCKET_SIZE))));
+        if (it == blockBuckets.end()) return false;
+        // Strictly inside the margin: a lattice line exactly CLEARANCE away stays free.
+        return std::ranges::any_of(it->second, [world](const BucketBlock& entry) {
+            return world.x > entry.rect.min.x - CLEARANCE && world.x < entry.rect.max.x + CLEARANCE &&
+                   world.y > entry.rect.min.y - CLEARANCE && world.y < entry.rect.max.y + CLEARANCE;
+        });
+    }
+
+    void ConnectorRouter::Register(Connector& connector, ConnectorState& state) {
+        const auto& route = connector.route;
+        for (std::size_t i = 1; i < route.size(); ++i) {
+            ForEachBucket({glm::min(route[i - 1], route[i]), glm::max(route[i - 1], route[i])}, [&](const std::uint64_t key) {
+                if (std::ranges::find(state.buckets, key) != state.buckets.end()) return;
+                state.buckets.push_back(key);
+                routeBuckets[key].push_back(&connector);
+            });
+        }
+    }
+
+    void ConnectorRouter::Unregister(const Connector* connector, ConnectorState& state) {
+        for (const auto key : state.buckets) {
+            const auto it = routeBuckets.find(key);
+            if (it == routeBuckets.end()) continue;
+            auto& list = it->second;
+            if (const auto entry = std::ranges::find(list, connector); entry != list.end()) {
+                *entry = list.back();
+                list.pop_back();
+            }
+            if (list.empty()) routeBuckets.erase(it);
+        }
+        state.buckets.clear();
+    }
+
+    ConnectorRouter::Rect ConnectorRouter::BoundsOf(const Block& block) noexcept {
+        const glm::vec2 corner = block.data.position + block.data.size;
+        return {glm::min(block.data.position, corner), glm::max(block.data.position, corner)};
+    }
+
+    std::uint64_t ConnectorRouter::BucketKey(const int x, const int y) noexcept {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(y);
+    }
+
+    template<typename Visit>
+    void ConnectorRouter::ForEachBucket(const Rect& rect, Visit&& visit) {
+        const int minX = static_cast<int>(std::floor(rect.min.x / BUCKET_SIZE));
+        const int minY = static_cast<int>(std::floor(rect.min.y / BUCKET_SIZE));
+        const int maxX = static_cast<int>(std::floor(rect.max.x / BUCKET_SIZE));
+        const int maxY = static_cast<int>(std::floor(rect.max.y / BUCKET_SIZE));
+        for (int x = minX; x <= maxX; ++x) {
+            for (int y = minY; y <= maxY; ++y) visit(BucketKey(x, y));
+        }
+    }
+}
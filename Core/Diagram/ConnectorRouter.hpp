@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Diagram {
+    class Block;
+    class ComponentBase;
+    class Connector;
+
+    // Orthogonal routes for connectors, found by A* over a lattice of ROUTE_STEP spacing
+    // that avoids blocks with CLEARANCE to spare. Blocks are kept in a uniform spatial
+    // grid so a lattice point is tested against nearby blocks only, and routed segments
+    // in a second one, so a block that moves or resizes re-routes just the connectors
+    // attached to it and those passing through its old or new area.
+    class ConnectorRouter {
+    public:
+        // Half a default grid step, so block edges and centers fall on the lattice.
+        static constexpr float ROUTE_STEP = 0.5f;
+        static constexpr float CLEARANCE = 1.0f;
+        static constexpr float BUCKET_SIZE = 16.0f;
+        // A bend costs as much as this many steps, so routes prefer fewer of them.
+        static constexpr int BEND_COST = 3;
+        // The search first stays within this many steps around its endpoints, then
+        // within MAX_MARGIN_STEPS; beyond that the connector gets a plain elbow.
+        static constexpr int MARGIN_STEPS = 40;
+        static constexpr int MAX_MARGIN_STEPS = 160;
+        static constexpr std::size_t MAX_EXPANSIONS = 50000;
+        // Routing spread over frames: what does not fit keeps its old route until the next.
+        static constexpr auto FRAME_BUDGET = std::chrono::microseconds(4000);
+
+        // Brings the routes up to date. The component list is only rescanned when
+        // `structureVersion` moved; otherwise revisions tell what changed.
+        void Update(const std::vector<std::unique_ptr<ComponentBase>>& componentList, std::uint64_t structureVersion);
+        std::size_t GetPendingCount() const noexcept { return queue.size(); }
+        std::size_t GetRoutedCount() const noexcept { return routedCount; }
+
+    private:
+        struct Rect {
+            glm::vec2 min{0.0f};
+            glm::vec2 max{0.0f};
+
+            bool operator==(const Rect&) const = default;
+            bool Overlaps(const Rect& other) const noexcept {
+                return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+            }
+        };
+
+        struct BlockState {
+            std::string id;
+            Rect rect;
+            std::uint64_t revision = 0;
+        };
+
+        struct SearchNode {
+            int cost = 0;
+            std::uint64_t parent = 0;
+            bool isClosed = false;
+        };
+
+        struct BucketBlock {
+            const Block* block = nullptr;
+            Rect rect;
+        };
+
+        struct ConnectorState {
+            // Revision last routed, and last taken into the links.
+            std::uint64_t revision = 0;
+            std::uint64_t linkedRevision = 0;
+            // Buckets its segments are registered in.
+            std::vector<std::uint64_t> buckets;
+        };
+
+        void Rescan(const std::vector<std::unique_ptr<ComponentBase>>& componentList);
+        void RebuildLinks();
+        // Removed blocks are never dereferenced, hence the id passed along.
+        void MoveBlock(const Block* block, const std::string& id, const std::optional<Rect>& before, const std::optional<Rect>& after);
+        void MarkRegion(const Rect& region);
+        void Enqueue(Connector* connector);
+        void Route(Connector& connector);
+        bool Search(glm::ivec2 start, int startDirection, glm::ivec2 goal, int goalDirection, int margin, std::vector<glm::ivec2>& path);
+        bool IsBlocked(glm::ivec2 point) const;
+        void Register(Connector& connector, ConnectorState& state);
+        void Unregister(const Connector* connector, ConnectorState& state);
+
+        static Rect BoundsOf(const Block& block) noexcept;
+        static std::uint64_t BucketKey(int x, int y) noexcept;
+        template<typename Visit>
+        static void ForEachBucket(const Rect& rect, Visit&& visit);
+
+        std::optional<std::uint64_t> scannedVersion;
+        std::vector<Block*> blockList;
+        std::vector<Connector*> connectorList;
+        std::unordered_map<const Block*, BlockState> blocks;
+        std::unordered_map<const Connector*, ConnectorState> connectors;
+        std::unordered_map<std::string, const Block*> blocksById;
+        // Block id to the connectors that end on it.
+        std::unordered_map<std::string, std::vector<Connector*>> links;
+        std::unordered_map<std::uint64_t, std::vector<BucketBlock>> blockBuckets;
+        std::unordered_map<std::uint64_t, std::vector<Connector*>> routeBuckets;
+
+        // Scratch of Search, kept to reuse its buckets.
+        std::unordered_map<std::uint64_t, SearchNode> searchNodes;
+
+        std::deque<Connector*> queue;
+        std::unordered_set<const Connector*> queued;
+        std::size_t routedCount = 0;
+    };
+}
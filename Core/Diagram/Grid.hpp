@@ -5,6 +5,7 @@
 #include <glm/vec2.hpp>
 #include <SDL2/SDL.h>
 #include "../Utils/XMLSerialization.hpp"
+#include "../Utils/JSONSerialization.hpp"
 #include "Camera.hpp"
 
 namespace Diagram {
@@ -21,6 +22,14 @@ namespace Diagram {
         void XmlDeserialize(const pugi::xml_node& node) {
             XML::auto_deserialize(*this, node);
         }
+
+        void JsonSerialize(nlohmann::json& node) const {
+            JSON::auto_serialize(*this, node);
+        }
+
+        void JsonDeserialize(const nlohmann::json& node) {
+            JSON::auto_deserialize(*this, node);
+        }
     };
 
 
@@ -94,5 +103,13 @@ namespace Diagram {
         void XmlDeserialize(const pugi::xml_node& node) {
             settings.XmlDeserialize(node);
         }
+
+        void JsonSerialize(nlohmann::json& node) const {
+            settings.JsonSerialize(node);
+        }
+
+        void JsonDeserialize(const nlohmann::json& node) {
+            settings.JsonDeserialize(node);
+        }
     };
 }
\ No newline at end of file
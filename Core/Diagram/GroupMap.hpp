@@ -0,0 +1,19 @@
+#pragma once
+
+#include <map>
+#include <memory_resource>
+#include <string>
+
+#include "../Utils/MemoryAccounting.hpp"
+
+namespace Diagram {
+    // Group id to the group's parent, name or expanded flag. Construct these with
+    // GroupMapResource() so their nodes are charged to the hierarchy; copy and move
+    // assignment keep it, copy construction does not.
+    template<typename T>
+    using GroupMap = std::pmr::map<std::string, T>;
+
+    inline std::pmr::memory_resource* GroupMapResource() noexcept {
+        return Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Hierarchy);
+    }
+}
@@ -0,0 +1,116 @@
+#include "OverlapDetector.hpp"
+#include "Block.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Diagram {
+    namespace {
+        std::pair<glm::vec2, glm::vec2> BoundsOf(const Block& block) noexcept {
+            const glm::vec2 corner = block.data.position + block.data.size;
+            return {
+                {std::min(block.data.position.x, corner.x), std::min(block.data.position.y, corner.y)},
+                {std::max(block.data.position.x, corner.x), std::max(block.data.position.y, corner.y)}};
+        }
+    }
+
+    void OverlapDetector::Update(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const std::uint64_t structureVersion) {
+        if (m_scannedVersion != structureVersion) {
+            Rebuild(componentList);
+            m_scannedVersion = structureVersion;
+            return;
+        }
+
+        std::size_t movedCount = 0;
+        for (auto& box : m_boxes) {
+            if (box.revision == box.block->GetRevision()) continue;
+            box.revision = box.block->GetRevision();
+            const auto [min, max] = BoundsOf(*box.block);
+            if (min == box.min && max == box.max) continue;
+            box.min = min;
+            box.max = max;
+            ++movedCount;
+        }
+        if (movedCount == 0) return;
+        if (movedCount > m_boxes.size() / REBUILD_FRACTION || !Resort(0) || !Resort(1)) Rebuild(componentList);
+    }
+
+    void OverlapDetector::Rebuild(const std::vector<std::unique_ptr<ComponentBase>>& componentList) {
+        m_boxes.clear();
+        m_pairs.clear();
+        for (const auto& component : componentList) {
+            auto* block = dynamic_cast<Block*>(component.get());
+            if (!block) continue;
+            const auto [min, max] = BoundsOf(*block);
+            m_boxes.push_back({block, min, max, block->GetRevision()});
+        }
+
+        for (int axis = 0; axis < 2; ++axis) {
+            auto& endpoints = m_endpoints[axis];
+            endpoints.clear();
+            endpoints.reserve(m_boxes.size() * 2);
+            for (std::uint32_t box = 0; box < m_boxes.size(); ++box) {
+                endpoints.push_back({m_boxes[box].min[axis], box, false});
+                endpoints.push_back({m_boxes[box].max[axis], box, true});
+            }
+            std::sort(endpoints.begin(), endpoints.end());
+        }
+
+        // Sweep along x with the blocks whose x range is open; each begin is tested
+        // against those only.
+        std::vector<std::uint32_t> active;
+        std::vector<std::uint32_t> activeIndex(m_boxes.size(), 0);
+        for (const auto& endpoint : m_endpoints[0]) {
+            if (endpoint.isMax) {
+                const std::uint32_t index = activeIndex[endpoint.box];
+                active[index] = active.back();
+                activeIndex[active[index]] = index;
+                active.pop_back();
+                continue;
+            }
+            for (const std::uint32_t other : active) {
+                if (Overlaps(endpoint.box, other)) m_pairs.insert(PairKey(endpoint.box, other));
+            }
+            activeIndex[endpoint.box] = static_cast<std::uint32_t>(active.size());
+            active.push_back(endpoint.box);
+        }
+    }
+
+    bool OverlapDetector::Resort(const int axis) {
+        auto& endpoints = m_endpoints[axis];
+        for (auto& endpoint : endpoints) {
+            const auto& box = m_boxes[endpoint.box];
+            endpoint.value = endpoint.isMax ? box.max[axis] : box.min[axis];
+        }
+
+        // Nearly sorted after a frame's moves, so insertion sort is close to linear. Every
+        // swap of a begin with an end is a pair that may have changed. Few blocks moving far
+        // still make many swaps, hence the budget.
+        std::size_t swapBudget = endpoints.size() * MAX_SWAPS_PER_ENDPOINT;
+        for (std::size_t i = 1; i < endpoints.size(); ++i) {
+            for (std::size_t j = i; j > 0 && endpoints[j] < endpoints[j - 1]; --j) {
+                if (swapBudget-- == 0) return false;
+                std::swap(endpoints[j], endpoints[j - 1]);
+                const auto& first = endpoints[j - 1];
+                const auto& second = endpoints[j];
+                if (first.isMax != second.isMax && first.box != second.box) UpdatePair(first.box, second.box);
+            }
+        }
+        return true;
+    }
+
+    void OverlapDetector::UpdatePair(const std::uint32_t first, const std::uint32_t second) {
+        if (Overlaps(first, second)) m_pairs.insert(PairKey(first, second));
+        else m_pairs.erase(PairKey(first, second));
+    }
+
+    bool OverlapDetector::Overlaps(const std::uint32_t first, const std::uint32_t second) const noexcept {
+        const auto& a = m_boxes[first];
+        const auto& b = m_boxes[second];
+        return a.min.x < b.max.x && b.min.x < a.max.x && a.min.y < b.max.y && b.min.y < a.max.y;
+    }
+
+    std::uint64_t OverlapDetector::PairKey(const std::uint32_t first, const std::uint32_t second) noexcept {
+        return static_cast<std::uint64_t>(std::min(first, second)) << 32 | std::max(first, second);
+    }
+}
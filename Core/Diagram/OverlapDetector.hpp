@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace Diagram {
+    class Block;
+    class ComponentBase;
+
+    // Pairs of blocks whose bounds overlap, found by sweep and prune. The begin and end
+    // values of every block's bounds are kept sorted per axis; two blocks start or stop
+    // overlapping only when an end of one passes an end of the other on some axis, so
+    // after blocks move, an insertion sort of the nearly sorted endpoints touches just the
+    // pairs whose status may have changed. A full sort and sweep, O(n log n + k), is run
+    // when the component list itself changed, and instead of the insertion sort when so
+    // much moved that it would go quadratic, as after a layout or the undo of one.
+    class OverlapDetector {
+    public:
+        // Moving more than this share of the blocks at once goes to the full sort.
+        static constexpr std::size_t REBUILD_FRACTION = 16;
+        // Swaps per endpoint an insertion sort may make before it gives up for the full sort.
+        static constexpr std::size_t MAX_SWAPS_PER_ENDPOINT = 4;
+
+        // Brings the pairs up to date. The component list is only rescanned when
+        // `structureVersion` moved; otherwise revisions tell which blocks moved.
+        void Update(const std::vector<std::unique_ptr<ComponentBase>>& componentList, std::uint64_t structureVersion);
+        std::size_t GetOverlapCount() const noexcept { return m_pairs.size(); }
+
+        template<typename Visit>
+        void ForEachPair(Visit&& visit) const {
+            for (const auto key : m_pairs) visit(*m_boxes[key >> 32].block, *m_boxes[key & 0xffffffffu].block);
+        }
+
+    private:
+        struct Box {
+            Block* block = nullptr;
+            glm::vec2 min{0.0f};
+            glm::vec2 max{0.0f};
+            std::uint64_t revision = 0;
+        };
+
+        struct Endpoint {
+            float value = 0.0f;
+            std::uint32_t box = 0;
+            bool isMax = false;
+
+            // At equal values ends sort before begins, so touching blocks do not overlap.
+            bool operator<(const Endpoint& other) const noexcept {
+                return value < other.value || (value == other.value && isMax && !other.isMax);
+            }
+        };
+
+        void Rebuild(const std::vector<std::unique_ptr<ComponentBase>>& componentList);
+        // False when it ran over its swap budget, leaving the pairs to a Rebuild.
+        bool Resort(int axis);
+        void UpdatePair(std::uint32_t first, std::uint32_t second);
+        bool Overlaps(std::uint32_t first, std::uint32_t second) const noexcept;
+        static std::uint64_t PairKey(std::uint32_t first, std::uint32_t second) noexcept;
+
+        std::optional<std::uint64_t> m_scannedVersion;
+        std::vector<Box> m_boxes;
+        std::array<std::vector<Endpoint>, 2> m_endpoints;
+        std::unordered_set<std::uint64_t> m_pairs;
+    };
+}
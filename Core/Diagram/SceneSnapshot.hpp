@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Camera.hpp"
+
+namespace Diagram {
+    // What the canvas shows in one frame, copied out of the components on the main thread
+    // so the render thread can tessellate it while the model goes on changing. Everything
+    // is in world space; components leave out what does not intersect the visible area.
+    struct SceneSnapshot {
+        struct Rect {
+            glm::vec2 position{0.0f};
+            glm::vec2 size{0.0f};
+            glm::vec4 fill{0.0f};
+            glm::vec4 border{0.0f};
+            // Range of the snapshot's text.
+            std::uint32_t labelOffset = 0;
+            std::uint32_t labelLength = 0;
+        };
+
+        // `count` consecutive entries of `points` from `first`, with an arrowhead at the end.
+        struct Arrow {
+            std::uint32_t first = 0;
+            std::uint32_t count = 0;
+            glm::vec4 color{0.0f};
+        };
+
+        Camera camera;
+        glm::vec2 screenSize{0.0f};
+        glm::vec2 visibleMin{0.0f};
+        glm::vec2 visibleMax{0.0f};
+        std::vector<Rect> rects;
+        std::vector<Arrow> arrows;
+        std::vector<glm::vec2> points;
+        // The labels of all rects back to back, so copying them keeps to one buffer that
+        // is reused from frame to frame.
+        std::vector<char> text;
+
+        // Empties the snapshot for another frame, keeping the capacity.
+        void Reset(const Camera& newCamera, const glm::vec2 newScreenSize) {
+            camera.data = newCamera.data;
+            screenSize = newScreenSize;
+            visibleMin = camera.ScreenToWorld({0.0f, 0.0f}, screenSize);
+            visibleMax = camera.ScreenToWorld(screenSize, screenSize);
+            rects.clear();
+            arrows.clear();
+            points.clear();
+            text.clear();
+        }
+
+        void AddRect(const glm::vec2 position, const glm::vec2 size, const glm::vec4& fill, const glm::vec4& border, const std::string_view label) {
+            const auto offset = static_cast<std::uint32_t>(text.size());
+            text.insert(text.end(), label.begin(), label.end());
+            rects.push_back({position, size, fill, border, offset, static_cast<std::uint32_t>(label.size())});
+        }
+
+        std::string_view GetLabel(const Rect& rect) const noexcept {
+            return {text.data() + rect.labelOffset, rect.labelLength};
+        }
+
+        bool IsVisible(const glm::vec2 min, const glm::vec2 max) const noexcept {
+            return min.x <= visibleMax.x && visibleMin.x <= max.x && min.y <= visibleMax.y && visibleMin.y <= max.y;
+        }
+    };
+}
@@ -0,0 +1,206 @@
+#include "SearchIndex.hpp"
+#include "Component.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <ranges>
+
+namespace Diagram {
+    namespace {
+        // Joins the indexed fields; it never occurs in a query, so no n-gram spans two fields.
+        constexpr char FIELD_SEPARATOR = '\x1f';
+        // Below this, dead entries are cheaper to skip than to compact away.
+        constexpr std::size_t MIN_COMPACT_DEAD = 1024;
+
+        void AppendLower(std::string& out, const std::string_view text) {
+            for (const char c : text) out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        // Queries of one or two characters have their own postings, so they never fall back
+        // to scanning every entry.
+        constexpr std::size_t MAX_GRAM = 3;
+
+        // The length goes in the top byte, so n-grams of different lengths never share a key.
+        std::uint32_t NGram(const std::string_view text, const std::size_t at, const std::size_t length) noexcept {
+            std::uint32_t key = static_cast<std::uint32_t>(length) << 24;
+            for (std::size_t i = 0; i < length; ++i) key |= static_cast<std::uint32_t>(static_cast<unsigned char>(text[at + i])) << (8 * (length - 1 - i));
+            return key;
+        }
+
+        std::string ComponentText(const ComponentBase& component) {
+            std::string text;
+            AppendLower(text, component.id);
+            text += FIELD_SEPARATOR;
+            AppendLower(text, component.GetDisplayName());
+            return text;
+        }
+
+        std::string LazyComponentText(const LazyComponent& component) {
+            std::string text;
+            AppendLower(text, component.id);
+            text += FIELD_SEPARATOR;
+            AppendLower(text, component.displayName);
+            return text;
+        }
+
+        std::string GroupText(const std::string& groupId, const std::string& name) {
+            std::string text;
+            AppendLower(text, name);
+            text += FIELD_SEPARATOR;
+            AppendLower(text, groupId);
+            return text;
+        }
+    }
+
+    void SearchIndex::Sync(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupMap<std::string>& groupParents, const GroupMap<std::string>& groupNames, const std::map<std::string, LazyComponentList>& unbuiltGroups) {
+        ++generation;
+
+        for (const auto& component : componentList) {
+            const auto it = componentEntries.find(component.get());
+            if (it != componentEntries.end()) {
+                auto& entry = entries[it->second];
+                entry.generation = generation;
+                if (entry.revision == component->GetRevision()) continue;
+
+                // Most revisions are moves and restyles; only a changed text is re-indexed.
+                std::string text = ComponentText(*component);
+                entry.revision = component->GetRevision();
+                if (text == entry.text) continue;
+                Kill(it->second);
+                it->second = Add({component.get(), {}, std::move(text), component->GetRevision(), generation});
+            } else {
+                componentEntries.emplace(component.get(), Add({component.get(), {}, ComponentText(*component), component->GetRevision(), generation}));
+            }
+        }
+
+        for (const auto& groupId : groupParents | std::views::keys) {
+            const auto it = groupEntries.find(groupId);
+            const auto name = groupNames.find(groupId);
+            std::string text = GroupText(groupId, name != groupNames.end() ? name->second : std::string());
+            if (it != groupEntries.end()) {
+                entries[it->second].generation = generation;
+                if (entries[it->second].text == text) continue;
+                Kill(it->second);
+                it->second = Add({nullptr, groupId, std::move(text), 0, generation});
+            } else {
+                groupEntries.emplace(groupId, Add({nullptr, groupId, std::move(text), 0, generation}));
+            }
+        }
+
+        for (const auto& [groupId, components] : unbuiltGroups) {
+            auto& group = unbuiltGroupEntries[groupId];
+            group.generation = generation;
+            if (group.components == components) continue;
+
+            for (const std::uint32_t entryIndex : group.entryIndices) Kill(entryIndex);
+            group.entryIndices.clear();
+            group.components = components;
+            if (!components) continue;
+            for (const auto& component : *components) {
+                Entry entry {nullptr, groupId, LazyComponentText(component), 0, generation};
+                entry.isUnbuilt = true;
+                group.entryIndices.push_back(Add(std::move(entry)));
+            }
+        }
+
+        // Whatever was not seen is gone. Removed components are never dereferenced here.
+        std::erase_if(componentEntries, [this](const auto& item) {
+            if (entries[item.second].generation == generation) return false;
+            Kill(item.second);
+            return true;
+        });
+        std::erase_if(groupEntries, [this](const auto& item) {
+            if (entries[item.second].generation == generation) return false;
+            Kill(item.second);
+            return true;
+        });
+        // A built group's components come through componentList from now on.
+        std::erase_if(unbuiltGroupEntries, [this](const auto& item) {
+            if (item.second.generation == generation) return false;
+            for (const std::uint32_t entryIndex : item.second.entryIndices) Kill(entryIndex);
+            return true;
+        });
+
+        if (deadCount >= MIN_COMPACT_DEAD && deadCount * 2 > entries.size()) Compact();
+    }
+
+    bool SearchIndex::Find(const std::string_view query, std::vector<Match>& results, const std::size_t limit) const {
+        results.clear();
+        if (query.empty()) return false;
+
+        std::string needle;
+        AppendLower(needle, query);
+
+        const auto collect = [&](const std::uint32_t entryIndex) {
+            const auto& entry = entries[entryIndex];
+            if (!entry.isAlive || entry.text.find(needle) == std::string::npos) return;
+            results.push_back({entry.component, entry.component ? nullptr : &entry.groupId, entry.isUnbuilt});
+        };
+
+        // Every match holds all n-grams of the query, so the shortest list has them all.
+        const std::size_t length = std::min(needle.size(), MAX_GRAM);
+        const std::vector<std::uint32_t>* candidates = nullptr;
+        for (std::size_t i = 0; i + length <= needle.size(); ++i) {
+            const auto it = postings.find(NGram(needle, i, length));
+            if (it == postings.end()) return false;
+            if (!candidates || it->second.size() < candidates->size()) candidates = &it->second;
+        }
+        // One past the limit tells a full page from a cut-off one.
+        for (const std::uint32_t entryIndex : *candidates) {
+            collect(entryIndex);
+            if (results.size() > limit) {
+                results.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint32_t SearchIndex::Add(Entry entry) {
+        const auto entryIndex = static_cast<std::uint32_t>(entries.size());
+        for (std::size_t length = 1; length <= MAX_GRAM; ++length) {
+            for (std::size_t i = 0; i + length <= entry.text.size(); ++i) {
+                auto& list = postings[NGram(entry.text, i, length)];
+                // An entry's n-grams are added together, so a repeat is always at the back.
+                if (list.empty() || list.back() != entryIndex) list.push_back(entryIndex);
+            }
+        }
+        entries.push_back(std::move(entry));
+        return entryIndex;
+    }
+
+    void SearchIndex::Kill(const std::uint32_t entryIndex) noexcept {
+        auto& entry = entries[entryIndex];
+        if (!entry.isAlive) return;
+        entry.isAlive = false;
+        entry.component = nullptr;
+        ++deadCount;
+    }
+
+    void SearchIndex::Compact() {
+        std::vector<Entry> alive;
+        alive.reserve(entries.size() - deadCount);
+        for (auto& entry : entries) {
+            if (entry.isAlive) alive.push_back(std::move(entry));
+        }
+
+        entries.clear();
+        postings.clear();
+        componentEntries.clear();
+        groupEntries.clear();
+        // The lists stay, so unchanged unbuilt groups are not re-indexed on the next Sync.
+        for (auto& group : unbuiltGroupEntries | std::views::values) group.entryIndices.clear();
+        deadCount = 0;
+
+        for (auto& entry : alive) {
+            const bool isComponent = entry.component != nullptr;
+            const bool isUnbuilt = entry.isUnbuilt;
+            auto* component = entry.component;
+            std::string groupId = entry.groupId;
+            const std::uint32_t entryIndex = Add(std::move(entry));
+            if (isComponent) componentEntries.emplace(component, entryIndex);
+            else if (isUnbuilt) unbuiltGroupEntries[groupId].entryIndices.push_back(entryIndex);
+            else groupEntries.emplace(std::move(groupId), entryIndex);
+        }
+    }
+}
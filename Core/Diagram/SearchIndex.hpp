@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "GroupMap.hpp"
+
+namespace Diagram {
+    class ComponentBase;
+
+    // A component of a group that is not built yet, as read from the document.
+    struct LazyComponent {
+        std::string id;
+        std::string displayName;
+    };
+
+    // Shared with the group that holds them, so syncing an unchanged group is a pointer
+    // comparison.
+    using LazyComponentList = std::shared_ptr<const std::vector<LazyComponent>>;
+
+    // Case-insensitive substring search over component ids and display names and group
+    // names, backed by an index of every substring of up to three characters. Sync only
+    // re-indexes components whose revision moved; a query scans the shortest posting list
+    // of its substrings of that length, never every entry.
+    class SearchIndex {
+    public:
+        struct Match {
+            ComponentBase* component = nullptr;
+            const std::string* groupId = nullptr;
+            // The component is inside `groupId`, which has to be built to show it.
+            bool isUnbuilt = false;
+        };
+
+        static constexpr std::size_t MAX_RESULTS = 1000;
+
+        // Groups are indexed by id and, where they have one, by name. Components of groups
+        // that are not built yet are indexed like built ones and match as their group.
+        void Sync(const std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupMap<std::string>& groupParents, const GroupMap<std::string>& groupNames, const std::map<std::string, LazyComponentList>& unbuiltGroups);
+        // Results come in indexing order; the search stops after `limit` of them and returns
+        // true when more entries match. They stay valid until the next Sync.
+        bool Find(std::string_view query, std::vector<Match>& results, std::size_t limit = MAX_RESULTS) const;
+
+        std::size_t GetEntryCount() const noexcept { return entries.size() - deadCount; }
+
+    private:
+        struct Entry {
+            ComponentBase* component = nullptr;
+            std::string groupId;
+            std::string text;
+            std::uint64_t revision = 0;
+            std::uint64_t generation = 0;
+            bool isAlive = true;
+            bool isUnbuilt = false;
+        };
+
+        struct UnbuiltGroup {
+            LazyComponentList components;
+            std::vector<std::uint32_t> entryIndices;
+            std::uint64_t generation = 0;
+        };
+
+        std::uint32_t Add(Entry entry);
+        void Kill(std::uint32_t entryIndex) noexcept;
+        void Compact();
+
+        std::vector<Entry> entries;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings;
+        std::unordered_map<const ComponentBase*, std::uint32_t> componentEntries;
+        std::unordered_map<std::string, std::uint32_t> groupEntries;
+        std::unordered_map<std::string, UnbuiltGroup> unbuiltGroupEntries;
+        std::uint64_t generation = 0;
+        std::size_t deadCount = 0;
+    };
+}
@@ -1,19 +1,44 @@
 #include "TreeRenderer.hpp"
 #include "Component.hpp"
 #include "Block.hpp"
+#include "Connector.hpp"
 #include "imgui.h"
 #include <algorithm>
+#include <charconv>
 #include <cstring>
+#include <utility>
+#include "../Utils/FrameArena.hpp"
 #include "../Utils/IconsFontAwesome5.h"
 #include "../Utils/Notification.hpp"
+#include "../Main/DiagramData.hpp"
 #include <imgui_internal.h>
+#include <memory_resource>
+#include <optional>
 #include <ranges>
+#include <string_view>
 
 namespace Diagram {
     TreeRenderer::GroupState TreeRenderer::s_groups;
+    std::unique_ptr<TreeRenderer::TreeNode> TreeRenderer::s_hierarchy;
+    std::pmr::unordered_map<const ComponentBase*, TreeRenderer::TreeNode*> TreeRenderer::s_componentNodes{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Hierarchy)};
+    std::pmr::unordered_map<std::string_view, TreeRenderer::TreeNode*> TreeRenderer::s_groupNodes{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Hierarchy)};
+    std::uint64_t TreeRenderer::s_hierarchyVersion = 0;
+    std::size_t TreeRenderer::s_hierarchyComponentCount = 0;
+    std::vector<TreeRenderer::TreeRow> TreeRenderer::s_rows;
+    const TreeRenderer::TreeNode* TreeRenderer::s_draggedNode = nullptr;
+    TreeRenderer::Search TreeRenderer::s_search;
 
-    void TreeRenderer::RenderComponentTree(std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupState& config) noexcept {
-        s_groups = config;
+    void TreeRenderer::RenderComponentTree(std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupState& config, const std::uint64_t structureVersion) noexcept {
+        // Everything that reshapes the tree bumps the version; the count is a cheap guard
+        // against a list edited behind its back.
+        if (!s_hierarchy || structureVersion != s_hierarchyVersion || componentList.size() != s_hierarchyComponentCount) {
+            s_groups = config;
+            s_hierarchy = BuildHierarchy(componentList);
+            s_hierarchyVersion = structureVersion;
+            s_hierarchyComponentCount = componentList.size();
+            s_draggedNode = nullptr;
+            s_search.isRowsStale = true;
+        }
         
         ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.2f, 0.2f, 0.2f, 0.3f));
         ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.25f, 0.25f, 0.25f, 0.3f));
@@ -25,15 +50,50 @@ namespace Diagram {
             return;
         }
 
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        if (ImGui::InputTextWithHint("##search", ICON_FA_SEARCH "  Search ids, labels and groups", s_search.query, sizeof(s_search.query))) {
+            s_search.isRowsStale = true;
+        }
+        const bool isSubmitted = ImGui::IsItemDeactivated() && ImGui::IsKeyPressed(ImGuiKey_Enter);
+        if (s_search.isRowsStale) RefreshRows(componentList);
+
+        const bool isSearching = s_search.query[0] != '\0';
+        if (isSearching) {
+            // Components of groups that are not built yet count one by one, like built ones.
+            ImGui::TextDisabled("%zu%s matches", s_search.results.size(), s_search.isTruncated ? "+" : "");
+            // Enter jumps to the first matching component, or builds the first group that
+            // holds one.
+            if (isSubmitted) {
+                const auto first = std::ranges::find_if(s_rows, [](const TreeRow& row) { return row.node->component && s_search.components.contains(row.node->component); });
+                if (first != s_rows.end()) {
+                    ComponentBase::Select(first->node->component);
+                    FocusComponent(*first->node->component);
+                } else if (const auto unbuilt = std::ranges::find_if(s_rows, [](const TreeRow& row) { return row.node->isGroup && s_search.unbuiltGroups.contains(row.node->groupId); }); unbuilt != s_rows.end()) {
+                    LoadGroup(unbuilt->node->groupId);
+                }
+            }
+        }
+
         if (ImGui::BeginTable("TreeTable", 2, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_NoPadInnerX)) {
             ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
             ImGui::TableSetupColumn("Actions", ImGuiTableColumnFlags_WidthFixed, 48.0f);
             
-            auto hierarchy = BuildHierarchy(componentList);
-            if (hierarchy) {
-                std::string hoveredRowId;
-                RenderTreeNode(*hierarchy, &componentList, 0, hoveredRowId);
+            // Only the rows inside the scroll viewport are submitted. Expanding or collapsing
+            // is applied after the loop so the row list stays put while it is walked.
+            const TreeNode* hoveredRow = nullptr;
+            std::optional<std::pair<std::size_t, bool>> toggle;
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(s_rows.size()));
+            // A drag source that stops being submitted loses its preview tooltip.
+            if (const auto draggedRow = FindDraggedRow()) clipper.IncludeItemByIndex(static_cast<int>(*draggedRow));
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    RenderRow(static_cast<std::size_t>(row), &componentList, hoveredRow, toggle);
+                }
             }
+            clipper.End();
+            // Search results always show their whole path, so there is nothing to toggle.
+            if (toggle && !isSearching) SetExpanded(toggle->first, toggle->second);
 
             ImGui::EndTable();
         }
@@ -64,22 +124,25 @@ namespace Diagram {
 
         if (auto* block = dynamic_cast<Block*>(s_selected)) {
             block->RenderUI(0);
+        } else if (auto* connector = dynamic_cast<Connector*>(s_selected)) {
+            connector->RenderUI(0);
         }
 
         ImGui::PopStyleVar();
         ImGui::End();
     }
 
-    void TreeRenderer::RenderTreeNode(const TreeNode& node, std::vector<std::unique_ptr<ComponentBase>>* componentList, const int depth, std::string& hoveredRowId) noexcept {
+    void TreeRenderer::RenderRow(const std::size_t rowIndex, std::vector<std::unique_ptr<ComponentBase>>* componentList, const TreeNode*& hoveredRow, std::optional<std::pair<std::size_t, bool>>& toggle) noexcept {
         static constexpr float TREE_INDENT = 16.0f;
 
-        const char* icon = node.component ? ICON_FA_CUBE : node.isGroup ? ICON_FA_FOLDER : ICON_FA_SITEMAP;
-        const std::string nodeKey = node.name + std::to_string(reinterpret_cast<uintptr_t>(node.component)) + (node.isGroup ? "_group" : "");
-        const bool hasChildren = !node.children.empty();
+        const TreeNode& node = *s_rows[rowIndex].node;
+        const int depth = s_rows[rowIndex].depth;
+        const bool hasChildren = node.hasChildren;
         const bool isSceneRoot = node.name == "Scene" && depth == 0;
-        const bool isExpanded = isSceneRoot || (node.isGroup && s_groups.expanded[node.groupId]);
+        const bool isSearching = s_search.query[0] != '\0';
+        const bool isExpanded = isSearching || IsExpanded(node, depth);
         
-        ImGui::PushID(nodeKey.c_str());
+        ImGui::PushID(node.key.c_str());
         ImGui::TableNextRow();
         ImGui::TableNextColumn();
         
@@ -92,10 +155,7 @@ namespace Diagram {
             ImGui::Text("%s", arrow);
             bool arrowClicked = ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left);
             
-            if (arrowClicked && node.isGroup) {
-                s_groups.expanded[node.groupId] = !isExpanded;
-                if (s_groups.onExpandedChanged) s_groups.onExpandedChanged(s_groups.expanded);
-            }
+            if (arrowClicked && node.isGroup) toggle.emplace(rowIndex, !isExpanded);
             
             ImGui::PopStyleColor();
             ImGui::SameLine(0, 4);
@@ -104,22 +164,23 @@ namespace Diagram {
             ImGui::SameLine(0, 4);
         }
         
-        const std::string displayText = std::string(" ") + icon + "  " + node.name;
         const bool isSelected = node.component && ComponentBase::GetSelected() == node.component;
-        const bool selectableClicked = ImGui::Selectable(displayText.c_str(), isSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap);
+        const bool selectableClicked = ImGui::Selectable(node.displayText.c_str(), isSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap);
         const bool nameHovered = ImGui::IsItemHovered();
         
         if (selectableClicked) {
             if (node.component) ComponentBase::Select(node.component);
             else if (node.isGroup) ComponentBase::ClearSelection();
+            if (node.component && isSearching) FocusComponent(*node.component);
+            if (node.isGroup && isSearching && s_search.unbuiltGroups.contains(node.groupId)) LoadGroup(node.groupId);
         }
         
         if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left) && node.isGroup && hasChildren) {
-            s_groups.expanded[node.groupId] = !isExpanded;
-            if (s_groups.onExpandedChanged) s_groups.onExpandedChanged(s_groups.expanded);
+            toggle.emplace(rowIndex, !isExpanded);
         }
         
         if (ImGui::BeginDragDropSource()) {
+            s_draggedNode = &node;
             if (node.component) {
                 ImGui::SetDragDropPayload("COMPONENT_DND", &node.component, sizeof(void*));
                 ImGui::Text("Moving: %s", node.name.c_str());
@@ -135,23 +196,124 @@ namespace Diagram {
         ImGui::Unindent(static_cast<float>(depth) * TREE_INDENT);
         ImGui::TableNextColumn();
         
-        if (nameHovered) hoveredRowId = nodeKey;
+        if (nameHovered) hoveredRow = &node;
         
         if (node.component) {
-            RenderActionButtons(nodeKey, hoveredRowId, componentList, node.component);
+            RenderActionButtons(node, hoveredRow, componentList, node.component);
         } else if (node.isGroup) {
-            RenderGroupActions(nodeKey, hoveredRowId);
+            RenderGroupActions(node, hoveredRow);
         } else if (isSceneRoot) {
             RenderCenteredIcon(ICON_FA_FOLDER);
         }
         
-        if ((isExpanded || isSceneRoot) && hasChildren) {
-            for (const auto& child : node.children) RenderTreeNode(*child, componentList, depth + 1, hoveredRowId);
-        }
-        
         ImGui::PopID();
     }
 
+    bool TreeRenderer::IsExpanded(const TreeNode& node, const int depth) noexcept {
+        if (depth == 0 && node.name == "Scene") return true;
+        if (!node.isGroup) return false;
+        const auto it = s_groups.expanded.find(node.groupId);
+        return it != s_groups.expanded.end() && it->second;
+    }
+
+    void TreeRenderer::AppendVisibleRows(const TreeNode& node, const int depth, std::vector<TreeRow>& rows) {
+        rows.push_back({&node, depth});
+        if (!node.hasChildren || !IsExpanded(node, depth)) return;
+        for (const auto& child : node.children) AppendVisibleRows(*child, depth + 1, rows);
+    }
+
+    void TreeRenderer::SetExpanded(const std::size_t rowIndex, const bool isExpanded) {
+        const TreeRow row = s_rows[rowIndex];
+        s_groups.expanded[row.node->groupId] = isExpanded;
+
+        // Only the rows of this subtree change; the rest of the list is kept.
+        if (isExpanded) {
+            // Appended, then rotated into place, so no temporary list is needed.
+            const std::size_t end = s_rows.size();
+            for (const auto& child : row.node->children) AppendVisibleRows(*child, row.depth + 1, s_rows);
+            std::rotate(s_rows.begin() + static_cast<std::ptrdiff_t>(rowIndex) + 1, s_rows.begin() + static_cast<std::ptrdiff_t>(end), s_rows.end());
+        } else {
+            const auto first = s_rows.begin() + static_cast<std::ptrdiff_t>(rowIndex) + 1;
+            const auto last = std::find_if(first, s_rows.end(), [&row](const TreeRow& other) { return other.depth <= row.depth; });
+            s_rows.erase(first, last);
+        }
+
+        if (s_groups.onExpandedChanged) s_groups.onExpandedChanged(s_groups.expanded);
+    }
+
+    void TreeRenderer::LoadGroup(const std::string& groupId) {
+        // Expanding a lazy group builds it; the rebuilt tree then shows the matches inside.
+        s_groups.expanded[groupId] = true;
+        if (s_groups.onExpandedChanged) s_groups.onExpandedChanged(s_groups.expanded);
+    }
+
+    void TreeRenderer::RefreshRows(const std::vector<std::unique_ptr<ComponentBase>>& componentList) {
+        s_search.isRowsStale = false;
+        s_rows.clear();
+        s_search.components.clear();
+        s_search.groups.clear();
+        s_search.unbuiltGroups.clear();
+        if (!s_hierarchy) return;
+
+        if (s_search.query[0] == '\0') {
+            AppendVisibleRows(*s_hierarchy, 0, s_rows);
+            return;
+        }
+
+        // The index follows the tree model: it catches up after a structural change or a
+        // relabel.
+        if (!s_search.indexedVersion || *s_search.indexedVersion != s_hierarchyVersion || s_search.isIndexStale) {
+            s_search.index.Sync(componentList, s_groups.parents, s_groups.names, s_groups.unloaded);
+            s_search.indexedVersion = s_hierarchyVersion;
+            s_search.isIndexStale = false;
+        }
+        s_search.isTruncated = s_search.index.Find(s_search.query, s_search.results);
+
+        // Rows are the matches and the paths up to them, so the cost follows the result
+        // count rather than the tree size. The scene root always stays.
+        ++s_search.generation;
+        AppendMatchPath(s_hierarchy.get());
+        for (const auto& match : s_search.results) {
+            if (match.component) {
+                s_search.components.insert(match.component);
+                if (const auto it = s_componentNodes.find(match.component); it != s_componentNodes.end()) AppendMatchPath(it->second);
+            } else {
+                (match.isUnbuilt ? s_search.unbuiltGroups : s_search.groups).insert(*match.groupId);
+                if (const auto it = s_groupNodes.find(*match.groupId); it != s_groupNodes.end()) AppendMatchPath(it->second);
+            }
+        }
+        std::ranges::sort(s_rows, {}, [](const TreeRow& row) { return row.node->order; });
+    }
+
+    void TreeRenderer::AppendMatchPath(TreeNode* node) {
+        // Stops at the first node already in; the rest of its path is too.
+        for (; node && node->searchGeneration != s_search.generation; node = node->parent) {
+            node->searchGeneration = s_search.generation;
+            s_rows.push_back({node, node->depth});
+        }
+    }
+
+    void TreeRenderer::FocusComponent(const ComponentBase& component) noexcept {
+        auto* diagramData = DiagramData::GetInstance();
+        if (!diagramData) return;
+        if (const auto* block = dynamic_cast<const Block*>(&component)) {
+            diagramData->GetCamera().data.position = block->data.position + block->data.size * 0.5f;
+        } else if (const auto* connector = dynamic_cast<const Connector*>(&component); connector && !connector->route.empty()) {
+            diagramData->GetCamera().data.position = connector->route[connector->route.size() / 2];
+        }
+    }
+
+    std::optional<std::size_t> TreeRenderer::FindDraggedRow() noexcept {
+        if (!s_draggedNode) return std::nullopt;
+        if (!ImGui::GetDragDropPayload()) {
+            s_draggedNode = nullptr;
+            return std::nullopt;
+        }
+        const auto it = std::ranges::find(s_rows, s_draggedNode, &TreeRow::node);
+        if (it == s_rows.end()) return std::nullopt;
+        return static_cast<std::size_t>(it - s_rows.begin());
+    }
+
     void TreeRenderer::RenderIconButton(const char* icon, const ImVec2& size, const bool visible, const bool highlighted) noexcept {
         if (!visible) return;
         const ImVec4 color = highlighted ? ImVec4(1.0f, 1.0f, 1.0f, 1.0f) : ImGui::GetStyle().Colors[ImGuiCol_TextDisabled];
@@ -162,7 +324,7 @@ namespace Diagram {
         ImGui::GetWindowDrawList()->AddText(pos, ImGui::GetColorU32(color), icon);
     }
 
-    bool TreeRenderer::SetupActionButtons(const std::string& nodeKey, const std::string& hoveredRowId, const std::vector<const char*>& icons) noexcept {
+    bool TreeRenderer::SetupActionButtons(const TreeNode& node, const TreeNode* hoveredRow, const std::span<const char* const> icons) noexcept {
         constexpr float spacing = 2.0f;
         const float row_height = ImGui::GetFrameHeight();
         
@@ -176,42 +338,43 @@ namespace Diagram {
         const float adjusted_y = ImGui::GetCursorPosY() + (ImGui::GetTextLineHeightWithSpacing() - row_height) * 0.5f - 1.0f;
         ImGui::SetCursorPos(ImVec2(start_x, adjusted_y));
         
-        const std::string popup_id = "popup_" + nodeKey;
-        const bool popupOpen = ImGui::IsPopupOpen(popup_id.c_str());
-        return hoveredRowId == nodeKey || popupOpen;
+        const bool popupOpen = ImGui::IsPopupOpen(node.popupId.c_str());
+        return hoveredRow == &node || popupOpen;
     }
 
-    void TreeRenderer::RenderActionButtons(const std::string& nodeKey, const std::string& hoveredRowId, std::vector<std::unique_ptr<ComponentBase>>* componentList, ComponentBase* component) noexcept {
-        const std::vector<const char*> icons = {ICON_FA_TRASH, ICON_FA_ELLIPSIS_H};
-        const bool visible = SetupActionButtons(nodeKey, hoveredRowId, icons);
+    void TreeRenderer::RenderActionButtons(const TreeNode& node, const TreeNode* hoveredRow, std::vector<std::unique_ptr<ComponentBase>>* componentList, ComponentBase* component) noexcept {
+        static constexpr const char* icons[] = {ICON_FA_TRASH, ICON_FA_ELLIPSIS_H};
+        const bool visible = SetupActionButtons(node, hoveredRow, icons);
         
         if (ImGui::InvisibleButton("##trash", ImVec2(ImGui::CalcTextSize(ICON_FA_TRASH).x + 4, ImGui::GetFrameHeight()))) {
             if (auto it = std::ranges::find_if(*componentList, [&](const auto& c) { return c.get() == component; }); it != componentList->end()) {
                 if (ComponentBase::GetSelected() == component) ComponentBase::ClearSelection();
+                if (auto* journal = DiagramData::GetActiveJournal()) journal->RecordDelete(component->id);
+                if (auto* history = DiagramData::GetActiveHistory()) history->RecordDelete(*it, static_cast<std::size_t>(it - componentList->begin()));
                 componentList->erase(it);
+                MarkStructureChanged();
                 return;
             }
         }
         RenderIconButton(ICON_FA_TRASH, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered());
         
         ImGui::SameLine(0.0f, 2.0f);
-        const std::string popup_id = "popup_" + nodeKey;
         if (ImGui::InvisibleButton("##more", ImVec2(ImGui::CalcTextSize(ICON_FA_ELLIPSIS_H).x + 4, ImGui::GetFrameHeight()))) {
-            ImGui::OpenPopup(popup_id.c_str());
+            ImGui::OpenPopup(node.popupId.c_str());
         }
-        RenderIconButton(ICON_FA_ELLIPSIS_H, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered() || ImGui::IsPopupOpen(popup_id.c_str()));
+        RenderIconButton(ICON_FA_ELLIPSIS_H, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered() || ImGui::IsPopupOpen(node.popupId.c_str()));
         
-        if (ImGui::BeginPopup(popup_id.c_str())) {
-            ImGui::TextDisabled("%s", component->GetDisplayName().c_str());
+        if (ImGui::BeginPopup(node.popupId.c_str())) {
+            ImGui::TextDisabled("%s", node.name.c_str());
             ImGui::Separator();
             ImGui::TextDisabled("No actions implemented");
             ImGui::EndPopup();
         }
     }
 
-    void TreeRenderer::RenderGroupActions(const std::string& nodeKey, const std::string& hoveredRowId) noexcept {
-        const std::vector<const char*> icons = {ICON_FA_PLUS, ICON_FA_ELLIPSIS_H};
-        const bool visible = SetupActionButtons(nodeKey, hoveredRowId, icons);
+    void TreeRenderer::RenderGroupActions(const TreeNode& node, const TreeNode* hoveredRow) noexcept {
+        static constexpr const char* icons[] = {ICON_FA_PLUS, ICON_FA_ELLIPSIS_H};
+        const bool visible = SetupActionButtons(node, hoveredRow, icons);
         
         if (ImGui::InvisibleButton("##add", ImVec2(ImGui::CalcTextSize(ICON_FA_PLUS).x + 4, ImGui::GetFrameHeight()))) {
             // TODO: Add new component to group
@@ -219,13 +382,12 @@ namespace Diagram {
         RenderIconButton(ICON_FA_PLUS, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered());
         
         ImGui::SameLine(0.0f, 2.0f);
-        const std::string popup_id = "popup_" + nodeKey;
         if (ImGui::InvisibleButton("##group_more", ImVec2(ImGui::CalcTextSize(ICON_FA_ELLIPSIS_H).x + 4, ImGui::GetFrameHeight()))) {
-            ImGui::OpenPopup(popup_id.c_str());
+            ImGui::OpenPopup(node.popupId.c_str());
         }
-        RenderIconButton(ICON_FA_ELLIPSIS_H, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered() || ImGui::IsPopupOpen(popup_id.c_str()));
+        RenderIconButton(ICON_FA_ELLIPSIS_H, ImGui::GetItemRectSize(), visible, ImGui::IsItemHovered() || ImGui::IsPopupOpen(node.popupId.c_str()));
         
-        if (ImGui::BeginPopup(popup_id.c_str())) {
+        if (ImGui::BeginPopup(node.popupId.c_str())) {
             ImGui::TextDisabled("Group Actions");
             ImGui::Separator();
             ImGui::TextDisabled("No actions implemented");
@@ -248,19 +410,38 @@ namespace Diagram {
             auto* dragged = static_cast<ComponentBase**>(payload->Data)[0];
             if (!dragged || dragged == node.component) return;
             
+            auto* journal = DiagramData::GetActiveJournal();
+            auto* history = DiagramData::GetActiveHistory();
             if (node.isGroup) {
-                dragged->groupId = node.groupId;
-                Notify::Success("Component moved to group: " + node.name);
+                std::string previousGroupId = std::exchange(dragged->groupId, node.groupId);
+                if (journal) journal->RecordRegroup(dragged->id, dragged->groupId);
+                if (history) history->RecordRegroup(*dragged, std::move(previousGroupId));
+                MarkStructureChanged();
+                Notify::Success(std::string("Component moved to group: ").append(node.name));
             } else if (node.component) {
                 auto draggedIt = std::ranges::find_if(*componentList, [&](const auto& c) { return c.get() == dragged; });
                 auto targetIt = std::ranges::find_if(*componentList, [&](const auto& c) { return c.get() == node.component; });
                 if (draggedIt != componentList->end() && targetIt != componentList->end()) {
                     std::swap(dragged->groupId, node.component->groupId);
                     std::swap(*draggedIt, *targetIt);
+                    if (journal) {
+                        journal->RecordRegroup(dragged->id, dragged->groupId);
+                        journal->RecordRegroup(node.component->id, node.component->groupId);
+                    }
+                    if (history) {
+                        // After the swap each sits where the other was.
+                        const auto draggedIndex = static_cast<std::size_t>(targetIt - componentList->begin());
+                        const auto targetIndex = static_cast<std::size_t>(draggedIt - componentList->begin());
+                        history->RecordSwap(*dragged, draggedIndex, *node.component, targetIndex);
+                    }
+                    MarkStructureChanged();
                     Notify::Success("Components swapped positions and groups");
                 }
             } else if (node.name == "Scene") {
-                dragged->groupId.clear();
+                std::string previousGroupId = std::exchange(dragged->groupId, std::string());
+                if (journal) journal->RecordRegroup(dragged->id, dragged->groupId);
+                if (history) history->RecordRegroup(*dragged, std::move(previousGroupId));
+                MarkStructureChanged();
                 Notify::Success("Component moved to Scene");
             }
         }
@@ -272,7 +453,7 @@ namespace Diagram {
             if (node.isGroup && !IsGroupDescendant(node.groupId, draggedGroupId)) {
                 s_groups.parents[draggedGroupId] = node.groupId;
                 if (s_groups.onGroupsChanged) s_groups.onGroupsChanged(s_groups.parents);
-                Notify::Success("Group moved to: " + node.name);
+                Notify::Success(std::string("Group moved to: ").append(node.name));
             } else if (node.component && !IsGroupDescendant(node.component->groupId, draggedGroupId)) {
                 s_groups.parents[draggedGroupId] = node.component->groupId;
                 if (s_groups.onGroupsChanged) s_groups.onGroupsChanged(s_groups.parents);
@@ -292,22 +473,28 @@ namespace Diagram {
 
     std::unique_ptr<TreeRenderer::TreeNode> TreeRenderer::BuildHierarchy(const std::vector<std::unique_ptr<ComponentBase>>& componentList) noexcept {
         auto root = std::make_unique<TreeNode>("Scene");
-        std::map<std::string, TreeNode*> groupNodes;
-        std::vector<std::unique_ptr<TreeNode>> allGroups;
+        s_componentNodes.clear();
+        s_componentNodes.reserve(componentList.size());
+        s_groupNodes.clear();
+        s_groupNodes.reserve(s_groups.parents.size());
+        // Scratch for this build only.
+        auto& arena = Utils::FrameArena::Instance();
+        std::pmr::vector<std::unique_ptr<TreeNode>> allGroups(&arena);
         
         for (const auto &groupId: s_groups.parents | std::views::keys) {
             auto it = s_groups.names.find(groupId);
             std::string groupName = it != s_groups.names.end() ? it->second : groupId;
             auto groupNode = std::make_unique<TreeNode>(groupName, nullptr, true, groupId);
-            groupNodes[groupId] = groupNode.get();
+            s_groupNodes[groupNode->groupId] = groupNode.get();
             allGroups.push_back(std::move(groupNode));
         }
         
         for (const auto& component : componentList) {
             auto node = std::make_unique<TreeNode>(component->GetDisplayName(), component.get());
+            s_componentNodes.emplace(component.get(), node.get());
             
-            if (!component->groupId.empty() && groupNodes.contains(component->groupId)) {
-                groupNodes[component->groupId]->children.push_back(std::move(node));
+            if (!component->groupId.empty() && s_groupNodes.contains(component->groupId)) {
+                s_groupNodes[component->groupId]->children.push_back(std::move(node));
             } else {
                 root->children.push_back(std::move(node));
             }
@@ -315,16 +502,50 @@ namespace Diagram {
         
         for (auto& groupNode : allGroups) {
             const std::string& parentId = s_groups.parents[groupNode->groupId];
-            if (parentId.empty() || !groupNodes.contains(parentId)) {
+            if (parentId.empty() || !s_groupNodes.contains(parentId)) {
                 root->children.push_back(std::move(groupNode));
             } else {
-                groupNodes[parentId]->children.push_back(std::move(groupNode));
+                s_groupNodes[parentId]->children.push_back(std::move(groupNode));
             }
         }
         
+        std::uint32_t order = 0;
+        FinishNode(*root, nullptr, 0, order);
         return root;
     }
 
+    void TreeRenderer::FinishNode(TreeNode& node, TreeNode* parent, const int depth, std::uint32_t& order) noexcept {
+        FinishRow(node);
+        node.parent = parent;
+        node.depth = depth;
+        node.order = order++;
+        for (const auto& child : node.children) FinishNode(*child, &node, depth + 1, order);
+    }
+
+    void TreeRenderer::FinishRow(TreeNode& node) noexcept {
+        const char* icon = node.component ? ICON_FA_CUBE : node.isGroup ? ICON_FA_FOLDER : ICON_FA_SITEMAP;
+        char address[24];
+        const auto [end, error] = std::to_chars(address, address + sizeof(address), reinterpret_cast<uintptr_t>(node.component));
+        node.key.assign(node.name).append(address, end).append(node.isGroup ? "_group" : "");
+        node.displayText.assign(" ").append(icon).append("  ").append(node.name);
+        node.popupId.assign("popup_").append(node.key);
+        node.hasChildren = !node.children.empty() || (node.isGroup && s_groups.unloaded.contains(node.groupId));
+    }
+
+    void TreeRenderer::Relabel(const ComponentBase& component) noexcept {
+        const auto it = s_componentNodes.find(&component);
+        if (it == s_componentNodes.end()) return;
+        it->second->name.assign(component.GetDisplayName());
+        FinishRow(*it->second);
+        s_search.isIndexStale = true;
+        // Without a query the rows point at the node, which is current already.
+        if (s_search.query[0] != '\0') s_search.isRowsStale = true;
+    }
+
+    void TreeRenderer::MarkStructureChanged() noexcept {
+        if (auto* diagramData = DiagramData::GetInstance()) diagramData->MarkStructureChanged();
+    }
+
     bool TreeRenderer::IsGroupDescendant(const std::string& groupId, const std::string& potentialAncestor) noexcept {
         if (groupId == potentialAncestor) return true;
         if (!s_groups.parents.contains(groupId)) return false;
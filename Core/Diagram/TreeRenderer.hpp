@@ -4,7 +4,18 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <memory_resource>
 #include <functional>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "GroupMap.hpp"
+#include "SearchIndex.hpp"
+#include "../Utils/MemoryAccounting.hpp"
 
 struct ImVec2;
 namespace Diagram {
@@ -16,39 +27,112 @@ namespace Diagram {
     class TreeRenderer {
     public:
         struct GroupState {
-            std::map<std::string, std::string> parents;
-            std::map<std::string, std::string> names;
-            std::map<std::string, bool> expanded;
-            std::function<void(const std::map<std::string, std::string>&)> onGroupsChanged;
-            std::function<void(const std::map<std::string, bool>&)> onExpandedChanged;
+            GroupMap<std::string> parents{GroupMapResource()};
+            GroupMap<std::string> names{GroupMapResource()};
+            GroupMap<bool> expanded{GroupMapResource()};
+            std::function<void(const GroupMap<std::string>&)> onGroupsChanged;
+            std::function<void(const GroupMap<bool>&)> onExpandedChanged;
+            // Components of groups whose subtree is not built yet, for search.
+            std::map<std::string, LazyComponentList> unloaded;
         };
         
-        static void RenderComponentTree(std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupState& config = {}) noexcept;
+        // The tree model is rebuilt only when `structureVersion` differs from the one it was
+        // built for; `config` is taken over at the same time.
+        static void RenderComponentTree(std::vector<std::unique_ptr<ComponentBase>>& componentList, const GroupState& config, std::uint64_t structureVersion) noexcept;
         static void RenderComponentEditor() noexcept;
+        // A component's display name changed: its row is updated in place, as a relabel
+        // leaves the tree's shape alone.
+        static void Relabel(const ComponentBase& component) noexcept;
         
     private:
+        // Nodes and their child lists are charged to the hierarchy in the memory accounting,
+        // the text they carry to strings.
         struct TreeNode {
-            std::string name;
+            std::pmr::string name;
             ComponentBase* component = nullptr;
             bool isGroup = false;
             std::string groupId;
-            std::vector<std::unique_ptr<TreeNode>> children;
+            std::pmr::vector<std::unique_ptr<TreeNode>> children{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Hierarchy)};
+            // Set by FinishNode: search results climb to the root through `parent` and come
+            // back in row order through `order`, the node's place in a pre-order walk.
+            TreeNode* parent = nullptr;
+            std::uint32_t order = 0;
+            int depth = 0;
+            // The search generation whose rows hold this node.
+            std::uint64_t searchGeneration = 0;
 
-            explicit TreeNode(std::string n, ComponentBase* c = nullptr, bool group = false, std::string gId = "") 
-                : name(std::move(n)), component(c), isGroup(group), groupId(std::move(gId)) {}
+            // Row strings, precomputed so drawing a row does not build any.
+            std::pmr::string key{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Strings)};
+            std::pmr::string displayText{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Strings)};
+            std::pmr::string popupId{Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Strings)};
+            bool hasChildren = false;
+
+            explicit TreeNode(std::string_view n, ComponentBase* c = nullptr, bool group = false, std::string gId = "") 
+                : name(n, Utils::MemoryAccounting::GetResource(Utils::MemoryAccounting::Subsystem::Strings)), component(c), isGroup(group), groupId(std::move(gId)) {}
+
+            static void* operator new(const std::size_t bytes) {
+                return Utils::MemoryAccounting::Allocate(Utils::MemoryAccounting::Subsystem::Hierarchy, bytes);
+            }
+            static void operator delete(void* pointer, const std::size_t bytes) noexcept {
+                Utils::MemoryAccounting::Deallocate(Utils::MemoryAccounting::Subsystem::Hierarchy, pointer, bytes);
+            }
         };
         
+        // One visible row of the flattened tree: children of collapsed groups are left out.
+        struct TreeRow {
+            const TreeNode* node = nullptr;
+            int depth = 0;
+        };
+
+        struct Search {
+            char query[128] = "";
+            SearchIndex index;
+            std::optional<std::uint64_t> indexedVersion;
+            std::vector<SearchIndex::Match> results;
+            // Set when the query matched more than the index returns.
+            bool isTruncated = false;
+            std::unordered_set<const ComponentBase*> components;
+            std::unordered_set<std::string> groups;
+            // Groups holding matches that are not built yet; picking one builds it.
+            std::unordered_set<std::string> unbuiltGroups;
+            // Set when the hierarchy or the query changed; the rows are rebuilt from both.
+            bool isRowsStale = true;
+            // Set by a relabel; Sync re-reads the components whose revision moved.
+            bool isIndexStale = false;
+            std::uint64_t generation = 0;
+        };
+
         static GroupState s_groups;
+        static std::unique_ptr<TreeNode> s_hierarchy;
+        static std::pmr::unordered_map<const ComponentBase*, TreeNode*> s_componentNodes;
+        // Keys view the nodes' group ids.
+        static std::pmr::unordered_map<std::string_view, TreeNode*> s_groupNodes;
+        static std::uint64_t s_hierarchyVersion;
+        static std::size_t s_hierarchyComponentCount;
+        static std::vector<TreeRow> s_rows;
+        static const TreeNode* s_draggedNode;
+        static Search s_search;
         
-        static void RenderTreeNode(const TreeNode& node, std::vector<std::unique_ptr<ComponentBase>>* componentList, int depth, std::string& hoveredRowId) noexcept;
+        static void RenderRow(std::size_t rowIndex, std::vector<std::unique_ptr<ComponentBase>>* componentList, const TreeNode*& hoveredRow, std::optional<std::pair<std::size_t, bool>>& toggle) noexcept;
+        static bool IsExpanded(const TreeNode& node, int depth) noexcept;
+        static void AppendVisibleRows(const TreeNode& node, int depth, std::vector<TreeRow>& rows);
+        static void SetExpanded(std::size_t rowIndex, bool isExpanded);
+        static void LoadGroup(const std::string& groupId);
+        static std::optional<std::size_t> FindDraggedRow() noexcept;
+        static void RefreshRows(const std::vector<std::unique_ptr<ComponentBase>>& componentList);
+        static void AppendMatchPath(TreeNode* node);
+        static void FocusComponent(const ComponentBase& component) noexcept;
         static std::unique_ptr<TreeNode> BuildHierarchy(const std::vector<std::unique_ptr<ComponentBase>>& componentList) noexcept;
+        static void FinishNode(TreeNode& node, TreeNode* parent, int depth, std::uint32_t& order) noexcept;
+        static void FinishRow(TreeNode& node) noexcept;
         static bool IsGroupDescendant(const std::string& groupId, const std::string& potentialAncestor) noexcept;
+        static void MarkStructureChanged() noexcept;
         
-        static void RenderActionButtons(const std::string& nodeKey, const std::string& hoveredRowId, std::vector<std::unique_ptr<ComponentBase>>* componentList, ComponentBase* component) noexcept;
-        static void RenderGroupActions(const std::string& nodeKey, const std::string& hoveredRowId) noexcept;
+        static void RenderActionButtons(const TreeNode& node, const TreeNode* hoveredRow, std::vector<std::unique_ptr<ComponentBase>>* componentList, ComponentBase* component) noexcept;
+        static void RenderGroupActions(const TreeNode& node, const TreeNode* hoveredRow) noexcept;
         static void RenderCenteredIcon(const char* icon) noexcept;
         static void RenderIconButton(const char* icon, const ImVec2& size, bool visible, bool highlighted) noexcept;
-        static bool SetupActionButtons(const std::string& nodeKey, const std::string& hoveredRowId, const std::vector<const char*>& icons) noexcept;
+        static bool SetupActionButtons(const TreeNode& node, const TreeNode* hoveredRow, std::span<const char* const> icons) noexcept;
         
         static void HandleDragDrop(const TreeNode& node, std::vector<std::unique_ptr<ComponentBase>>* componentList) noexcept;
     };
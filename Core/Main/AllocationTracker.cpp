@@ -0,0 +1,231 @@
+#include "AllocationTracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+#if defined(NEGENTROPY_TRACK_ALLOCATIONS) && (defined(__GLIBC__) || defined(__APPLE__))
+#define NEGENTROPY_HAS_BACKTRACE
+#include <cxxabi.h>
+#include <execinfo.h>
+#endif
+
+namespace {
+	using Phase = AllocationTracker::Phase;
+	using CallSite = AllocationTracker::CallSite;
+
+	constexpr std::size_t Index(const Phase phase) noexcept { return static_cast<std::size_t>(phase); }
+
+	// Everything here is constant-initialized, since the hooks below run before any
+	// dynamic initializer and after every destructor.
+	constinit thread_local Phase t_phase = Phase::None;
+	constinit std::atomic<std::uint64_t> s_counts[AllocationTracker::PHASE_COUNT] {};
+	constinit std::atomic<std::uint64_t> s_frameBytes = 0;
+	constinit AllocationTracker::FrameStats s_lastFrame {};
+
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+	// Stacks go into a fixed table, as the hook may not allocate itself.
+	constexpr std::size_t CALL_SITE_SLOTS = 1024;
+	// Record and the operator new calling it; the helpers in between are always inlined.
+	constexpr int SKIPPED_FRAMES = 2;
+
+	struct Slot {
+		std::uint64_t hash = 0;
+		CallSite site;
+	};
+
+	constinit std::atomic<std::uint32_t> s_samplePeriod = AllocationTracker::DEFAULT_SAMPLE_PERIOD;
+	constinit thread_local std::uint32_t t_sampleCounter = 0;
+	// Set while the hook itself runs, as backtrace may allocate on first use.
+	constinit thread_local bool t_isInHook = false;
+	constinit std::atomic_flag s_callSiteLock {};
+	constinit Slot s_callSites[CALL_SITE_SLOTS] {};
+
+	class CallSiteLock {
+	public:
+		CallSiteLock() noexcept { while(s_callSiteLock.test_and_set(std::memory_order_acquire)) {} }
+		~CallSiteLock() { s_callSiteLock.clear(std::memory_order_release); }
+	};
+
+	void AddCallSite(void* const* frames, const std::size_t depth, const std::size_t bytes) noexcept {
+		// FNV-1a over the return addresses; 0 marks a free slot.
+		std::uint64_t hash = 14695981039346656037ull;
+		for(std::size_t i = 0; i < depth; ++i) hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[i])) * 1099511628211ull;
+		hash = std::max<std::uint64_t>(hash, 1);
+
+		const CallSiteLock lock;
+		for(std::size_t probe = 0; probe < CALL_SITE_SLOTS; ++probe) {
+			auto& slot = s_callSites[(hash + probe) % CALL_SITE_SLOTS];
+			if(slot.hash == 0) {
+				slot.hash = hash;
+				std::copy_n(frames, depth, slot.site.frames.begin());
+				slot.site.depth = depth;
+			}
+			else if(slot.hash != hash) continue;
+			++slot.site.count;
+			slot.site.bytes += bytes;
+			return;
+		}
+		// A full table drops the sample.
+	}
+
+	[[gnu::noinline]] void Record(const std::size_t bytes) noexcept {
+		if(t_isInHook) return;
+		const Phase phase = t_phase;
+		s_counts[Index(phase)].fetch_add(1, std::memory_order_relaxed);
+		if(phase == Phase::None) return;
+		s_frameBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+		const std::uint32_t period = s_samplePeriod.load(std::memory_order_relaxed);
+		if(period == 0 || ++t_sampleCounter % period != 0) return;
+#ifdef NEGENTROPY_HAS_BACKTRACE
+		t_isInHook = true;
+		void* frames[AllocationTracker::STACK_DEPTH + SKIPPED_FRAMES];
+		const int depth = backtrace(frames, static_cast<int>(std::size(frames)));
+		if(depth > SKIPPED_FRAMES) AddCallSite(frames + SKIPPED_FRAMES, static_cast<std::size_t>(depth - SKIPPED_FRAMES), bytes);
+		t_isInHook = false;
+#endif
+	}
+
+	[[gnu::always_inline]] inline void* Allocate(const std::size_t bytes) noexcept {
+		Record(bytes);
+		return std::malloc(bytes == 0 ? 1 : bytes);
+	}
+
+	[[gnu::always_inline]] inline void* AllocateAligned(const std::size_t bytes, const std::align_val_t alignment) noexcept {
+		Record(bytes);
+		const auto align = static_cast<std::size_t>(alignment);
+		// aligned_alloc wants a multiple of the alignment.
+		return std::aligned_alloc(align, (std::max<std::size_t>(bytes, 1) + align - 1) / align * align);
+	}
+
+	[[gnu::always_inline]] inline void* AllocateOrThrow(const std::size_t bytes) {
+		void* pointer = Allocate(bytes);
+		if(!pointer) throw std::bad_alloc();
+		return pointer;
+	}
+
+	[[gnu::always_inline]] inline void* AllocateAlignedOrThrow(const std::size_t bytes, const std::align_val_t alignment) {
+		void* pointer = AllocateAligned(bytes, alignment);
+		if(!pointer) throw std::bad_alloc();
+		return pointer;
+	}
+#endif
+}
+
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+// Replaces every form of the global allocation functions, so that each heap allocation of
+// the program passes through Record. Frees are not counted.
+void* operator new(const std::size_t bytes) { return AllocateOrThrow(bytes); }
+void* operator new[](const std::size_t bytes) { return AllocateOrThrow(bytes); }
+void* operator new(const std::size_t bytes, const std::nothrow_t&) noexcept { return Allocate(bytes); }
+void* operator new[](const std::size_t bytes, const std::nothrow_t&) noexcept { return Allocate(bytes); }
+void* operator new(const std::size_t bytes, const std::align_val_t alignment) { return AllocateAlignedOrThrow(bytes, alignment); }
+void* operator new[](const std::size_t bytes, const std::align_val_t alignment) { return AllocateAlignedOrThrow(bytes, alignment); }
+void* operator new(const std::size_t bytes, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(bytes, alignment); }
+void* operator new[](const std::size_t bytes, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return AllocateAligned(bytes, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { std::free(pointer); }
+#endif
+
+AllocationTracker::Scope::Scope(const Phase phase) noexcept : previous(t_phase) {
+	t_phase = phase;
+}
+
+AllocationTracker::Scope::~Scope() {
+	t_phase = previous;
+}
+
+const char* AllocationTracker::GetName(const Phase phase) noexcept {
+	static constexpr const char* names[PHASE_COUNT] = {"None", "Other", "Events", "Update", "UI", "Render", "Tessellate"};
+	return names[Index(phase)];
+}
+
+void AllocationTracker::SetThreadPhase(const Phase phase) noexcept {
+	t_phase = phase;
+}
+
+void AllocationTracker::EndFrame() noexcept {
+	// None is not part of a frame and keeps counting up.
+	for(std::size_t index = 1; index < PHASE_COUNT; ++index) s_lastFrame.allocations[index] = s_counts[index].exchange(0, std::memory_order_relaxed);
+	s_lastFrame.bytes = s_frameBytes.exchange(0, std::memory_order_relaxed);
+}
+
+const AllocationTracker::FrameStats& AllocationTracker::GetLastFrame() noexcept {
+	return s_lastFrame;
+}
+
+std::uint64_t AllocationTracker::GetUntrackedCount() noexcept {
+	return s_counts[Index(Phase::None)].load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::SetSamplePeriod([[maybe_unused]] const std::uint32_t period) noexcept {
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+	s_samplePeriod.store(period, std::memory_order_relaxed);
+#endif
+}
+
+void AllocationTracker::ResetCallSites() noexcept {
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+	const CallSiteLock lock;
+	std::fill(std::begin(s_callSites), std::end(s_callSites), Slot {});
+#endif
+}
+
+std::vector<AllocationTracker::CallSite> AllocationTracker::GetTopCallSites([[maybe_unused]] const std::size_t count) {
+	std::vector<CallSite> sites;
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+	// Reserved up front, so the copy below does not allocate under the lock.
+	sites.reserve(CALL_SITE_SLOTS);
+	{
+		const CallSiteLock lock;
+		for(const auto& slot: s_callSites) {
+			if(slot.hash != 0) sites.push_back(slot.site);
+		}
+	}
+	const std::size_t kept = std::min(count, sites.size());
+	std::partial_sort(sites.begin(), sites.begin() + kept, sites.end(), [](const CallSite& a, const CallSite& b) { return a.count > b.count; });
+	sites.resize(kept);
+#endif
+	return sites;
+}
+
+std::vector<std::string> AllocationTracker::Describe(const CallSite& site) {
+	std::vector<std::string> lines;
+	lines.reserve(site.depth);
+#ifdef NEGENTROPY_HAS_BACKTRACE
+	char** symbols = backtrace_symbols(site.frames.data(), static_cast<int>(site.depth));
+	for(std::size_t i = 0; i < site.depth; ++i) {
+		std::string line = symbols ? symbols[i] : "?";
+		// glibc writes "binary(mangled+offset) [address]"; the name is only there for
+		// exported symbols.
+		const std::size_t open = line.find('(');
+		const std::size_t plus = line.find('+', open);
+		if(open != std::string::npos && plus != std::string::npos && plus > open + 1) {
+			const std::string mangled = line.substr(open + 1, plus - open - 1);
+			int status = 0;
+			char* demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+			if(status == 0 && demangled) line.replace(open + 1, plus - open - 1, demangled);
+			std::free(demangled);
+		}
+		lines.push_back(std::move(line));
+	}
+	std::free(symbols);
+#else
+	for(std::size_t i = 0; i < site.depth; ++i) lines.emplace_back("?");
+#endif
+	return lines;
+}
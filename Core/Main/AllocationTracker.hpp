@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts heap allocations per frame and per phase of the frame, and samples the call
+// stacks that made them. The counts come from replacing the global operator new, which is
+// only done in builds configured with NEGENTROPY_TRACK_ALLOCATIONS; elsewhere nothing is
+// counted and IS_ENABLED is false. Only threads that were given a phase count toward the
+// frame, which are the main thread and the render thread; loads, previews and jobs
+// allocate at their own pace and are only totalled.
+class AllocationTracker
+{
+public:
+	enum class Phase {
+		// Not counted toward frames.
+		None,
+		// Main thread outside the phases below.
+		Other,
+		Events,
+		Update,
+		UI,
+		Render,
+		// The render thread.
+		Tessellate,
+		Count
+	};
+
+	static constexpr std::size_t PHASE_COUNT = static_cast<std::size_t>(Phase::Count);
+	static constexpr std::size_t STACK_DEPTH = 8;
+	static constexpr std::uint32_t DEFAULT_SAMPLE_PERIOD = 64;
+
+#ifdef NEGENTROPY_TRACK_ALLOCATIONS
+	static constexpr bool IS_ENABLED = true;
+#else
+	static constexpr bool IS_ENABLED = false;
+#endif
+
+	struct FrameStats {
+		std::array<std::uint64_t, PHASE_COUNT> allocations {};
+		std::uint64_t bytes = 0;
+
+		std::uint64_t GetTotal() const noexcept {
+			std::uint64_t total = 0;
+			for(std::size_t index = 1; index < PHASE_COUNT; ++index) total += allocations[index];
+			return total;
+		}
+	};
+
+	struct CallSite {
+		std::array<void*, STACK_DEPTH> frames {};
+		std::size_t depth = 0;
+		std::uint64_t count = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	// Switches the calling thread to `phase` for a scope.
+	class Scope {
+	public:
+		explicit Scope(Phase phase) noexcept;
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Phase previous;
+	};
+
+	static const char* GetName(Phase phase) noexcept;
+
+	// The calling thread's phase until changed; threads start out at None.
+	static void SetThreadPhase(Phase phase) noexcept;
+
+	// Main thread, at the end of a frame: moves the counts into GetLastFrame.
+	static void EndFrame() noexcept;
+	static const FrameStats& GetLastFrame() noexcept;
+	// Allocations by threads without a phase, since startup.
+	static std::uint64_t GetUntrackedCount() noexcept;
+
+	// Records the stack of every `period`th counted allocation; 0 stops sampling.
+	static void SetSamplePeriod(std::uint32_t period) noexcept;
+	static void ResetCallSites() noexcept;
+	// The sampled call sites that allocated most often, most frequent first.
+	static std::vector<CallSite> GetTopCallSites(std::size_t count);
+	// One line per frame, innermost first, symbolized where the platform allows.
+	static std::vector<std::string> Describe(const CallSite& site);
+};
@@ -10,17 +10,118 @@
 #endif
 
 #include <algorithm>
+#include <cstdio>
 #include <filesystem>
+#include <iostream>
+#include <memory_resource>
+#include <nlohmann/json.hpp>
 #include <stdexcept>
+#include <string_view>
 //
+#include "../Diagram/ConnectorRouter.hpp"
 #include "../Diagram/TreeRenderer.hpp"
+#include "../Utils/AtomicFile.hpp"
+#include "../Utils/FrameArena.hpp"
 #include "../Utils/IconsFontAwesome5.h"
+#include "../Utils/MemoryAccounting.hpp"
 #include "../Utils/Notification.hpp"
 #include "../Utils/Path.hpp"
 
 namespace fs = std::filesystem;
 
-Application::Application() {
+namespace {
+	constexpr float FONT_SIZE_BASE = 13.0f;
+	constexpr float FONT_SIZE_ICON = FONT_SIZE_BASE * 2.0f / 3.0f;
+	constexpr float FONT_SIZE_DEFAULT = 14.0f;
+	constexpr int FONT_OVERSAMPLE_H = 3;
+	constexpr int FONT_OVERSAMPLE_V = 2;
+	constexpr ImWchar ICON_FONT_RANGE[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
+	constexpr double MIB = 1024.0 * 1024.0;
+
+	// The allocation check's diagram: blocks on a grid, a group per few rows, and a
+	// connector from every other block to its right neighbour. It is wider than the
+	// window, so panning moves blocks in and out of view. Labels and group names are
+	// longer than any small-string buffer, so a frame that copies one into a std::string
+	// shows up as an allocation.
+	constexpr int CHECK_COLUMNS = 40;
+	constexpr int CHECK_ROWS = 25;
+	constexpr int CHECK_ROWS_PER_GROUP = 5;
+	constexpr float CHECK_SPACING = 40.0f;
+	constexpr int CHECK_WARMUP_FRAMES = 120;
+	constexpr int CHECK_MEASURED_FRAMES = 240;
+	// In world units per frame. Every panning stage goes right for half its frames and
+	// back for the rest, so the warm-up covers the path that is measured.
+	constexpr float CHECK_PAN_STEP = 4.0f;
+	constexpr std::size_t CHECK_CALL_SITES = 10;
+
+	std::string WriteAllocationCheckDiagram() {
+		Diagram::Camera camera;
+		camera.data.position = {CHECK_COLUMNS * CHECK_SPACING * 0.25f, CHECK_ROWS * CHECK_SPACING * 0.5f};
+		camera.data.zoom = 2.0f;
+		const Diagram::Grid grid;
+		Diagram::GroupMap<std::string> groups;
+		Diagram::GroupMap<std::string> groupNames;
+		Diagram::GroupMap<bool> groupExpanded;
+		std::vector<std::unique_ptr<Diagram::ComponentBase>> components;
+		const std::map<std::string, LazyGroup> lazyGroups;
+
+		for(int row = 0; row < CHECK_ROWS; ++row) {
+			const std::string groupId = "rows_" + std::to_string(row / CHECK_ROWS_PER_GROUP);
+			groups[groupId] = "";
+			groupNames[groupId] = "Allocation check rows " + std::to_string(row / CHECK_ROWS_PER_GROUP * CHECK_ROWS_PER_GROUP + 1) + "+";
+			groupExpanded[groupId] = true;
+			for(int column = 0; column < CHECK_COLUMNS; ++column) {
+				const std::string id = "block_" + std::to_string(row) + "_" + std::to_string(column);
+				auto block = std::make_unique<Diagram::Block>();
+				block->id = id;
+				block->groupId = groupId;
+				block->data.position = {column * CHECK_SPACING, row * CHECK_SPACING};
+				block->data.size = {24.0f, 12.0f};
+				block->data.label = "Allocation check block " + std::to_string(row * CHECK_COLUMNS + column);
+				block->data.type = static_cast<Diagram::Block::Type>(column % 4);
+				components.push_back(std::move(block));
+				if(column % 2 != 0) continue;
+
+				auto connector = std::make_unique<Diagram::Connector>();
+				connector->id = "connector_" + std::to_string(row) + "_" + std::to_string(column);
+				connector->groupId = groupId;
+				connector->data.source = id;
+				connector->data.target = "block_" + std::to_string(row) + "_" + std::to_string(column + 1);
+				components.push_back(std::move(connector));
+			}
+		}
+
+		const fs::path path = Utils::GetCachePath() / "allocation-check.xml";
+		std::error_code ignored;
+		fs::create_directories(path.parent_path(), ignored);
+		DiagramWriter writer;
+		std::string error;
+		if(!writer.Write(path.string(), {camera, grid, groups, groupNames, groupExpanded, components, lazyGroups}, error)) {
+			throw std::runtime_error("Cannot write the allocation check diagram: " + error);
+		}
+		return path.string();
+	}
+}
+
+Application::Application(const Options options) : options(options) {
+	AllocationTracker::SetThreadPhase(AllocationTracker::Phase::Other);
+	JobSystem::SetInstance(&jobSystem);
+
+	std::string initialPath = (Utils::GetWorkspacePath() / "Default.xml").string();
+	if(options.allocationBudget) {
+		if(!AllocationTracker::IS_ENABLED) throw std::runtime_error("The allocation check needs a build configured with -DNEGENTROPY_TRACK_ALLOCATIONS=ON");
+		// Headless: the frames still run in full, but nothing is shown.
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		// Stacks are only sampled in measured frames.
+		AllocationTracker::SetSamplePeriod(0);
+		initialPath = WriteAllocationCheckDiagram();
+	}
+
+	// The first document is parsed on a worker while SDL, the window and ImGui come up;
+	// frames are shown with an empty model until the main loop swaps it in.
+	diagramData.LoadAsync(initialPath);
+	DiagramData::SetInstance(&diagramData);
+
 	InitSDL();
 	CreateWindow();
 
@@ -32,26 +133,24 @@ Application::Application() {
 
 	InitializeImGui();
 
-#ifndef __EMSCRIPTEN__
-	spdlog::info("Application initialized successfully");
-#endif
-
 	try {
-		currentFilePath = (Utils::GetWorkspacePath() / "Default.xml").string();
-		diagramData.Load(currentFilePath);
 		RefreshWorkspaceFiles();
-		spdlog::info("Files loaded successfully");
 	} catch (const std::exception& e) {
-		spdlog::warn("Failed to load files: {}", e.what());
-		currentFilePath = "";
+		spdlog::warn("Failed to list workspace files: {}", e.what());
 	}
 
-	DiagramData::SetInstance(&diagramData);
 	SDL_ShowWindow(window);
+	startup.windowShown = std::chrono::steady_clock::now();
+
+#ifndef __EMSCRIPTEN__
+	spdlog::info("Application initialized successfully");
+#endif
 }
 
 Application::~Application() {
 	spdlog::info("Shutting down application...");
+	diagramData.WaitForSave();
+	previewCache.Shutdown();
 
 	ImGui_ImplSDLRenderer2_Shutdown();
 	ImGui_ImplSDL2_Shutdown();
@@ -86,12 +185,152 @@ void Application::MainLoop() {
 	ImGui_ImplSDL2_NewFrame();
 	ImGui::NewFrame();
 
-	ProcessEvents();
+	{
+		const AllocationTracker::Scope phase(AllocationTracker::Phase::Events);
+		jobSystem.RunMainThreadWork();
+		if(Utils::MemoryAccounting::Sample()) diagramData.MeasureStrings();
+		diagramData.PollSave();
+		diagramData.PollReload();
+		if(const auto loadedPath = diagramData.PollLoad()) {
+			currentFilePath = *loadedPath;
+			isReloadPending = false;
+			spdlog::info("Loaded {}", currentFilePath);
+		}
+		PollWorkspace();
+		previewCache.Poll(renderer.GetSDLRenderer());
+		AutosaveIfDue();
+		ProcessEvents();
+	}
+
+	{
+		const AllocationTracker::Scope phase(AllocationTracker::Phase::Update);
+		int windowWidth, windowHeight;
+		SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+		diagramData.MaterializeVisibleGroups({static_cast<float>(windowWidth), static_cast<float>(windowHeight)});
+		layoutCommands.PollAutoLayout();
+		diagramData.UpdateRoutes();
+		layoutCommands.UpdateOverlaps();
+	}
+
 	RenderFrame();
+
+	const auto now = std::chrono::steady_clock::now();
+	if(!startup.firstFrame) startup.firstFrame = now;
+	// The first load ends one way or the other; a failed one leaves the model empty.
+	if(!startup.diagramReady && !diagramData.IsLoading()) startup.diagramReady = now;
+	if(startup.diagramReady && !startup.isReported) ReportStartup();
+
+	AllocationTracker::EndFrame();
+	if(options.allocationBudget) StepAllocationCheck();
+
+	// Whatever this frame took from the arena is dead by now.
+	Utils::FrameArena::Instance().Reset();
+}
+
+void Application::ReportStartup() {
+	startup.isReported = true;
+	const auto milliseconds = [this](const std::optional<std::chrono::steady_clock::time_point>& point) {
+		return point ? std::chrono::duration<double, std::milli>(*point - startup.start).count() : 0.0;
+	};
+	const double windowShown = milliseconds(startup.windowShown);
+	const double firstFrame = milliseconds(startup.firstFrame);
+	const double diagramReady = milliseconds(startup.diagramReady);
+	spdlog::info("Startup: window shown after {:.1f} ms, first frame after {:.1f} ms, diagram ready after {:.1f} ms", windowShown, firstFrame, diagramReady);
+
+	if(!options.isStartupReport) return;
+	const nlohmann::json report = {
+		{"file", currentFilePath},
+		{"componentCount", diagramData.GetComponentList().size()},
+		{"windowShownMs", windowShown},
+		{"firstFrameMs", firstFrame},
+		{"diagramReadyMs", diagramReady}};
+	std::cout << report.dump(1, '\t') << std::endl;
+	isRunning = false;
+}
+
+void Application::StepAllocationCheck() {
+	using Stage = AllocationCheck::Stage;
+	auto& check = allocationCheck;
+	const auto advance = [&check](const Stage stage) {
+		check.stage = stage;
+		check.frame = 0;
+		const bool isMeasured = stage == Stage::Idle || stage == Stage::Panning;
+		AllocationTracker::SetSamplePeriod(isMeasured ? 1 : 0);
+		if(stage == Stage::Idle) AllocationTracker::ResetCallSites();
+	};
+	const auto pan = [this, &check](const int frames) {
+		const float direction = check.frame < frames / 2 ? 1.0f : -1.0f;
+		diagramData.GetCamera().data.position.x += direction * CHECK_PAN_STEP;
+	};
+
+	// Counts the frame that just ended; a pan applies to the next one.
+	const auto& frame = AllocationTracker::GetLastFrame();
+	switch(check.stage) {
+	case Stage::Loading:
+		// Routes are computed over several frames after the load.
+		if(!diagramData.IsLoading() && diagramData.GetRouter().GetPendingCount() == 0) advance(Stage::IdleWarmup);
+		break;
+	case Stage::IdleWarmup:
+		if(++check.frame == CHECK_WARMUP_FRAMES) advance(Stage::Idle);
+		break;
+	case Stage::Idle:
+		check.idle.Add(frame);
+		if(++check.frame == CHECK_MEASURED_FRAMES) advance(Stage::PanningWarmup);
+		break;
+	case Stage::PanningWarmup:
+		pan(CHECK_MEASURED_FRAMES);
+		if(++check.frame == CHECK_MEASURED_FRAMES) advance(Stage::Panning);
+		break;
+	case Stage::Panning:
+		check.panning.Add(frame);
+		pan(CHECK_MEASURED_FRAMES);
+		if(++check.frame == CHECK_MEASURED_FRAMES) ReportAllocationCheck();
+		break;
+	}
 }
 
-void Application::InitializeImGui() const {
+void Application::ReportAllocationCheck() {
+	AllocationTracker::SetSamplePeriod(0);
+	const std::uint64_t budget = *options.allocationBudget;
+	const auto result = [budget](const AllocationCheck::Result& stage) {
+		nlohmann::json phases = nlohmann::json::object();
+		for(std::size_t index = 1; index < AllocationTracker::PHASE_COUNT; ++index) {
+			phases[AllocationTracker::GetName(static_cast<AllocationTracker::Phase>(index))] = stage.worst.allocations[index];
+		}
+		return nlohmann::json {
+			{"frames", stage.frames},
+			{"maxAllocations", stage.worst.GetTotal()},
+			{"meanAllocations", stage.frames ? static_cast<double>(stage.allocations) / stage.frames : 0.0},
+			{"worstFrame", {{"phases", phases}, {"bytes", stage.worst.bytes}}},
+			{"isWithinBudget", stage.worst.GetTotal() <= budget}};
+	};
+	nlohmann::json callSites = nlohmann::json::array();
+	for(const auto& site: AllocationTracker::GetTopCallSites(CHECK_CALL_SITES)) {
+		callSites.push_back({{"count", site.count}, {"bytes", site.bytes}, {"stack", AllocationTracker::Describe(site)}});
+	}
+	const nlohmann::json report = {
+		{"file", currentFilePath},
+		{"componentCount", diagramData.GetComponentList().size()},
+		{"budget", budget},
+		{"idle", result(allocationCheck.idle)},
+		{"panning", result(allocationCheck.panning)},
+		{"untrackedAllocations", AllocationTracker::GetUntrackedCount()},
+		{"topCallSites", callSites}};
+	std::cout << report.dump(1, '\t') << std::endl;
+	isRunning = false;
+
+	const std::uint64_t worst = std::max(allocationCheck.idle.worst.GetTotal(), allocationCheck.panning.worst.GetTotal());
+	if(worst > budget) {
+		throw std::runtime_error("Allocation check failed: a frame made " + std::to_string(worst) + " heap allocations, the budget is " + std::to_string(budget));
+	}
+}
+
+void Application::InitializeImGui() {
 	IMGUI_CHECKVERSION();
+	// Everything ImGui allocates, the font atlas included, is charged to the UI.
+	ImGui::SetAllocatorFunctions(
+		[](const size_t size, void*) { return Utils::MemoryAccounting::AllocateWithHeader(Utils::MemoryAccounting::Subsystem::UI, size); },
+		[](void* pointer, void*) { Utils::MemoryAccounting::DeallocateWithHeader(Utils::MemoryAccounting::Subsystem::UI, pointer); });
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -107,7 +346,7 @@ void Application::InitializeImGui() const {
 #endif
 
 	DarkStyle();
-	SetupFont();
+	SetupFont(fontCache.Wait());
 
 	ImGui_ImplSDL2_InitForSDLRenderer(window, renderer.GetSDLRenderer());
 	ImGui_ImplSDLRenderer2_Init(renderer.GetSDLRenderer());
@@ -135,6 +374,19 @@ void Application::ProcessEvents() noexcept {
 			return;
 		}
 
+		// Text fields keep their own undo while they have the keyboard.
+		if(event.type == SDL_KEYDOWN && (event.key.keysym.mod & KMOD_CTRL) && !ImGui::GetIO().WantCaptureKeyboard) {
+			const bool isShift = event.key.keysym.mod & KMOD_SHIFT;
+			if(event.key.keysym.sym == SDLK_z && !isShift) {
+				diagramData.Undo();
+				continue;
+			}
+			if(event.key.keysym.sym == SDLK_y || (event.key.keysym.sym == SDLK_z && isShift)) {
+				diagramData.Redo();
+				continue;
+			}
+		}
+
 		bool shouldProcessEvent = true;
 		if(event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP || event.type == SDL_MOUSEMOTION || event.type == SDL_MOUSEWHEEL) {
 			shouldProcessEvent = !ImGui::GetIO().WantCaptureMouse;
@@ -152,11 +404,24 @@ void Application::ProcessEvents() noexcept {
 }
 
 void Application::RenderFrame() noexcept {
-	RenderUI();
+	{
+		// The render thread tessellates the canvas while the UI is built.
+		const AllocationTracker::Scope phase(AllocationTracker::Phase::Render);
+		auto& scene = renderThread.BeginScene(diagramData.GetCamera(), renderer.GetOutputSize());
+		for(const auto& item: diagramData.GetComponentList()) item->AppendToScene(scene);
+		renderThread.Publish();
+	}
 
+	{
+		const AllocationTracker::Scope phase(AllocationTracker::Phase::UI);
+		RenderUI();
+	}
+
+	const AllocationTracker::Scope phase(AllocationTracker::Phase::Render);
 	renderer.Clear();
 	renderer.DrawGrid(diagramData.GetCamera(), diagramData.GetGrid());
-	renderer.DrawComponents(diagramData.GetComponentList(), diagramData.GetCamera());
+	renderer.DrawScene(renderThread.Collect());
+	renderer.DrawAlignmentGuides(diagramData.GetCamera(), diagramData.GetAlignmentGuides());
 
 	ImGui::Render();
 	ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer.GetSDLRenderer());
@@ -171,18 +436,15 @@ void Application::RenderUI() noexcept {
 	if(ImGui::BeginMainMenuBar()) {
 		if(ImGui::BeginMenu((ICON_FA_FILE "  File"))) {
 			if(ImGui::BeginMenu((ICON_FA_FOLDER_OPEN "  Load"))) {
-				for(const auto& workspaceFile: workspaceFiles) {
-					std::string menuItem = std::string(ICON_FA_FILE_ALT) + "  " + workspaceFile;
-					if(ImGui::MenuItem(menuItem.c_str())) {
-						currentFilePath = (Utils::GetWorkspacePath() / workspaceFile).string();
-						diagramData.Load(currentFilePath);
-					}
-				}
+				RenderLoadMenu();
 				ImGui::EndMenu();
 			}
 			if(ImGui::MenuItem((ICON_FA_SAVE "  Save"), "Ctrl+S")) {
 				SaveDiagram();
 			}
+			if(bool isLazyLoading = diagramData.IsLazyLoading(); ImGui::MenuItem((ICON_FA_LAYER_GROUP "  Lazy-load Collapsed Groups"), nullptr, &isLazyLoading)) {
+				diagramData.SetLazyLoading(isLazyLoading);
+			}
 			ImGui::Separator();
 			if(ImGui::MenuItem((ICON_FA_TIMES "  Exit"), "Alt+F4")) {
 				isRunning = false;
@@ -191,8 +453,24 @@ void Application::RenderUI() noexcept {
 		}
 
 		if(ImGui::BeginMenu((ICON_FA_EDIT "  Edit"))) {
-			if(ImGui::MenuItem((ICON_FA_UNDO "  Undo"), "Ctrl+Z")) {}
-			if(ImGui::MenuItem((ICON_FA_REDO "  Redo"), "Ctrl+Y")) {}
+			auto& history = diagramData.GetHistory();
+			if(ImGui::MenuItem((ICON_FA_UNDO "  Undo"), "Ctrl+Z", false, history.CanUndo())) {
+				diagramData.Undo();
+			}
+			if(ImGui::MenuItem((ICON_FA_REDO "  Redo"), "Ctrl+Y", false, history.CanRedo())) {
+				diagramData.Redo();
+			}
+			ImGui::Separator();
+			if(!layoutCommands.IsAutoLayoutRunning()) {
+				if(ImGui::MenuItem((ICON_FA_PROJECT_DIAGRAM "  Auto Layout"))) {
+					layoutCommands.StartAutoLayout();
+				}
+			} else if(ImGui::MenuItem((ICON_FA_STOP "  Stop Auto Layout"))) {
+				layoutCommands.StopAutoLayout();
+			}
+			if(ImGui::MenuItem((ICON_FA_EXPAND_ARROWS_ALT "  Resolve Overlaps"), nullptr, false, layoutCommands.GetOverlapDetector().GetOverlapCount() > 0)) {
+				layoutCommands.ResolveOverlaps();
+			}
 			ImGui::EndMenu();
 		}
 
@@ -200,6 +478,7 @@ void Application::RenderUI() noexcept {
 			ImGui::MenuItem((ICON_FA_WRENCH "  Properties"), nullptr, &isShownPropertiesPanel);
 			ImGui::MenuItem((ICON_FA_SITEMAP "  Component Tree"), nullptr, &isShownComponentTreePanel);
 			ImGui::MenuItem((ICON_FA_EDIT "  Component Editor"), nullptr, &isShownComponentEditorPanel);
+			ImGui::MenuItem((ICON_FA_MEMORY "  Memory"), nullptr, &isShownMemoryPanel);
 			ImGui::MenuItem((ICON_FA_MAGIC "  Demo"), nullptr, &isShownDemoPanel);
 			ImGui::EndMenu();
 		}
@@ -214,37 +493,149 @@ void Application::RenderUI() noexcept {
 	}
 
 	if(isShownComponentTreePanel) {
-		auto groupState = diagramData.GetGroupState();
-		groupState.onGroupsChanged = [this](const std::map<std::string, std::string>& groups) {
-			diagramData.UpdateGroups(groups);
-		};
-		groupState.onExpandedChanged = [this](const std::map<std::string, bool>& expanded) {
-			diagramData.UpdateGroupExpanded(expanded);
-		};
-		Diagram::TreeRenderer::RenderComponentTree(diagramData.GetComponentList(), groupState);
+		// The group maps are only copied out when the tree structure changed.
+		const std::uint64_t structureVersion = diagramData.GetStructureVersion();
+		if(!treeGroupStateVersion || *treeGroupStateVersion != structureVersion) {
+			treeGroupState = diagramData.GetGroupState();
+			treeGroupState.onGroupsChanged = [this](const Diagram::GroupMap<std::string>& groups) {
+				diagramData.UpdateGroups(groups);
+			};
+			treeGroupState.onExpandedChanged = [this](const Diagram::GroupMap<bool>& expanded) {
+				diagramData.UpdateGroupExpanded(expanded);
+			};
+			treeGroupStateVersion = structureVersion;
+		}
+		Diagram::TreeRenderer::RenderComponentTree(diagramData.GetComponentList(), treeGroupState, structureVersion);
 	}
 
 	if(isShownComponentEditorPanel) {
 		Diagram::TreeRenderer::RenderComponentEditor();
 	}
 
+	if(isShownMemoryPanel) {
+		RenderMemoryPanel();
+	}
+
 	if(isShownDemoPanel) {
 		ImGui::ShowDemoWindow(&isShownDemoPanel);
 	}
 
+	if(diagramData.IsLoading()) {
+		RenderLoadProgress();
+	}
+
 	Notify::Render();
 }
 
+void Application::RenderLoadProgress() noexcept {
+	const auto* progress = diagramData.GetLoadProgress();
+	const std::string_view loadingPath = *diagramData.GetLoadingPath();
+	// Past the last separator, or all of it when there is none.
+	const std::string_view fileName = loadingPath.substr(loadingPath.find_last_of("/\\") + 1);
+
+	constexpr float PADDING = 10.0f;
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + PADDING, viewport->WorkPos.y + viewport->WorkSize.y - PADDING), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+	ImGui::SetNextWindowBgAlpha(0.9f);
+	if(ImGui::Begin("##LoadProgress", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav)) {
+		const auto bytesRead = progress->bytesRead.load(std::memory_order_relaxed);
+		const auto totalBytes = progress->totalBytes.load(std::memory_order_relaxed);
+		const auto componentsBuilt = progress->componentsBuilt.load(std::memory_order_relaxed);
+
+		ImGui::Text(ICON_FA_SPINNER "  Loading %.*s", static_cast<int>(fileName.size()), fileName.data());
+		char overlay[64];
+		if(totalBytes == 0 || bytesRead < totalBytes) {
+			std::snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", bytesRead / MIB, totalBytes / MIB);
+			ImGui::ProgressBar(totalBytes ? static_cast<float>(bytesRead) / totalBytes : 0.0f, ImVec2(240.0f, 0.0f), overlay);
+		} else {
+			// Parsing has no measurable end; the bar just shows it is alive.
+			std::snprintf(overlay, sizeof(overlay), "%llu components", static_cast<unsigned long long>(componentsBuilt));
+			ImGui::ProgressBar(-1.0f * static_cast<float>(ImGui::GetTime()), ImVec2(240.0f, 0.0f), overlay);
+		}
+		ImGui::SameLine();
+		if(ImGui::Button("Cancel")) {
+			diagramData.CancelLoad();
+		}
+	}
+	ImGui::End();
+}
+
+void Application::RenderLoadMenu() {
+	auto& arena = Utils::FrameArena::Instance();
+	for(const auto& workspaceFile: workspaceFiles) {
+		const auto* preview = previewCache.Find(workspaceFile);
+		std::pmr::string menuItem(ICON_FA_FILE_ALT "  ", &arena);
+		menuItem += workspaceFile;
+		char stats[32] = "...";
+		if(preview) std::snprintf(stats, sizeof(stats), "%zu components", preview->preview.componentCount);
+
+		if(ImGui::MenuItem(menuItem.c_str(), stats)) {
+			diagramData.LoadAsync((Utils::GetWorkspacePath() / workspaceFile).string());
+		}
+
+		if(preview && ImGui::BeginItemTooltip()) {
+			if(preview->texture) {
+				const float scale = 2.0f;
+				ImGui::Image((ImTextureID)(intptr_t)preview->texture, ImVec2(PreviewCache::THUMBNAIL_WIDTH * scale, PreviewCache::THUMBNAIL_HEIGHT * scale));
+			}
+			ImGui::Text("%zu components in %zu groups", preview->preview.componentCount, preview->preview.groupCount);
+			if(preview->preview.hasBounds) {
+				const glm::vec2 extent = preview->preview.boundsMax - preview->preview.boundsMin;
+				ImGui::TextDisabled("%.0f x %.0f at (%.0f, %.0f)", extent.x, extent.y, preview->preview.boundsMin.x, preview->preview.boundsMin.y);
+			}
+			ImGui::EndTooltip();
+		}
+	}
+}
+
 void Application::RenderPropertiesPanel() noexcept {
 	ImGui::Begin("Properties", &isShownPropertiesPanel);
 
 	auto& componentList = diagramData.GetComponentList();
 	auto& camera = diagramData.GetCamera();
 
-	size_t blockCount = diagramData.GetComponentsOfType<Diagram::Block>().size();
+	size_t blockCount = diagramData.CountComponentsOfType<Diagram::Block>();
 
 	ImGui::Text("Camera: (%.1f, %.1f) Zoom: %.2f", camera.data.position.x, camera.data.position.y, camera.data.zoom);
 	ImGui::Text("Blocks: %zu", blockCount);
+	const auto& router = diagramData.GetRouter();
+	ImGui::Text("Connectors: %zu (%zu routes computed, %zu pending)", diagramData.CountComponentsOfType<Diagram::Connector>(), router.GetRoutedCount(), router.GetPendingCount());
+	ImGui::TextDisabled("Shift+click a block to connect the selected one to it");
+	if(const std::size_t overlapCount = layoutCommands.GetOverlapDetector().GetOverlapCount(); overlapCount > 0) {
+		ImGui::Text("Overlapping pairs: %zu", overlapCount);
+		ImGui::SameLine();
+		if(ImGui::SmallButton("Resolve")) layoutCommands.ResolveOverlaps();
+	} else {
+		ImGui::Text("Overlapping pairs: 0");
+	}
+	if(layoutCommands.IsAutoLayoutRunning()) {
+		ImGui::Text("Auto layout: step %zu of %zu", layoutCommands.GetAutoLayout().GetStep(), AutoLayout::MAX_STEPS);
+	}
+
+	auto& history = diagramData.GetHistory();
+	ImGui::Text("History: %zu undo, %zu redo (%.1f KiB)", history.GetUndoCount(), history.GetRedoCount(), history.GetMemoryUsage() / 1024.0);
+	int historyLimit = static_cast<int>(history.GetMemoryLimit() >> 20);
+	if(ImGui::SliderInt("History Limit (MiB)", &historyLimit, 1, 512)) {
+		history.SetMemoryLimit(static_cast<std::size_t>(historyLimit) << 20);
+	}
+
+	ImGui::SeparatorText("Jobs");
+	const auto& workerStats = jobSystem.GetStats();
+	if(workerStats.empty()) ImGui::TextDisabled("No workers; jobs run inline");
+	for(std::size_t index = 0; index < workerStats.size(); ++index) {
+		const auto& stats = workerStats[index];
+		char overlay[64];
+		std::snprintf(overlay, sizeof(overlay), "%.0f%%  %llu jobs, %llu stolen", stats.utilization * 100.0f,
+			static_cast<unsigned long long>(stats.jobCount), static_cast<unsigned long long>(stats.stealCount));
+		ImGui::Text("Worker %zu", index + 1);
+		ImGui::SameLine();
+		ImGui::ProgressBar(stats.utilization, ImVec2(-FLT_MIN, 0.0f), overlay);
+	}
+	const auto& canvasFrame = renderThread.GetLastFrame();
+	ImGui::Text("Canvas: %zu triangles, tessellated in %.2f ms", canvasFrame.indices.size() / 3, static_cast<double>(canvasFrame.elapsed.count()) / 1000.0);
+	const auto& arena = Utils::FrameArena::Instance();
+	ImGui::Text("Frame arena: %zu of %zu KiB (peak %zu)", arena.GetLastFrameBytes() >> 10, arena.GetCapacity() >> 10, arena.GetPeakFrameBytes() >> 10);
+	ImGui::Separator();
 
 	if(ImGui::Button((ICON_FA_PLUS "  [F1] Add Block"))) {
 		diagramData.AddBlock(false, window);
@@ -253,22 +644,156 @@ void Application::RenderPropertiesPanel() noexcept {
 	ImGui::End();
 }
 
+void Application::RenderMemoryPanel() noexcept {
+	ImGui::Begin("Memory", &isShownMemoryPanel);
+
+	using Accounting = Utils::MemoryAccounting;
+	if(ImGui::BeginTable("##subsystems", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+		ImGui::TableSetupColumn("Subsystem");
+		ImGui::TableSetupColumn("Live MiB");
+		ImGui::TableSetupColumn("Peak MiB");
+		ImGui::TableSetupColumn("Allocs/s");
+		ImGui::TableSetupColumn("MiB/s");
+		ImGui::TableHeadersRow();
+		for(std::size_t index = 0; index < Accounting::SUBSYSTEM_COUNT; ++index) {
+			const auto subsystem = static_cast<Accounting::Subsystem>(index);
+			const auto& stats = Accounting::GetStats(subsystem);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(Accounting::GetName(subsystem));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", static_cast<double>(stats.liveBytes) / MIB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", static_cast<double>(stats.peakBytes) / MIB);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.0f", stats.allocationsPerSecond);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", stats.bytesPerSecond / MIB);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::SeparatorText("Pools");
+	const auto& arena = Utils::FrameArena::Instance();
+	ImGui::Text("Frame arena: %.2f MiB reserved, %.2f MiB last frame", static_cast<double>(arena.GetCapacity()) / MIB, static_cast<double>(arena.GetLastFrameBytes()) / MIB);
+	const auto& history = diagramData.GetHistory();
+	ImGui::Text("Undo history: %.2f of %.2f MiB", static_cast<double>(history.GetMemoryUsage()) / MIB, static_cast<double>(history.GetMemoryLimit()) / MIB);
+
+	if constexpr(AllocationTracker::IS_ENABLED) {
+		ImGui::SeparatorText("Heap allocations last frame");
+		const auto& frame = AllocationTracker::GetLastFrame();
+		ImGui::Text("%llu in total, %.1f KiB", static_cast<unsigned long long>(frame.GetTotal()), static_cast<double>(frame.bytes) / 1024.0);
+		for(std::size_t index = 1; index < AllocationTracker::PHASE_COUNT; ++index) {
+			ImGui::BulletText("%s: %llu", AllocationTracker::GetName(static_cast<AllocationTracker::Phase>(index)), static_cast<unsigned long long>(frame.allocations[index]));
+		}
+		if(ImGui::Button((ICON_FA_SEARCH "  Top Call Sites"))) {
+			allocationCallSites.clear();
+			for(auto& site: AllocationTracker::GetTopCallSites(CHECK_CALL_SITES)) {
+				auto lines = AllocationTracker::Describe(site);
+				allocationCallSites.emplace_back(site, std::move(lines));
+			}
+			AllocationTracker::ResetCallSites();
+		}
+		ImGui::SameLine();
+		ImGui::TextDisabled("sampled since the last press");
+		for(std::size_t index = 0; index < allocationCallSites.size(); ++index) {
+			const auto& [site, lines] = allocationCallSites[index];
+			ImGui::PushID(static_cast<int>(index));
+			if(ImGui::TreeNode("##site", "%llu samples, %.1f KiB", static_cast<unsigned long long>(site.count), static_cast<double>(site.bytes) / 1024.0)) {
+				for(const auto& line: lines) ImGui::TextUnformatted(line.c_str());
+				ImGui::TreePop();
+			}
+			ImGui::PopID();
+		}
+	}
+	ImGui::Separator();
+
+	if(ImGui::Button((ICON_FA_FILE_EXPORT "  Export JSON"))) {
+		const fs::path path = Utils::GetCachePath() / "memory.json";
+		std::error_code ignored;
+		fs::create_directories(path.parent_path(), ignored);
+		Utils::AtomicFile file(path);
+		const std::string report = MemoryReport().dump(1, '\t');
+		std::string error;
+		if(file.IsOpen() && std::fputs(report.c_str(), file.Get()) >= 0 && file.Commit(error)) Notify::Success("Memory report written to " + path.string());
+		else Notify::Error("Cannot write memory report: " + (error.empty() ? path.string() : error));
+	}
+	ImGui::SameLine();
+	if(ImGui::Button((ICON_FA_CLIPBOARD "  Copy JSON"))) {
+		ImGui::SetClipboardText(MemoryReport().dump(1, '\t').c_str());
+	}
+
+	ImGui::End();
+}
+
+nlohmann::json Application::MemoryReport() const {
+	using Accounting = Utils::MemoryAccounting;
+	nlohmann::json subsystems = nlohmann::json::array();
+	for(std::size_t index = 0; index < Accounting::SUBSYSTEM_COUNT; ++index) {
+		const auto subsystem = static_cast<Accounting::Subsystem>(index);
+		const auto& stats = Accounting::GetStats(subsystem);
+		subsystems.push_back({
+			{"name", Accounting::GetName(subsystem)},
+			{"liveBytes", stats.liveBytes},
+			{"peakBytes", stats.peakBytes},
+			{"allocationCount", stats.allocationCount},
+			{"allocationsPerSecond", stats.allocationsPerSecond},
+			{"bytesPerSecond", stats.bytesPerSecond}});
+	}
+	const auto& arena = Utils::FrameArena::Instance();
+	const auto& history = diagramData.GetHistory();
+	return {
+		{"subsystems", subsystems},
+		{"frameArena", {{"capacityBytes", arena.GetCapacity()}, {"lastFrameBytes", arena.GetLastFrameBytes()}, {"peakFrameBytes", arena.GetPeakFrameBytes()}}},
+		{"undoHistory", {{"bytes", history.GetMemoryUsage()}, {"limitBytes", history.GetMemoryLimit()}}}};
+}
+
 void Application::SaveDiagram() noexcept {
 	if(!currentFilePath.empty()) {
-		diagramData.Save(currentFilePath);
+		diagramData.SaveAsync(currentFilePath);
 	} else {
 		Notify::Error("No file is currently open to save.");
 	}
 }
 
+void Application::AutosaveIfDue() noexcept {
+	const auto now = std::chrono::steady_clock::now();
+	if(now - lastAutosave < AUTOSAVE_INTERVAL) return;
+	lastAutosave = now;
+
+	if(!currentFilePath.empty() && !diagramData.IsSaving() && diagramData.GetJournal().GetUncompactedCount() > 0) {
+		diagramData.SaveAsync(currentFilePath, true);
+	}
+}
+
+void Application::PollWorkspace() {
+	const auto changes = workspaceWatcher.Poll();
+	if(changes.isListingChanged) RefreshWorkspaceFiles();
+
+	if(!changes.modifiedFiles.empty()) {
+		// Only built when needed, as quiet frames should not allocate.
+		const auto workspacePath = Utils::GetWorkspacePath();
+		for(const auto& fileName: changes.modifiedFiles) {
+			previewCache.Invalidate(fileName);
+			if((workspacePath / fileName).string() == currentFilePath) isReloadPending = true;
+		}
+	}
+
+	if(isReloadPending && !diagramData.IsSaving()) {
+		isReloadPending = false;
+		diagramData.Reload(currentFilePath);
+	}
+}
+
 void Application::RefreshWorkspaceFiles() {
 	workspaceFiles.clear();
 	const auto workspacePath = Utils::GetWorkspacePath();
 	for(const auto& workspaceEntry: fs::directory_iterator(workspacePath)) {
-		if(workspaceEntry.is_regular_file() && workspaceEntry.path().extension() == ".xml") {
+		if(workspaceEntry.is_regular_file() && Utils::IsDiagramDocument(workspaceEntry.path())) {
 			workspaceFiles.push_back(workspaceEntry.path().filename().string());
 		}
 	}
+	std::ranges::sort(workspaceFiles);
 }
 
 void Application::InitSDL() {
@@ -393,91 +918,50 @@ void Application::DarkStyle() noexcept {
 	style.DisplaySafeAreaPadding = ImVec2(3.0f, 3.0f);
 }
 
-void Application::SetupFont() noexcept {
+void Application::SetupFont(const FontCache::Fonts& fonts) noexcept {
 	ImGuiIO& io = ImGui::GetIO();
 
-	constexpr float fontSizeBase = 13.0f;
-	constexpr float fontSizeIcon = fontSizeBase * 2.0f / 3.0f;
-	constexpr float fontSizeDefault = 14.0f;
-
-	bool isFontLoaded = false;
-
-#ifdef __EMSCRIPTEN__
-	// For WASM, first try to load from preloaded assets
-	std::vector<std::string> wasmFontPaths = {
-		"Assets/fonts/LiberationSans-Regular.ttf"
-	};
-	
-	for (const auto& fontPath : wasmFontPaths) {
-		if(std::filesystem::exists(fontPath)) {
-			ImFontConfig fontConfig;
-			fontConfig.OversampleH = 3;
-			fontConfig.OversampleV = 2;
-			fontConfig.PixelSnapH = true;
-			io.Fonts->AddFontFromFileTTF(fontPath.c_str(), fontSizeBase, &fontConfig);
-			isFontLoaded = true;
-			spdlog::info("Font loaded from: {}", fontPath);
-			break;
-		}
-	}
-#else
-	// For native builds, try system fonts
-	constexpr const char* fontPathGeneralList[] = {
-		"/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
-		"/usr/share/fonts/TTF/arial.ttf",
-		"/System/Library/Fonts/Helvetica.ttc",
-		"/Windows/Fonts/arial.ttf",
-		"/Windows/Fonts/segoeui.ttf"};
-
-	for(const char* fontPathGeneral: fontPathGeneralList) {
-		if(std::filesystem::exists(fontPathGeneral)) {
-			ImFontConfig fontConfig;
-			fontConfig.OversampleH = 3;
-			fontConfig.OversampleV = 2;
-			fontConfig.PixelSnapH = true;
-			io.Fonts->AddFontFromFileTTF(fontPathGeneral, fontSizeBase, &fontConfig);
-			isFontLoaded = true;
-			break;
-		}
-	}
-#endif
-
-	if(!isFontLoaded) {
+	// The data stays with the font cache, which outlives the ImGui context.
+	if(fonts.text) {
 		ImFontConfig fontConfig;
-		fontConfig.SizePixels = fontSizeDefault;
-		fontConfig.OversampleH = 3;
-		fontConfig.OversampleV = 2;
+		fontConfig.FontDataOwnedByAtlas = false;
+		fontConfig.OversampleH = FONT_OVERSAMPLE_H;
+		fontConfig.OversampleV = FONT_OVERSAMPLE_V;
+		fontConfig.PixelSnapH = true;
+		io.Fonts->AddFontFromMemoryTTF(const_cast<std::uint8_t*>(fonts.text->data.data()), static_cast<int>(fonts.text->data.size()), FONT_SIZE_BASE, &fontConfig);
+		spdlog::info("Font loaded from: {}", fonts.text->path);
+	} else {
+		ImFontConfig fontConfig;
+		fontConfig.SizePixels = FONT_SIZE_DEFAULT;
+		fontConfig.OversampleH = FONT_OVERSAMPLE_H;
+		fontConfig.OversampleV = FONT_OVERSAMPLE_V;
 		fontConfig.PixelSnapH = true;
 		io.Fonts->AddFontDefault(&fontConfig);
 		spdlog::warn("Using default ImGui font");
 	}
 
 	// Merge in icons from Font Awesome
-	static const ImWchar iconFontRange[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
-	ImFontConfig iconFontConfig;
-	iconFontConfig.MergeMode = true;
-	iconFontConfig.PixelSnapH = true;
-	iconFontConfig.GlyphMinAdvanceX = fontSizeIcon;
-
-	// Try different paths for font loading
-	std::vector<std::string> fontPaths = {
-		"Assets/fonts/fa-solid-900.ttf",  // WASM preloaded path
-		std::string(PROJECT_SOURCE_DIR) + "/Assets/fonts/fa-solid-900.ttf"  // Native path
-	};
-	
-	bool fontAwesomeLoaded = false;
-	for (const auto& fontPath : fontPaths) {
-		if(std::filesystem::exists(fontPath)) {
-			io.Fonts->AddFontFromFileTTF(fontPath.c_str(), fontSizeIcon, &iconFontConfig, iconFontRange);
-			fontAwesomeLoaded = true;
-			spdlog::info("Font Awesome loaded from: {}", fontPath);
-			break;
-		}
-	}
-	
-	if (!fontAwesomeLoaded) {
+	if(fonts.icons) {
+		ImFontConfig iconFontConfig;
+		iconFontConfig.FontDataOwnedByAtlas = false;
+		iconFontConfig.MergeMode = true;
+		iconFontConfig.PixelSnapH = true;
+		iconFontConfig.GlyphMinAdvanceX = FONT_SIZE_ICON;
+		io.Fonts->AddFontFromMemoryTTF(const_cast<std::uint8_t*>(fonts.icons->data.data()), static_cast<int>(fonts.icons->data.size()), FONT_SIZE_ICON, &iconFontConfig, ICON_FONT_RANGE);
+		spdlog::info("Font Awesome loaded from: {}", fonts.icons->path);
+	} else {
 		spdlog::warn("Font Awesome not found");
 	}
+
+	if(fonts.isFromCache) spdlog::info("Font locations taken from the font cache");
+}
+
+std::uint64_t Application::FontConfigKey() noexcept {
+	const float sizes[] = {FONT_SIZE_BASE, FONT_SIZE_ICON, FONT_SIZE_DEFAULT};
+	const int oversample[] = {FONT_OVERSAMPLE_H, FONT_OVERSAMPLE_V};
+	std::uint64_t key = FontCache::Hash(sizes, sizeof(sizes));
+	key = FontCache::Hash(oversample, sizeof(oversample), key);
+	return FontCache::Hash(ICON_FONT_RANGE, sizeof(ICON_FONT_RANGE), key);
 }
 
 void Application::CreateWindow() {
@@ -6,18 +6,46 @@
 #include <emscripten.h>
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <nlohmann/json_fwd.hpp>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "AllocationTracker.hpp"
 #include "DiagramData.hpp"
 #include "EventHandler.hpp"
+#include "FontCache.hpp"
+#include "JobSystem.hpp"
+#include "LayoutCommands.hpp"
+#include "PreviewCache.hpp"
+#include "RenderThread.hpp"
 #include "Renderer.hpp"
+#include "WorkspaceWatcher.hpp"
 #include "Utils/Notification.hpp"
+#include "Utils/Path.hpp"
 
 class Application
 {
 public:
-	Application();
+	// Command line switches, see main.cpp.
+	struct Options {
+		// Print the startup timeline as JSON to stdout and quit once the diagram is ready.
+		bool isStartupReport;
+		// Run the allocation check headlessly: load a generated diagram, run idle and
+		// panning frames, print the counts as JSON and fail if a measured frame made more
+		// heap allocations than this. Needs a build with NEGENTROPY_TRACK_ALLOCATIONS.
+		std::optional<std::uint64_t> allocationBudget;
+
+		// Idle and panning frames are meant to allocate nothing once warmed up: the scene
+		// and tree rows reuse their buffers and labels are only copied when the tree is
+		// rebuilt. Raise it only together with the README's recorded counts.
+		static constexpr std::uint64_t DEFAULT_ALLOCATION_BUDGET = 0;
+	};
+
+	explicit Application(Options options = {});
 	~Application();
 
 	Application(const Application&) = delete;
@@ -29,28 +57,100 @@ public:
 	void MainLoop();
 
 private:
-	void InitializeImGui() const;
+	void InitializeImGui();
+	void ReportStartup();
+	void StepAllocationCheck();
+	void ReportAllocationCheck();
 	void ProcessEvents() noexcept;
 	void RenderFrame() noexcept;
 	void RenderUI() noexcept;
 	void RenderPropertiesPanel() noexcept;
+	void RenderMemoryPanel() noexcept;
+	nlohmann::json MemoryReport() const;
 	void RefreshWorkspaceFiles();
+	void RenderLoadMenu();
+	void RenderLoadProgress() noexcept;
 	void SaveDiagram() noexcept;
+	void AutosaveIfDue() noexcept;
+	void PollWorkspace();
 	static void DarkStyle() noexcept;
-	static void SetupFont() noexcept;
+	static void SetupFont(const FontCache::Fonts& fonts) noexcept;
+	static std::uint64_t FontConfigKey() noexcept;
 
 	static void InitSDL();
 	void CreateWindow();
 
+	// Milestones of this startup, measured from construction.
+	struct StartupTimeline {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::optional<std::chrono::steady_clock::time_point> windowShown;
+		std::optional<std::chrono::steady_clock::time_point> firstFrame;
+		std::optional<std::chrono::steady_clock::time_point> diagramReady;
+		bool isReported = false;
+	};
+
+	// Stages of the allocation check, each run for a fixed number of frames once the
+	// generated diagram is loaded and routed. Warm-ups let caches, pools and the frame
+	// arena settle and are not measured.
+	struct AllocationCheck {
+		enum class Stage {
+			Loading,
+			IdleWarmup,
+			Idle,
+			PanningWarmup,
+			Panning
+		};
+
+		struct Result {
+			int frames = 0;
+			std::uint64_t allocations = 0;
+			AllocationTracker::FrameStats worst;
+
+			void Add(const AllocationTracker::FrameStats& stats) noexcept {
+				++frames;
+				allocations += stats.GetTotal();
+				if(stats.GetTotal() > worst.GetTotal()) worst = stats;
+			}
+		};
+
+		Stage stage = Stage::Loading;
+		int frame = 0;
+		Result idle;
+		Result panning;
+	};
+
+	StartupTimeline startup;
+	Options options;
+	AllocationCheck allocationCheck;
+	// Early, so the fonts are read while SDL and the window come up.
+	FontCache fontCache {Utils::GetCachePath() / "fonts", FontConfigKey()};
 	bool isRunning = true;
 	SDL_Window* window = nullptr;
 	Renderer renderer;
+	RenderThread renderThread;
+	// Before everything that schedules jobs, so it outlives them.
+	JobSystem jobSystem;
 	DiagramData diagramData;
+	// After the model it moves blocks of, so it is stopped first.
+	LayoutCommands layoutCommands {diagramData};
+
+	// Journaled edits are folded into a full (quiet) save at most this often.
+	static constexpr auto AUTOSAVE_INTERVAL = std::chrono::seconds(60);
 
 	std::string currentFilePath;
+	std::chrono::steady_clock::time_point lastAutosave = std::chrono::steady_clock::now();
 	std::vector<std::string> workspaceFiles;
+	WorkspaceWatcher workspaceWatcher {Utils::GetWorkspacePath()};
+	PreviewCache previewCache {Utils::GetWorkspacePath(), Utils::GetCachePath() / "previews"};
+	Diagram::TreeRenderer::GroupState treeGroupState;
+	std::optional<std::uint64_t> treeGroupStateVersion;
+	// Set when the open file changed on disk; applied once no save of ours is in flight.
+	bool isReloadPending = false;
 	bool isShownPropertiesPanel = true;
 	bool isShownDemoPanel = false;
 	bool isShownComponentTreePanel = true;
 	bool isShownComponentEditorPanel = true;
+	bool isShownMemoryPanel = false;
+	// Symbolized on request, as that allocates.
+	std::vector<std::pair<AllocationTracker::CallSite, std::vector<std::string>>> allocationCallSites;
 };
@@ -0,0 +1,233 @@
+#include "AutoLayout.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace {
+	constexpr float GOLDEN_ANGLE = 2.39996323f;
+
+	float LengthSquared(const glm::vec2 v) noexcept {
+		return v.x * v.x + v.y * v.y;
+	}
+}
+
+AutoLayout::~AutoLayout() {
+	Stop();
+}
+
+void AutoLayout::Start(std::vector<glm::vec2> centers, std::vector<std::uint32_t> groups, const float idealDistance) {
+	Stop();
+	positions = std::move(centers);
+	this->groups = std::move(groups);
+	this->idealDistance = std::max(idealDistance, 1e-3f);
+	const std::size_t count = positions.size();
+	displacements.assign(count, glm::vec2 {0.0f});
+	order.resize(count);
+	std::iota(order.begin(), order.end(), 0u);
+	const std::uint32_t groupCount = this->groups.empty() ? 0 : *std::ranges::max_element(this->groups) + 1;
+	groupCentroids.assign(groupCount, glm::vec2 {0.0f});
+
+	// Blocks piled on one spot get a direction to separate in: a small sunflower spiral.
+	for(std::size_t i = 0; i < count; ++i) {
+		const float angle = static_cast<float>(i) * GOLDEN_ANGLE;
+		const float radius = 0.01f * this->idealDistance * std::sqrt(static_cast<float>(i % 1024));
+		positions[i] += glm::vec2 {std::cos(angle), std::sin(angle)} * radius;
+	}
+
+	// The layout spans about idealDistance * sqrt(n); the first steps may cross a tenth
+	// of that, the last ones a hundredth of the ideal distance.
+	temperature = this->idealDistance * (1.0f + 0.1f * std::sqrt(static_cast<float>(count)));
+	cooling = std::pow(0.01f * this->idealDistance / temperature, 1.0f / static_cast<float>(MAX_STEPS));
+	step = 0;
+	isCancelled = false;
+	isRunning = true;
+	publishedStep = 0;
+	{
+		std::lock_guard lock(mutex);
+		published.reset();
+	}
+
+	// Without threads Poll steps on the caller.
+#ifndef __EMSCRIPTEN__
+	coordinator = std::thread(&AutoLayout::Run, this);
+#endif
+}
+
+void AutoLayout::Stop() noexcept {
+	isCancelled = true;
+	if(coordinator.joinable()) coordinator.join();
+	isRunning = false;
+	std::lock_guard lock(mutex);
+	published.reset();
+}
+
+std::optional<AutoLayout::Frame> AutoLayout::Poll() {
+	if(!isRunning) return std::nullopt;
+#ifdef __EMSCRIPTEN__
+	Publish(isCancelled || !Step());
+#endif
+	std::optional<Frame> frame;
+	{
+		std::lock_guard lock(mutex);
+		frame = std::exchange(published, std::nullopt);
+	}
+	if(frame && frame->isFinal) {
+		if(coordinator.joinable()) coordinator.join();
+		isRunning = false;
+	}
+	return frame;
+}
+
+void AutoLayout::Run() {
+	while(!isCancelled.load(std::memory_order_relaxed)) {
+		const bool isMoving = Step();
+		Publish(!isMoving);
+		if(!isMoving) break;
+	}
+}
+
+bool AutoLayout::Step() {
+	if(positions.empty() || step >= MAX_STEPS) return false;
+
+	BuildTree();
+	std::vector<std::uint32_t> groupSizes(groupCentroids.size(), 0);
+	std::ranges::fill(groupCentroids, glm::vec2 {0.0f});
+	for(std::size_t i = 0; i < positions.size(); ++i) {
+		groupCentroids[groups[i]] += positions[i];
+		++groupSizes[groups[i]];
+	}
+	centroid = glm::vec2 {0.0f};
+	for(std::size_t group = 0; group < groupCentroids.size(); ++group) {
+		centroid += groupCentroids[group];
+		if(groupSizes[group] > 0) groupCentroids[group] /= static_cast<float>(groupSizes[group]);
+	}
+	centroid /= static_cast<float>(positions.size());
+
+	// Chunks are ranges of the tree order, so each one covers a compact area.
+	if(auto* jobSystem = JobSystem::GetInstance()) {
+		jobSystem->ParallelFor(order.size(), FORCE_GRAIN, [this](const std::size_t begin, const std::size_t end) { ComputeForces(begin, end); });
+	} else {
+		ComputeForces(0, order.size());
+	}
+
+	// Moves are capped by the temperature, which cools every step.
+	double totalMove = 0.0;
+	for(std::size_t i = 0; i < positions.size(); ++i) {
+		const float length = std::sqrt(LengthSquared(displacements[i]));
+		if(length <= 0.0f) continue;
+		const float move = std::min(length, temperature);
+		positions[i] += displacements[i] * (move / length);
+		totalMove += move;
+	}
+	temperature *= cooling;
+	++step;
+	return totalMove / static_cast<double>(positions.size()) >= SETTLE_FRACTION * idealDistance && step < MAX_STEPS;
+}
+
+void AutoLayout::BuildTree() {
+	glm::vec2 low = positions.front();
+	glm::vec2 high = positions.front();
+	for(const auto& position: positions) {
+		low = glm::min(low, position);
+		high = glm::max(high, position);
+	}
+	nodes.clear();
+	const glm::vec2 extent = high - low;
+	BuildNode(0, static_cast<std::uint32_t>(positions.size()), (low + high) * 0.5f, std::max(extent.x, extent.y) * 0.5f + 1e-3f, 0);
+}
+
+std::int32_t AutoLayout::BuildNode(const std::uint32_t first, const std::uint32_t count, const glm::vec2 center, const float halfSize, const int depth) {
+	const auto index = static_cast<std::int32_t>(nodes.size());
+	auto& node = nodes.emplace_back();
+	node.center = center;
+	node.halfSize = halfSize;
+	node.first = first;
+	node.count = count;
+	node.mass = static_cast<float>(count);
+	glm::vec2 sum {0.0f};
+	for(std::uint32_t i = first; i < first + count; ++i) sum += positions[order[i]];
+	node.massCenter = sum / node.mass;
+	if(count <= LEAF_SIZE || depth >= MAX_DEPTH) return index;
+
+	// Quadrants in `order`: left-top, left-bottom, right-top, right-bottom.
+	auto* const begin = order.data() + first;
+	auto* const end = begin + count;
+	auto* const middle = std::partition(begin, end, [this, center](const std::uint32_t body) { return positions[body].x < center.x; });
+	auto* const leftMiddle = std::partition(begin, middle, [this, center](const std::uint32_t body) { return positions[body].y < center.y; });
+	auto* const rightMiddle = std::partition(middle, end, [this, center](const std::uint32_t body) { return positions[body].y < center.y; });
+	const std::array<std::pair<std::uint32_t*, std::uint32_t*>, 4> ranges {{{begin, leftMiddle}, {leftMiddle, middle}, {middle, rightMiddle}, {rightMiddle, end}}};
+	constexpr glm::vec2 OFFSETS[4] = {{-1.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}};
+
+	const float quarter = halfSize * 0.5f;
+	for(std::size_t quadrant = 0; quadrant < 4; ++quadrant) {
+		const auto [rangeBegin, rangeEnd] = ranges[quadrant];
+		if(rangeBegin == rangeEnd) continue;
+		const std::int32_t child = BuildNode(static_cast<std::uint32_t>(rangeBegin - order.data()), static_cast<std::uint32_t>(rangeEnd - rangeBegin), center + OFFSETS[quadrant] * quarter, quarter, depth + 1);
+		// The recursion may have grown `nodes`.
+		nodes[index].children[quadrant] = child;
+	}
+	return index;
+}
+
+void AutoLayout::ComputeForces(const std::size_t begin, const std::size_t end) {
+	for(std::size_t k = begin; k < end; ++k) {
+		const std::uint32_t body = order[k];
+		// Attraction d^2 / k toward the group centroid, plus the gravity.
+		const glm::vec2 toGroup = groupCentroids[groups[body]] - positions[body];
+		displacements[body] = Repulsion(body) + toGroup * (std::sqrt(LengthSquared(toGroup)) / idealDistance) + (centroid - positions[body]) * GRAVITY;
+	}
+}
+
+glm::vec2 AutoLayout::Repulsion(const std::uint32_t body) const {
+	// Repulsion k^2 / d, summed directly within leaves and per cell beyond THETA.
+	const glm::vec2 position = positions[body];
+	const float idealSquared = idealDistance * idealDistance;
+	const float minimumSquared = 1e-4f * idealSquared;
+	glm::vec2 force {0.0f};
+
+	std::array<std::int32_t, 4 * MAX_DEPTH + 4> stack;
+	std::size_t size = 0;
+	stack[size++] = 0;
+	while(size > 0) {
+		const Node& node = nodes[stack[--size]];
+		const bool isLeaf = node.children[0] < 0 && node.children[1] < 0 && node.children[2] < 0 && node.children[3] < 0;
+		if(!isLeaf) {
+			const glm::vec2 delta = position - node.massCenter;
+			const float distanceSquared = LengthSquared(delta);
+			const float cellSize = node.halfSize * 2.0f;
+			if(cellSize * cellSize < THETA * THETA * distanceSquared) {
+				force += delta * (idealSquared * node.mass / distanceSquared);
+				continue;
+			}
+			for(const std::int32_t child: node.children) {
+				if(child >= 0) stack[size++] = child;
+			}
+			continue;
+		}
+		for(std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+			const std::uint32_t other = order[i];
+			if(other == body) continue;
+			glm::vec2 delta = position - positions[other];
+			float distanceSquared = LengthSquared(delta);
+			if(distanceSquared < minimumSquared) {
+				// Coincident; push apart along a direction both agree on, mirrored.
+				const float angle = static_cast<float>(std::min(body, other)) * GOLDEN_ANGLE;
+				const float sign = body < other ? 1.0f : -1.0f;
+				delta = glm::vec2 {std::cos(angle), std::sin(angle)} * (sign * std::sqrt(minimumSquared));
+				distanceSquared = minimumSquared;
+			}
+			force += delta * (idealSquared / distanceSquared);
+		}
+	}
+	return force;
+}
+
+void AutoLayout::Publish(const bool isFinal) {
+	std::lock_guard lock(mutex);
+	published = Frame {positions, step, isFinal};
+	publishedStep.store(step, std::memory_order_relaxed);
+}
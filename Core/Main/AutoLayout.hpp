@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Force-directed layout of block centers (Fruchterman-Reingold). Every block repels every
+// other, approximated with a Barnes-Hut quadtree so a step costs O(n log n), and is pulled
+// toward the centroid of its group. A coordinator thread builds the tree each step and
+// splits the force pass over the JobSystem workers; positions are published after every
+// step for the UI to pick up, while the step size cools down until the layout settles.
+class AutoLayout
+{
+public:
+	static constexpr std::size_t MAX_STEPS = 300;
+	// A quadtree cell this many times smaller than its distance counts as one body.
+	static constexpr float THETA = 0.8f;
+	static constexpr std::uint32_t LEAF_SIZE = 8;
+	static constexpr int MAX_DEPTH = 24;
+	// Bodies per parallel force chunk.
+	static constexpr std::size_t FORCE_GRAIN = 1024;
+	// Pull of every block toward the overall centroid, per unit of distance. Keeps groups
+	// that only repel each other from drifting apart; balances repulsion at about
+	// idealDistance * sqrt(n) across.
+	static constexpr float GRAVITY = 1.0f;
+	// Settled once the average move falls below this fraction of the ideal distance.
+	static constexpr float SETTLE_FRACTION = 0.005f;
+
+	struct Frame {
+		std::vector<glm::vec2> centers;
+		std::size_t step = 0;
+		bool isFinal = false;
+	};
+
+	AutoLayout() = default;
+	~AutoLayout();
+
+	AutoLayout(const AutoLayout&) = delete;
+	AutoLayout& operator=(const AutoLayout&) = delete;
+	AutoLayout(AutoLayout&&) = delete;
+	AutoLayout& operator=(AutoLayout&&) = delete;
+
+	// `groups` holds a dense group index per center; `idealDistance` is the spacing that
+	// repulsion and attraction balance at.
+	void Start(std::vector<glm::vec2> centers, std::vector<std::uint32_t> groups, float idealDistance);
+	// Cancels the run and waits for its coordinator.
+	void Stop() noexcept;
+	bool IsRunning() const noexcept { return isRunning; }
+	std::size_t GetStep() const noexcept { return publishedStep.load(std::memory_order_relaxed); }
+
+	// Main thread. The newest published positions, if any arrived since the last call;
+	// the run is over once a final frame was returned.
+	std::optional<Frame> Poll();
+
+private:
+	struct Node {
+		glm::vec2 center {0.0f};
+		float halfSize = 0.0f;
+		glm::vec2 massCenter {0.0f};
+		float mass = 0.0f;
+		// Range of `order` covered by this cell.
+		std::uint32_t first = 0;
+		std::uint32_t count = 0;
+		std::int32_t children[4] = {-1, -1, -1, -1};
+	};
+
+	void Run();
+	// One layout step; false once the layout settled or ran out of steps.
+	bool Step();
+	void BuildTree();
+	std::int32_t BuildNode(std::uint32_t first, std::uint32_t count, glm::vec2 center, float halfSize, int depth);
+	void ComputeForces(std::size_t begin, std::size_t end);
+	glm::vec2 Repulsion(std::uint32_t body) const;
+	void Publish(bool isFinal);
+
+	// Owned by the coordinator, shared read-only with the jobs of a force pass.
+	std::vector<glm::vec2> positions;
+	std::vector<std::uint32_t> groups;
+	std::vector<glm::vec2> displacements;
+	std::vector<glm::vec2> groupCentroids;
+	glm::vec2 centroid {0.0f};
+	std::vector<std::uint32_t> order;
+	std::vector<Node> nodes;
+	float idealDistance = 1.0f;
+	float temperature = 0.0f;
+	float cooling = 1.0f;
+	std::size_t step = 0;
+
+	std::thread coordinator;
+	std::atomic<bool> isCancelled = false;
+	bool isRunning = false;
+
+	std::mutex mutex;
+	std::optional<Frame> published;
+	std::atomic<std::size_t> publishedStep = 0;
+};
@@ -1,28 +1,412 @@
 
 #include "DiagramData.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <pugixml.hpp>
+#include <nlohmann/json.hpp>
 
+#include "../Diagram/AlignmentGuides.hpp"
 #include "../Diagram/Block.hpp"
+#include "../Diagram/Connector.hpp"
+#include "../Diagram/ConnectorRouter.hpp"
 #include "../Utils/Notification.hpp"
 #include "../Utils/Path.hpp"
 
-DiagramData::DiagramData() noexcept {
-	Load((Utils::GetWorkspacePath() / "Default.xml").string());
+namespace {
+	// Where an element ends in the document text, and the byte range of its children
+	// without the line break after its start tag and the indentation of its end tag, so
+	// that writing the range between freshly printed tags reproduces the original bytes.
+	struct ElementExtent {
+		std::size_t contentBegin = 0;
+		std::size_t contentEnd = 0;
+		std::size_t end = 0;
+	};
+
+	std::optional<ElementExtent> FindElementExtent(const std::string_view text, const std::size_t elementBegin) {
+		std::size_t depth = 0;
+		std::size_t contentBegin = 0;
+		std::size_t position = elementBegin;
+		while((position = text.find('<', position)) != std::string_view::npos) {
+			if(text.compare(position, 4, "<!--") == 0 || text.compare(position, 9, "<![CDATA[") == 0) {
+				const bool isComment = text[position + 2] == '-';
+				position = text.find(isComment ? "-->" : "]]>", position);
+				if(position == std::string_view::npos) return std::nullopt;
+				position += 3;
+				continue;
+			}
+			if(position + 1 < text.size() && (text[position + 1] == '?' || text[position + 1] == '!')) {
+				position = text.find('>', position);
+				if(position == std::string_view::npos) return std::nullopt;
+				++position;
+				continue;
+			}
+
+			std::size_t tagEnd = position + 1;
+			for(char quote = 0; tagEnd < text.size(); ++tagEnd) {
+				const char c = text[tagEnd];
+				if(quote) {
+					if(c == quote) quote = 0;
+				} else if(c == '"' || c == '\'') {
+					quote = c;
+				} else if(c == '>') {
+					break;
+				}
+			}
+			if(tagEnd >= text.size()) return std::nullopt;
+
+			if(text[position + 1] == '/') {
+				if(depth == 0) return std::nullopt;
+				if(--depth == 0) {
+					std::size_t contentEnd = position;
+					if(const auto last = text.find_last_not_of(" \t", position - 1); last != std::string_view::npos && last >= contentBegin && text[last] == '\n') {
+						contentEnd = last + 1;
+					}
+					return ElementExtent {contentBegin, contentEnd, tagEnd + 1};
+				}
+			} else if(text[tagEnd - 1] != '/') {
+				if(depth++ == 0) {
+					contentBegin = tagEnd + 1;
+					if(text.compare(contentBegin, 2, "\r\n") == 0) contentBegin += 2;
+					else if(text.compare(contentBegin, 1, "\n") == 0) contentBegin += 1;
+				}
+			} else if(depth == 0) {
+				return ElementExtent {tagEnd + 1, tagEnd + 1, tagEnd + 1};
+			}
+			position = tagEnd + 1;
+		}
+		return std::nullopt;
+	}
+
+	// The name a component's GetDisplayName would give, read from its element.
+	std::string LazyDisplayName(const pugi::xml_node& componentNode) {
+		const std::string_view type = componentNode.attribute("type").as_string();
+		if(type == "Connector") return std::string(componentNode.child_value("source")) + " -> " + componentNode.child_value("target");
+		const std::string label = componentNode.child_value("label");
+		return label.empty() && type == "Block" ? "Block" : label;
+	}
+
+	// Indexes a collapsed group from its parsed subtree: where its children are in the
+	// text, how many components they hold, what area those cover and what search finds
+	// of them. Component extents come from their "position" and "size" fields.
+	std::optional<LazyGroup> IndexGroup(const pugi::xml_node& groupNode, const std::shared_ptr<const std::string>& document, const std::size_t baseOffset) {
+		const std::ptrdiff_t nameOffset = groupNode.offset_debug();
+		if(nameOffset <= 0 || !groupNode.first_child()) return std::nullopt;
+
+		// The element offset points at its name, right after the '<'.
+		const std::string_view text(*document);
+		const std::size_t elementBegin = baseOffset + static_cast<std::size_t>(nameOffset) - 1;
+		if(text.compare(elementBegin, 6, "<Group") != 0) return std::nullopt;
+
+		const auto extent = FindElementExtent(text, elementBegin);
+		if(!extent || extent->contentBegin == extent->contentEnd) return std::nullopt;
+
+		LazyGroup group;
+		group.document = document;
+		group.contentBegin = extent->contentBegin;
+		group.contentEnd = extent->contentEnd;
+		auto components = std::make_shared<std::vector<Diagram::LazyComponent>>();
+
+		const auto visit = [&group, &components](const auto& self, const pugi::xml_node& node) -> void {
+			for(const auto child: node.children()) {
+				const std::string_view name = child.name();
+				if(name == "Group") {
+					self(self, child);
+					continue;
+				}
+				if(name != "Component") continue;
+
+				++group.componentCount;
+				components->push_back({child.attribute("id").as_string(), LazyDisplayName(child)});
+				// Connectors take their place from the blocks they join.
+				if(std::string_view(child.attribute("type").as_string()) == "Connector") continue;
+				const auto positionNode = child.child("position");
+				if(!positionNode) {
+					group.hasUnplacedComponent = true;
+					continue;
+				}
+				glm::vec2 position {0.0f};
+				glm::vec2 size {0.0f};
+				XML::deserialize_value(positionNode, position);
+				XML::deserialize_field(child, "size", size);
+				group.boundsMin = glm::min(group.boundsMin, glm::min(position, position + size));
+				group.boundsMax = glm::max(group.boundsMax, glm::max(position, position + size));
+			}
+		};
+		visit(visit, groupNode);
+		group.components = std::move(components);
+		return group;
+	}
+
+	// Hash of a component element's text in its group, see DiagramWriter::HashComponent.
+	std::optional<std::size_t> HashElement(const pugi::xml_node& node, const std::string_view text, const std::size_t baseOffset, const std::string_view groupId) {
+		const std::ptrdiff_t nameOffset = node.offset_debug();
+		if(nameOffset <= 0) return std::nullopt;
+
+		const std::size_t elementBegin = baseOffset + static_cast<std::size_t>(nameOffset) - 1;
+		if(elementBegin >= text.size() || text[elementBegin] != '<') return std::nullopt;
+
+		const auto extent = FindElementExtent(text, elementBegin);
+		if(!extent) return std::nullopt;
+		return DiagramWriter::HashComponent(text.substr(elementBegin, extent->end - elementBegin), groupId);
+	}
+
+	std::size_t HashJson(const Utils::AccountedJson& node, const std::string_view groupId) {
+		return DiagramWriter::HashComponent(node.dump(), groupId);
+	}
+
+	std::shared_ptr<const std::string> ReadDocument(const std::string& filePath) {
+		std::ifstream stream(filePath, std::ios::binary);
+		if(!stream) return nullptr;
+		return std::make_shared<const std::string>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	// Chunked, so a background load can report the bytes read and stop early.
+	std::shared_ptr<const std::string> ReadDocument(const std::string& filePath, DiagramData::LoadProgress& progress) {
+		constexpr std::size_t CHUNK_BYTES = 1 << 20;
+
+		std::ifstream stream(filePath, std::ios::binary | std::ios::ate);
+		if(!stream) return nullptr;
+		const auto size = static_cast<std::size_t>(stream.tellg());
+		stream.seekg(0);
+		progress.totalBytes = size;
+
+		auto document = std::make_shared<std::string>(size, '\0');
+		for(std::size_t offset = 0; offset < size; offset += CHUNK_BYTES) {
+			if(progress.isCancelled.load(std::memory_order_relaxed)) return nullptr;
+			const std::size_t count = std::min(CHUNK_BYTES, size - offset);
+			if(!stream.read(document->data() + offset, static_cast<std::streamsize>(count))) return nullptr;
+			progress.bytesRead = offset + count;
+		}
+		return document;
+	}
+
+	std::optional<std::pair<std::filesystem::file_time_type, std::uintmax_t>> ReadSignature(const std::string& filePath) {
+		std::error_code error;
+		const auto time = std::filesystem::last_write_time(filePath, error);
+		if(error) return std::nullopt;
+		const auto size = std::filesystem::file_size(filePath, error);
+		if(error) return std::nullopt;
+		return std::pair {time, size};
+	}
+
+	// Whether the text of a lazy group has an element with one of `ids`, found by the
+	// id attributes pugixml prints without parsing the text.
+	bool HoldsAnyId(const std::string_view content, const std::unordered_set<std::string_view>& ids) {
+		constexpr std::string_view ID_ATTRIBUTE = " id=\"";
+		for(auto begin = content.find(ID_ATTRIBUTE); begin != std::string_view::npos; begin = content.find(ID_ATTRIBUTE, begin)) {
+			begin += ID_ATTRIBUTE.size();
+			const auto end = content.find('"', begin);
+			if(end == std::string_view::npos) return false;
+			if(ids.contains(content.substr(begin, end - begin))) return true;
+			begin = end;
+		}
+		return false;
+	}
+}
+
+// The file's version of the model, read and compared with the baseline on a worker so
+// that applying it only touches what differs.
+struct DiagramData::ReloadState {
+	struct Component {
+		std::string id;
+		std::string type;
+		std::string groupId;
+		std::optional<std::size_t> hash;
+		pugi::xml_node xmlNode;
+		std::optional<nlohmann::json> jsonData;
+	};
+
+	// Copied from the model when the reload starts; groups are few next to components.
+	std::shared_ptr<const ComponentHashes> baseline;
+	Diagram::GroupMap<std::string> currentGroups{Diagram::GroupMapResource()};
+	Diagram::GroupMap<std::string> currentGroupNames{Diagram::GroupMapResource()};
+	Diagram::GroupMap<bool> currentExpanded{Diagram::GroupMapResource()};
+	std::map<std::string, std::size_t> currentLazyCounts;
+	bool isLazyLoading = true;
+
+	bool isRead = false;
+	std::string error;
+	// Holds the nodes of `components`.
+	pugi::xml_document xmlDoc;
+
+	Diagram::Grid grid;
+	Diagram::GroupMap<std::string> groupMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<std::string> groupNameMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<bool> isGroupExpandedMap{Diagram::GroupMapResource()};
+	std::map<std::string, LazyGroup> lazyGroups;
+	bool isGroupsChanged = false;
+	// Components whose hash differs from the baseline, and baseline ids the file lost.
+	std::vector<Component> components;
+	std::vector<std::string> removedIds;
+	ComponentHashes hashes;
+};
+
+struct DiagramData::Snapshot {
+	Diagram::Camera camera;
+	Diagram::Grid grid;
+	Diagram::GroupMap<std::string> groupMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<std::string> groupNameMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<bool> isGroupExpandedMap{Diagram::GroupMapResource()};
+	std::vector<std::unique_ptr<Diagram::ComponentBase>> componentList;
+	std::map<std::string, LazyGroup> lazyGroups;
+	// Their components are left out of componentList; the writer has their fragments.
+	std::unordered_set<std::string> cleanGroups;
+	std::string journalMark;
+
+	DiagramWriter::Source Source() const {
+		return {camera, grid, groupMap, groupNameMap, isGroupExpandedMap, componentList, lazyGroups, &cleanGroups, journalMark};
+	}
+};
+
+DiagramData::DiagramData() noexcept : alignmentGuides(std::make_unique<Diagram::AlignmentGuides>()), router(std::make_unique<Diagram::ConnectorRouter>()) {}
+
+DiagramData::~DiagramData() {
+	// The workers stop at their next check; their futures wait for that.
+	CancelLoad();
 }
 
 void DiagramData::Load(const std::string& filePath) {
+	Diagram::ComponentBase::ClearSelection();
+	// A layout of the document being replaced is dropped, not recorded.
+	Interrupt(true);
+	if(pendingReload) pendingReload->isDiscarded = true;
+	queuedReloadPath.reset();
+	const bool isLoaded = Parse(filePath);
+	MarkStructureChanged();
+	if(!isLoaded) return;
+	journal.Flush();
+	FinishLoad(filePath);
+}
+
+void DiagramData::LoadAsync(const std::string& filePath) {
+	CancelLoad();
+
+	PendingLoad load {filePath, std::make_unique<LoadProgress>(), std::make_unique<DiagramData>()};
+	load.staging->isLazyLoading = isLazyLoading;
+	load.staging->loadProgress = load.progress.get();
+#ifdef __EMSCRIPTEN__
+	// No worker threads; the parse runs inside the PollLoad that collects it.
+	constexpr auto policy = std::launch::deferred;
+#else
+	constexpr auto policy = std::launch::async;
+#endif
+	load.isLoaded = std::async(policy, [staging = load.staging.get(), filePath] {
+		return staging->Parse(filePath);
+	});
+	pendingLoad = std::move(load);
+}
+
+std::optional<std::string> DiagramData::PollLoad() {
+	std::erase_if(cancelledLoads, [](const PendingLoad& load) {
+		return load.isLoaded.wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+	});
+
+	if(!pendingLoad || pendingLoad->isLoaded.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) return std::nullopt;
+	// A save in flight belongs to the current document; its result is taken first.
+	if(pendingSave.valid()) return std::nullopt;
+	// Recovery reads the journal from disk, so the records of the open document go
+	// there first; the writer thread is waited for across frames.
+	if(!journal.PollFlush()) return std::nullopt;
+
+	PendingLoad load = std::move(*pendingLoad);
+	pendingLoad.reset();
+	const std::string fileName = std::filesystem::path(load.filePath).filename().string();
+	try {
+		if(!load.isLoaded.get()) {
+			Notify::Error("Error loading " + fileName);
+			return std::nullopt;
+		}
+	} catch(const std::exception& e) {
+		Notify::Error("Error loading " + fileName + ": " + e.what());
+		return std::nullopt;
+	}
+
+	Adopt(*load.staging);
+	FinishLoad(load.filePath);
+	return load.filePath;
+}
+
+void DiagramData::CancelLoad() noexcept {
+	if(!pendingLoad) return;
+	pendingLoad->progress->isCancelled = true;
+	// Waiting for the worker here would stall the frame until it notices.
+	cancelledLoads.push_back(std::move(*pendingLoad));
+	pendingLoad.reset();
+}
+
+bool DiagramData::Parse(const std::string& filePath) {
+	const bool isLoaded = Utils::IsJsonDocument(filePath) ? LoadJson(filePath) : LoadXml(filePath);
+	return isLoaded && !IsLoadCancelled();
+}
+
+void DiagramData::FinishLoad(const std::string& filePath) {
+	history.Clear();
+
+	// Edits journaled after the last save of this file are replayed on top of it. The
+	// callers have flushed the journal.
+	if(const auto entries = Journal::Recover(filePath, journalMark); !entries.empty()) {
+		MaterializeJournaledGroups(entries);
+		ApplyJournal(entries);
+		MarkStructureChanged();
+		Notify::Info("Recovered " + std::to_string(entries.size()) + " unsaved edits");
+	}
+	journal.Open(filePath, journalMark);
+}
+
+void DiagramData::Adopt(DiagramData& staged) {
+	// The selection points into the model being replaced; the camera is the document's.
+	Diagram::ComponentBase::ClearSelection();
+	Interrupt(true);
+	componentList = std::move(staged.componentList);
+	cameraData = staged.cameraData;
+	gridData = staged.gridData;
+	groupMap = std::move(staged.groupMap);
+	groupNameMap = std::move(staged.groupNameMap);
+	isGroupExpandedMap = std::move(staged.isGroupExpandedMap);
+	lazyGroups = std::move(staged.lazyGroups);
+	componentHashes = std::move(staged.componentHashes);
+	// The reload in flight compares against the document being replaced.
+	if(pendingReload) pendingReload->isDiscarded = true;
+	queuedReloadPath.reset();
+	syncedSignature = staged.syncedSignature;
+	journalMark = std::move(staged.journalMark);
+	if(writer) writer->Reset();
+	*router = {};
+	MarkStructureChanged();
+}
+
+bool DiagramData::LoadXml(const std::string& filePath) {
+	// Lazy groups keep referring to the text, so it outlives the parsed document.
+	const auto document = loadProgress ? ReadDocument(filePath, *loadProgress) : ReadDocument(filePath);
+	if(!document) {
+		if(!IsLoadCancelled()) std::cerr << "Error loading file: cannot open " << filePath << std::endl;
+		return false;
+	}
+	syncedSignature = ReadSignature(filePath);
+
 	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(filePath.c_str());
+	pugi::xml_parse_result result = doc.load_buffer(document->data(), document->size());
 	if(!result) {
 		std::cerr << "Error loading file: " << result.description() << std::endl;
-		return;
+		return false;
 	}
 
 	componentList.clear();
+	lazyGroups.clear();
+	componentHashes = std::make_shared<ComponentHashes>();
+	if(writer) writer->Reset();
 	auto diagram = doc.child("Diagram");
-	if(!diagram) return;
+	if(!diagram) return false;
+	journalMark = diagram.attribute("journal").as_string();
 
 	if(auto cameraNode = diagram.child("Camera")) {
 		cameraData.XmlDeserialize(cameraNode);
@@ -33,83 +417,699 @@ void DiagramData::Load(const std::string& filePath) {
 	}
 
 	if(auto rootNode = diagram.child("Root")) {
-		LoadHierarchy(rootNode, "");
+		LoadHierarchy(rootNode, "", document);
 	}
+	return true;
 }
 
-void DiagramData::Save(const std::string& filePath) const {
-	pugi::xml_document doc;
-	auto declarationNode = doc.append_child(pugi::node_declaration);
-	declarationNode.append_attribute("version") = "1.0";
-	declarationNode.append_attribute("encoding") = "UTF-8";
+bool DiagramData::LoadJson(const std::string& filePath) {
+	const auto document = loadProgress ? ReadDocument(filePath, *loadProgress) : ReadDocument(filePath);
+	if(!document) {
+		if(!IsLoadCancelled()) std::cerr << "Error loading file: cannot open " << filePath << std::endl;
+		return false;
+	}
+	const auto doc = Utils::AccountedJson::parse(*document, nullptr, false);
+	if(doc.is_discarded()) {
+		std::cerr << "Error loading file: malformed JSON" << std::endl;
+		return false;
+	}
+	syncedSignature = ReadSignature(filePath);
+
+	componentList.clear();
+	lazyGroups.clear();
+	componentHashes = std::make_shared<ComponentHashes>();
+	if(writer) writer->Reset();
+	const auto diagram = doc.find("Diagram");
+	if(diagram == doc.end() || !diagram->is_object()) return false;
+	journalMark = diagram->value("journal", std::string());
+
+	if(const auto cameraNode = diagram->find("Camera"); cameraNode != diagram->end()) {
+		cameraData.JsonDeserialize(nlohmann::json(*cameraNode));
+	}
 
-	auto diagram = doc.append_child("Diagram");
+	if(const auto gridNode = diagram->find("Grid"); gridNode != diagram->end()) {
+		gridData.JsonDeserialize(nlohmann::json(*gridNode));
+	}
 
-	auto cameraNode = diagram.append_child("Camera");
-	cameraData.XmlSerialize(cameraNode);
+	if(const auto rootNode = diagram->find("Root"); rootNode != diagram->end()) {
+		try {
+			LoadJsonHierarchy(*rootNode, "");
+		} catch(const nlohmann::json::exception& e) {
+			// A mistyped id/name/type field; keep what was read before it.
+			std::cerr << "Error loading file: " << e.what() << std::endl;
+		}
+	}
+	return true;
+}
 
-	auto gridNode = diagram.append_child("Grid");
-	gridData.XmlSerialize(gridNode);
+void DiagramData::Save(const std::string& filePath) {
+	if(Utils::IsJsonDocument(filePath)) MaterializeAllGroups();
 
-	auto rootNode = diagram.append_child("Root");
-	SaveHierarchy(rootNode, "");
+	// A sync save racing an async one falls back to a full write with a scratch writer.
+	DiagramWriter scratchWriter;
+	auto& activeWriter = writer ? *writer : scratchWriter;
 
-	if(doc.save_file(filePath.c_str())) {
+	const std::uint64_t checkpoint = journal.Checkpoint();
+	const std::string mark = journal.MarkOf(checkpoint);
+	std::string error;
+	ComponentHashes hashes;
+	if(activeWriter.Write(filePath, {cameraData, gridData, groupMap, groupNameMap, isGroupExpandedMap, componentList, lazyGroups, nullptr, mark}, error, &hashes)) {
+		journal.Compact(checkpoint);
+		journalMark = mark;
+		componentHashes = std::make_shared<ComponentHashes>(std::move(hashes));
+		syncedSignature = ReadSignature(filePath);
 		Notify::Success("Diagram saved successfully!");
 	} else {
-		Notify::Error("Error saving diagram!");
+		Notify::Error("Error saving diagram: " + error);
+	}
+}
+
+void DiagramData::SaveAsync(const std::string& filePath, const bool isQuiet) {
+#ifdef __EMSCRIPTEN__
+	Save(filePath);
+#else
+	if(pendingSave.valid()) {
+		isQueuedSaveQuiet = (!queuedSavePath || isQueuedSaveQuiet) && isQuiet;
+		queuedSavePath = filePath;
+		return;
+	}
+	StartSave(filePath, isQuiet);
+#endif
+}
+
+void DiagramData::PollSave() {
+	if(!pendingSave.valid() || pendingSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+	FinishSave();
+	if(queuedSavePath) {
+		const std::string filePath = std::move(*queuedSavePath);
+		queuedSavePath.reset();
+		StartSave(filePath, isQueuedSaveQuiet);
+	}
+}
+
+void DiagramData::WaitForSave() {
+	while(pendingSave.valid()) {
+		pendingSave.wait();
+		PollSave();
+	}
+}
+
+void DiagramData::StartSave(const std::string& filePath, const bool isQuiet) {
+	// JSON has no place for the verbatim XML of lazy groups, nor for cached fragments.
+	const bool isJson = Utils::IsJsonDocument(filePath);
+	if(isJson) MaterializeAllGroups();
+
+	// Only components of groups the writer has to serialize again are cloned; the
+	// serialization and disk work happen on the worker against this frozen state while
+	// editing continues.
+	auto snapshot = std::make_unique<Snapshot>();
+	if(!isJson) snapshot->cleanGroups = writer->FindCleanGroups({cameraData, gridData, groupMap, groupNameMap, isGroupExpandedMap, componentList, lazyGroups});
+	snapshot->camera = cameraData;
+	snapshot->grid = gridData;
+	snapshot->groupMap = groupMap;
+	snapshot->groupNameMap = groupNameMap;
+	snapshot->isGroupExpandedMap = isGroupExpandedMap;
+	snapshot->lazyGroups = lazyGroups;
+	for(const auto& component: componentList) {
+		if(!snapshot->cleanGroups.contains(component->groupId)) snapshot->componentList.push_back(component->Clone());
+	}
+
+	const std::uint64_t checkpoint = journal.Checkpoint();
+	snapshot->journalMark = journal.MarkOf(checkpoint);
+	pendingSave = std::async(std::launch::async, [snapshot = std::move(snapshot), saveWriter = std::move(writer), filePath, checkpoint, isQuiet]() mutable {
+		SaveResult result {false, filePath, {}, std::move(saveWriter), checkpoint, isQuiet};
+		result.isSaved = result.writer->Write(filePath, snapshot->Source(), result.error, &result.componentHashes);
+		if(result.isSaved) result.signature = ReadSignature(filePath);
+		return result;
+	});
+}
+
+void DiagramData::FinishSave() {
+	try {
+		auto result = pendingSave.get();
+		writer = std::move(result.writer);
+		if(result.isSaved) {
+			journal.Compact(result.checkpoint);
+			journalMark = journal.MarkOf(result.checkpoint);
+			componentHashes = std::make_shared<ComponentHashes>(std::move(result.componentHashes));
+			syncedSignature = result.signature;
+			if(!result.isQuiet) Notify::Success("Diagram saved successfully!");
+		} else {
+			Notify::Error("Error saving diagram: " + result.error);
+		}
+	} catch(const std::exception& e) {
+		Notify::Error(std::string("Error saving diagram: ") + e.what());
+	}
+	if(!writer) writer = std::make_unique<DiagramWriter>();
+}
+
+void DiagramData::MeasureStrings() const noexcept {
+	std::size_t bytes = 0;
+	for(const auto& component: componentList) bytes += component->GetStringBytes();
+	for(const auto& [id, parent]: groupMap) bytes += Utils::MemoryAccounting::HeapBytes(id) + Utils::MemoryAccounting::HeapBytes(parent);
+	for(const auto& [id, name]: groupNameMap) bytes += Utils::MemoryAccounting::HeapBytes(id) + Utils::MemoryAccounting::HeapBytes(name);
+	for(const auto& [id, isExpanded]: isGroupExpandedMap) bytes += Utils::MemoryAccounting::HeapBytes(id);
+	for(const auto& group: lazyGroups | std::views::values) {
+		for(const auto& component: *group.components) bytes += Utils::MemoryAccounting::HeapBytes(component.id) + Utils::MemoryAccounting::HeapBytes(component.displayName);
+	}
+	Utils::MemoryAccounting::SetMeasured(Utils::MemoryAccounting::Subsystem::Strings, bytes);
+}
+
+void DiagramData::UpdateGroups(const Diagram::GroupMap<std::string>& groups) noexcept {
+	std::vector<UndoHistory::Change> changes;
+	for(const auto& [id, parent]: groups) {
+		const auto it = groupMap.find(id);
+		std::string previous = it != groupMap.end() ? it->second : std::string();
+		if(previous == parent) continue;
+		journal.RecordRegroupGroup(id, parent);
+		UndoHistory::Change change {UndoHistory::Kind::RegroupGroup};
+		change.groupId = id;
+		change.before = std::move(previous);
+		change.after = parent;
+		changes.push_back(std::move(change));
+	}
+	history.Record(std::move(changes));
+	groupMap = groups;
+	MarkStructureChanged();
+}
+
+void DiagramData::UpdateGroupExpanded(const Diagram::GroupMap<bool>& expanded) noexcept {
+	// The tree updates its own rows on expand and collapse; only materializing a group
+	// (which bumps the version itself) reshapes it.
+	isGroupExpandedMap = expanded;
+	for(const auto& [id, isExpanded]: expanded) {
+		if(isExpanded && lazyGroups.contains(id)) MaterializeGroup(id);
+	}
+}
+
+void DiagramData::SetLazyLoading(const bool isEnabled) {
+	isLazyLoading = isEnabled;
+	if(!isLazyLoading) MaterializeAllGroups();
+}
+
+bool DiagramData::MaterializeGroup(const std::string& groupId) {
+	const auto it = lazyGroups.find(groupId);
+	if(it == lazyGroups.end()) return false;
+
+	const auto content = it->second.Content();
+	pugi::xml_document doc;
+	if(const auto result = doc.load_buffer(content.data(), content.size(), pugi::parse_default | pugi::parse_fragment); !result) {
+		std::cerr << "Error loading group " << groupId << ": " << result.description() << std::endl;
+		return false;
+	}
+
+	const LazyGroup group = std::move(it->second);
+	lazyGroups.erase(it);
+	LoadHierarchy(doc, groupId, group.document, group.contentBegin);
+	MarkStructureChanged();
+	return true;
+}
+
+void DiagramData::MaterializeAllGroups() {
+	// Building a group indexes the collapsed groups nested in it, hence the rounds.
+	for(bool isProgressing = true; isProgressing;) {
+		isProgressing = false;
+		std::vector<std::string> groupIds;
+		groupIds.reserve(lazyGroups.size());
+		for(const auto& id: lazyGroups | std::views::keys) groupIds.push_back(id);
+		for(const auto& id: groupIds) isProgressing |= MaterializeGroup(id);
+	}
+}
+
+void DiagramData::MaterializeVisibleGroups(const glm::vec2 screenSize) {
+	if(lazyGroups.empty()) return;
+
+	const glm::vec2 viewMin = cameraData.ScreenToWorld({0.0f, 0.0f}, screenSize);
+	const glm::vec2 viewMax = cameraData.ScreenToWorld(screenSize, screenSize);
+	std::vector<std::string> visibleIds;
+	for(const auto& [id, group]: lazyGroups) {
+		if(group.Intersects(viewMin, viewMax)) visibleIds.push_back(id);
 	}
+	for(const auto& id: visibleIds) MaterializeGroup(id);
+}
+
+std::size_t DiagramData::GetUnloadedComponentCount() const noexcept {
+	std::size_t count = 0;
+	for(const auto& group: lazyGroups | std::views::values) count += group.componentCount;
+	return count;
 }
 
 std::unique_ptr<Diagram::ComponentBase> DiagramData::CreateComponent(const std::string& type) const {
 	if(type == "Block") return std::make_unique<Diagram::Block>();
+	if(type == "Connector") return std::make_unique<Diagram::Connector>();
 	return nullptr;
 }
 
-void DiagramData::LoadHierarchy(pugi::xml_node node, const std::string& parentGroupId) {
+void DiagramData::LoadHierarchy(pugi::xml_node node, const std::string& parentGroupId, const std::shared_ptr<const std::string>& document, const std::size_t baseOffset) {
 	for(auto child: node.children()) {
+		if(IsLoadCancelled()) return;
 		const std::string name = child.name();
 		if(name == "Group") {
 			const std::string id = child.attribute("id").as_string();
 			groupMap[id] = parentGroupId;
 			groupNameMap[id] = child.attribute("name").as_string();
 			isGroupExpandedMap[id] = child.attribute("expanded").as_bool(true);
-			LoadHierarchy(child, id);
+			if(document && isLazyLoading && !isGroupExpandedMap[id]) {
+				if(auto group = IndexGroup(child, document, baseOffset)) {
+					lazyGroups.insert_or_assign(id, std::move(*group));
+					continue;
+				}
+			}
+			LoadHierarchy(child, id, document, baseOffset);
 		} else if(name == "Component") {
 			if(auto component = CreateComponent(child.attribute("type").as_string())) {
 				component->groupId = parentGroupId;
 				component->id = child.attribute("id").as_string();
 				component->XmlDeserialize(child);
+				if(document) {
+					if(const auto hash = HashElement(child, *document, baseOffset, parentGroupId)) EditComponentHashes().insert_or_assign(component->id, *hash);
+				}
 				componentList.push_back(std::move(component));
+				if(loadProgress) ++loadProgress->componentsBuilt;
 			}
 		}
 	}
 }
 
-void DiagramData::SaveHierarchy(pugi::xml_node node, const std::string& groupId) const {
-	for(const auto& [id, parent]: groupMap) {
-		if(parent == groupId) {
-			auto groupNode = node.append_child("Group");
-			groupNode.append_attribute("id").set_value(id.c_str());
-			groupNode.append_attribute("name").set_value(groupNameMap.contains(id) ? groupNameMap.at(id).c_str() : id.c_str());
-			groupNode.append_attribute("expanded").set_value(isGroupExpandedMap.contains(id) && isGroupExpandedMap.at(id));
-			SaveHierarchy(groupNode, id);
+void DiagramData::LoadJsonHierarchy(const Utils::AccountedJson& node, const std::string& parentGroupId) {
+	if(!node.is_object()) return;
+
+	if(const auto groups = node.find("groups"); groups != node.end() && groups->is_array()) {
+		for(const auto& child: *groups) {
+			if(!child.is_object()) continue;
+			const std::string id = child.value("id", "");
+			groupMap[id] = parentGroupId;
+			groupNameMap[id] = child.value("name", "");
+			isGroupExpandedMap[id] = child.value("expanded", true);
+			LoadJsonHierarchy(child, id);
 		}
 	}
 
-	for(const auto& component: componentList) {
-		if(component->groupId == groupId) {
-			auto componentNode = node.append_child("Component");
-			const auto& id = component->id.empty() ? "comp" + std::to_string(reinterpret_cast<uintptr_t>(component.get())) : component->id;
-			componentNode.append_attribute("id").set_value(id.c_str());
-			componentNode.append_attribute("type").set_value(component->GetTypeName().c_str());
-			component->XmlSerialize(componentNode);
+	if(const auto components = node.find("components"); components != node.end() && components->is_array()) {
+		for(const auto& child: *components) {
+			if(IsLoadCancelled()) return;
+			if(!child.is_object()) continue;
+			if(auto component = CreateComponent(child.value("type", ""))) {
+				component->groupId = parentGroupId;
+				component->id = child.value("id", "");
+				if(const auto data = child.find("data"); data != child.end()) {
+					component->JsonDeserialize(nlohmann::json(*data));
+					EditComponentHashes().insert_or_assign(component->id, HashJson(*data, parentGroupId));
+				}
+				componentList.push_back(std::move(component));
+				if(loadProgress) ++loadProgress->componentsBuilt;
+			}
+		}
+	}
+}
+
+void DiagramData::Reload(const std::string& filePath) {
+	if(pendingReload) {
+		queuedReloadPath = filePath;
+		return;
+	}
+	const auto signature = ReadSignature(filePath);
+	if(!signature || signature == syncedSignature) return;
+
+	auto state = std::make_unique<ReloadState>();
+	state->baseline = componentHashes;
+	state->currentGroups = groupMap;
+	state->currentGroupNames = groupNameMap;
+	state->currentExpanded = isGroupExpandedMap;
+	for(const auto& [id, group]: lazyGroups) state->currentLazyCounts.emplace(id, group.componentCount);
+	state->isLazyLoading = isLazyLoading;
+	state->grid = gridData;
+
+#ifdef __EMSCRIPTEN__
+	// No worker threads; the read runs inside the PollReload that collects it.
+	constexpr auto policy = std::launch::deferred;
+#else
+	constexpr auto policy = std::launch::async;
+#endif
+	auto read = std::async(policy, [state = std::move(state), filePath]() mutable {
+		ReadReload(filePath, *state);
+		return std::move(state);
+	});
+	pendingReload = PendingReload {filePath, *signature, structureVersion, false, std::move(read)};
+}
+
+void DiagramData::PollReload() {
+	if(!pendingReload || pendingReload->state.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) return;
+	// The save in flight may have rewritten the file; its baseline is taken first.
+	if(pendingSave.valid()) return;
+
+	PendingReload reload = std::move(*pendingReload);
+	pendingReload.reset();
+	std::unique_ptr<ReloadState> state;
+	try {
+		state = reload.state.get();
+	} catch(const std::exception& e) {
+		Notify::Warning(std::string("Could not reload diagram: ") + e.what());
+	}
+
+	if(reload.isDiscarded) {
+		state.reset();
+	} else if(state && (reload.structureVersion != structureVersion || state->baseline != componentHashes)) {
+		// Edited or saved while the file was read, so the diff may not fit the model any
+		// more; it is read again against the current one.
+		if(!queuedReloadPath) queuedReloadPath = reload.filePath;
+	} else if(state && state->isRead) {
+		ApplyReload(*state);
+		syncedSignature = reload.signature;
+	} else if(state && !state->error.empty()) {
+		Notify::Warning("Could not reload diagram: " + state->error);
+	}
+
+	if(queuedReloadPath) {
+		const std::string filePath = std::move(*queuedReloadPath);
+		queuedReloadPath.reset();
+		Reload(filePath);
+	}
+}
+
+void DiagramData::ReadReload(const std::string& filePath, ReloadState& state) {
+	const auto document = ReadDocument(filePath);
+	if(!document) return;
+
+	if(Utils::IsJsonDocument(filePath)) {
+		const auto jsonDoc = Utils::AccountedJson::parse(*document, nullptr, false);
+		const auto diagram = jsonDoc.is_object() ? jsonDoc.find("Diagram") : jsonDoc.end();
+		if(diagram == jsonDoc.end() || !diagram->is_object()) {
+			state.error = "malformed JSON";
+			return;
+		}
+		if(const auto gridNode = diagram->find("Grid"); gridNode != diagram->end()) {
+			state.grid.JsonDeserialize(nlohmann::json(*gridNode));
+		}
+		if(const auto rootNode = diagram->find("Root"); rootNode != diagram->end()) {
+			try {
+				ScanJsonHierarchy(*rootNode, "", state);
+			} catch(const nlohmann::json::exception& e) {
+				state.error = e.what();
+				return;
+			}
+		}
+	} else {
+		if(const auto result = state.xmlDoc.load_buffer(document->data(), document->size()); !result) {
+			state.error = result.description();
+			return;
+		}
+		const auto diagram = state.xmlDoc.child("Diagram");
+		if(!diagram) return;
+		if(auto gridNode = diagram.child("Grid")) {
+			state.grid.XmlDeserialize(gridNode);
+		}
+		if(auto rootNode = diagram.child("Root")) {
+			ScanXmlHierarchy(rootNode, "", document, state);
+		}
+	}
+
+	// Only what the file used to hold can have been deleted from it; components added
+	// here and never saved stay. Components the hash could not be taken of are in the
+	// file all the same.
+	for(const auto& id: *state.baseline | std::views::keys) {
+		if(state.hashes.contains(id)) continue;
+		if(std::ranges::any_of(state.components, [&id](const auto& component) { return !component.hash && component.id == id; })) continue;
+		state.removedIds.push_back(id);
+	}
+
+	const auto isSameLazyGroup = [](const auto& incoming, const auto& current) {
+		return incoming.first == current.first && incoming.second.componentCount == current.second;
+	};
+	state.isGroupsChanged = state.groupMap != state.currentGroups || state.groupNameMap != state.currentGroupNames || !std::ranges::equal(state.lazyGroups, state.currentLazyCounts, isSameLazyGroup);
+	state.isRead = true;
+}
+
+void DiagramData::ScanXmlHierarchy(const pugi::xml_node& node, const std::string& parentGroupId, const std::shared_ptr<const std::string>& document, ReloadState& state) {
+	for(const auto child: node.children()) {
+		const std::string_view name = child.name();
+		if(name == "Group") {
+			const std::string id = child.attribute("id").as_string();
+			state.groupMap[id] = parentGroupId;
+			state.groupNameMap[id] = child.attribute("name").as_string();
+
+			// Expanding and collapsing in this session wins over the file.
+			const auto expanded = state.currentExpanded.find(id);
+			const bool isExpanded = expanded != state.currentExpanded.end() ? expanded->second : child.attribute("expanded").as_bool(true);
+			state.isGroupExpandedMap[id] = isExpanded;
+
+			// A group that was never built here does not need to be built for the diff either.
+			if(state.isLazyLoading && !isExpanded && (state.currentLazyCounts.contains(id) || !state.currentGroups.contains(id))) {
+				if(auto group = IndexGroup(child, document, 0)) {
+					state.lazyGroups.insert_or_assign(id, std::move(*group));
+					continue;
+				}
+			}
+			ScanXmlHierarchy(child, id, document, state);
+		} else if(name == "Component") {
+			ReloadState::Component component {child.attribute("id").as_string(), child.attribute("type").as_string(), parentGroupId, HashElement(child, *document, 0, parentGroupId), child};
+			if(component.hash) {
+				state.hashes.insert_or_assign(component.id, *component.hash);
+				if(const auto previous = state.baseline->find(component.id); previous != state.baseline->end() && previous->second == *component.hash) continue;
+			}
+			state.components.push_back(std::move(component));
+		}
+	}
+}
+
+void DiagramData::ScanJsonHierarchy(const Utils::AccountedJson& node, const std::string& parentGroupId, ReloadState& state) {
+	if(!node.is_object()) return;
+
+	if(const auto groups = node.find("groups"); groups != node.end() && groups->is_array()) {
+		for(const auto& child: *groups) {
+			if(!child.is_object()) continue;
+			const std::string id = child.value("id", "");
+			state.groupMap[id] = parentGroupId;
+			state.groupNameMap[id] = child.value("name", "");
+			const auto expanded = state.currentExpanded.find(id);
+			state.isGroupExpandedMap[id] = expanded != state.currentExpanded.end() ? expanded->second : child.value("expanded", true);
+			ScanJsonHierarchy(child, id, state);
+		}
+	}
+
+	if(const auto components = node.find("components"); components != node.end() && components->is_array()) {
+		for(const auto& child: *components) {
+			if(!child.is_object()) continue;
+			ReloadState::Component component {child.value("id", ""), child.value("type", ""), parentGroupId};
+			if(const auto data = child.find("data"); data != child.end()) {
+				component.hash = HashJson(*data, parentGroupId);
+				state.hashes.insert_or_assign(component.id, *component.hash);
+				if(const auto previous = state.baseline->find(component.id); previous != state.baseline->end() && previous->second == *component.hash) continue;
+				component.jsonData = nlohmann::json(*data);
+			}
+			state.components.push_back(std::move(component));
+		}
+	}
+}
+
+void DiagramData::ApplyReload(ReloadState& state) {
+	gridData = state.grid;
+	// Groups expanded or collapsed while the file was read keep that too.
+	for(auto& [id, isExpanded]: state.isGroupExpandedMap) {
+		if(const auto it = isGroupExpandedMap.find(id); it != isGroupExpandedMap.end()) isExpanded = it->second;
+	}
+	groupMap = std::move(state.groupMap);
+	groupNameMap = std::move(state.groupNameMap);
+	isGroupExpandedMap = std::move(state.isGroupExpandedMap);
+	lazyGroups = std::move(state.lazyGroups);
+
+	bool isStructural = state.isGroupsChanged;
+	bool isHistoryStale = false;
+	std::size_t addedCount = 0;
+	std::size_t updatedCount = 0;
+
+	for(auto& incoming: state.components) {
+		Diagram::ComponentBase* component = nullptr;
+		if(const auto index = FindIndexedComponent(incoming.id)) {
+			auto& existing = componentList[*index];
+			if(existing->GetTypeName() == incoming.type) {
+				component = existing.get();
+				if(component->groupId != incoming.groupId) {
+					component->groupId = incoming.groupId;
+					isStructural = true;
+				}
+			} else if(auto created = CreateComponent(incoming.type)) {
+				// A component that changed its type is replaced where it stands.
+				if(Diagram::ComponentBase::GetSelected() == existing.get()) Diagram::ComponentBase::ClearSelection();
+				created->id = incoming.id;
+				created->groupId = incoming.groupId;
+				component = created.get();
+				existing = std::move(created);
+				isStructural = true;
+				isHistoryStale = true;
+			} else {
+				continue;
+			}
+			++updatedCount;
+		} else if(auto created = CreateComponent(incoming.type)) {
+			created->id = incoming.id;
+			created->groupId = incoming.groupId;
+			component = created.get();
+			componentIndex.insert_or_assign(incoming.id, componentList.size());
+			componentList.push_back(std::move(created));
+			isStructural = true;
+			++addedCount;
+		} else {
+			continue;
+		}
+
+		if(incoming.jsonData) component->JsonDeserialize(*incoming.jsonData);
+		else if(incoming.xmlNode) component->XmlDeserialize(incoming.xmlNode);
+		component->MarkDirty();
+		Diagram::TreeRenderer::Relabel(*component);
+	}
+
+	std::vector<std::size_t> removedIndices;
+	removedIndices.reserve(state.removedIds.size());
+	for(const auto& id: state.removedIds) {
+		if(const auto index = FindIndexedComponent(id)) removedIndices.push_back(*index);
+	}
+	if(!removedIndices.empty()) {
+		std::ranges::sort(removedIndices);
+		// Only the components after the first removed one move up.
+		std::size_t kept = removedIndices.front();
+		auto removed = removedIndices.begin();
+		for(std::size_t index = kept; index < componentList.size(); ++index) {
+			auto& component = componentList[index];
+			if(removed != removedIndices.end() && *removed == index) {
+				++removed;
+				if(Diagram::ComponentBase::GetSelected() == component.get()) Diagram::ComponentBase::ClearSelection();
+				componentIndex.erase(component->id);
+				component.reset();
+				continue;
+			}
+			componentIndex.insert_or_assign(component->id, kept);
+			componentList[kept++] = std::move(component);
+		}
+		componentList.resize(kept);
+		isStructural = true;
+		isHistoryStale = true;
+	}
+
+	componentHashes = std::make_shared<ComponentHashes>(std::move(state.hashes));
+	// History entries point at components; replaced and removed ones would leave them dangling.
+	if(isHistoryStale) history.Clear();
+	if(isStructural) {
+		// The index was kept up to date along the way.
+		const bool isIndexCurrent = indexedVersion == structureVersion;
+		MarkStructureChanged();
+		if(isIndexCurrent) indexedVersion = structureVersion;
+	}
+
+	const std::size_t removedCount = removedIndices.size();
+	if(addedCount + updatedCount + removedCount > 0) {
+		Notify::Info("Reloaded from disk: " + std::to_string(updatedCount) + " changed, " + std::to_string(addedCount) + " added, " + std::to_string(removedCount) + " removed");
+	}
+}
+
+std::optional<std::size_t> DiagramData::FindIndexedComponent(const std::string& id) {
+	if(indexedVersion != structureVersion) {
+		componentIndex.clear();
+		componentIndex.reserve(componentList.size());
+		for(std::size_t index = 0; index < componentList.size(); ++index) componentIndex.try_emplace(componentList[index]->id, index);
+		indexedVersion = structureVersion;
+	}
+	const auto it = componentIndex.find(id);
+	return it != componentIndex.end() ? std::optional(it->second) : std::nullopt;
+}
+
+DiagramData::ComponentHashes& DiagramData::EditComponentHashes() {
+	// A reload worker may be reading the current baseline.
+	if(componentHashes.use_count() > 1) componentHashes = std::make_shared<ComponentHashes>(*componentHashes);
+	return *componentHashes;
+}
+
+void DiagramData::MaterializeJournaledGroups(const std::vector<Journal::Entry>& entries) {
+	// Added components are not in any group's text; everything else names an element
+	// that may be, as does the target group of a regroup.
+	std::unordered_set<std::string_view> ids;
+	for(const auto& entry: entries) {
+		if(entry.op != Journal::Op::Add) ids.insert(entry.id);
+		if(entry.op == Journal::Op::Regroup || entry.op == Journal::Op::RegroupGroup) ids.insert(entry.text);
+	}
+	// Building a group indexes the collapsed groups nested in it, hence the rounds.
+	for(bool isProgressing = true; isProgressing;) {
+		isProgressing = false;
+		std::vector<std::string> groupIds;
+		for(const auto& [id, group]: lazyGroups) {
+			if(HoldsAnyId(group.Content(), ids)) groupIds.push_back(id);
+		}
+		for(const auto& id: groupIds) isProgressing |= MaterializeGroup(id);
+	}
+}
+
+void DiagramData::ApplyJournal(const std::vector<Journal::Entry>& entries) {
+	std::unordered_map<std::string, Diagram::ComponentBase*> componentsById;
+	for(const auto& component: componentList) componentsById.try_emplace(component->id, component.get());
+
+	const auto findBlock = [&componentsById](const std::string& id) -> Diagram::Block* {
+		const auto it = componentsById.find(id);
+		return it != componentsById.end() ? dynamic_cast<Diagram::Block*>(it->second) : nullptr;
+	};
+
+	for(const auto& entry: entries) {
+		switch(entry.op) {
+			case Journal::Op::Move:
+				if(auto* block = findBlock(entry.id)) {
+					block->data.position = entry.value;
+					block->MarkDirty();
+				}
+				break;
+			case Journal::Op::Resize:
+				if(auto* block = findBlock(entry.id)) {
+					block->data.size = entry.value;
+					block->MarkDirty();
+				}
+				break;
+			case Journal::Op::Relabel:
+				if(auto* block = findBlock(entry.id)) {
+					block->data.label = entry.text;
+					block->MarkDirty();
+				}
+				break;
+			case Journal::Op::Regroup:
+				if(const auto it = componentsById.find(entry.id); it != componentsById.end()) it->second->groupId = entry.text;
+				break;
+			case Journal::Op::RegroupGroup:
+				groupMap[entry.id] = entry.text;
+				break;
+			case Journal::Op::Add:
+			case Journal::Op::Update: {
+				pugi::xml_document doc;
+				if(!doc.load_string(entry.text.c_str())) break;
+				const auto node = doc.first_child();
+
+				if(entry.op == Journal::Op::Update) {
+					if(const auto it = componentsById.find(entry.id); it != componentsById.end()) {
+						it->second->XmlDeserialize(node);
+						it->second->MarkDirty();
+					}
+				} else if(auto component = CreateComponent(node.attribute("type").as_string())) {
+					component->id = entry.id;
+					component->groupId = node.attribute("group").as_string();
+					component->XmlDeserialize(node);
+					componentsById.insert_or_assign(entry.id, component.get());
+					componentList.push_back(std::move(component));
+				}
+				break;
+			}
+			case Journal::Op::Delete: {
+				const auto it = componentsById.find(entry.id);
+				if(it == componentsById.end()) break;
+				std::erase_if(componentList, [target = it->second](const auto& component) { return component.get() == target; });
+				componentsById.erase(it);
+				break;
+			}
+			case Journal::Op::Mark:
+				// Recover leaves them out.
+				break;
 		}
 	}
 }
 
 void DiagramData::AddBlock(bool isUsedCursorPosition, SDL_Window* window) noexcept {
-	const size_t blockCount = GetComponentsOfType<Diagram::Block>().size();
+	const size_t blockCount = CountComponentsOfType<Diagram::Block>() + GetUnloadedComponentCount();
 	auto newBlock = std::make_unique<Diagram::Block>();
 
 	if(isUsedCursorPosition && window) {
@@ -124,5 +1124,126 @@ void DiagramData::AddBlock(bool isUsedCursorPosition, SDL_Window* window) noexce
 
 	newBlock->data.label = "Block " + std::to_string(blockCount + 1);
 	newBlock->id = "block_" + std::to_string(blockCount + 1);
+	journal.RecordAdd(*newBlock);
+	history.RecordInsert(*newBlock, componentList.size());
 	componentList.push_back(std::move(newBlock));
+	MarkStructureChanged();
+}
+
+Diagram::Connector* DiagramData::AddConnector(const std::string& source, const std::string& target) noexcept {
+	const size_t connectorCount = CountComponentsOfType<Diagram::Connector>();
+	auto newConnector = std::make_unique<Diagram::Connector>();
+	newConnector->data.source = source;
+	newConnector->data.target = target;
+	newConnector->id = "connector_" + std::to_string(connectorCount + 1);
+	journal.RecordAdd(*newConnector);
+	history.RecordInsert(*newConnector, componentList.size());
+	auto* connector = newConnector.get();
+	componentList.push_back(std::move(newConnector));
+	MarkStructureChanged();
+	return connector;
+}
+
+void DiagramData::UpdateRoutes() {
+	router->Update(componentList, structureVersion);
+}
+
+void DiagramData::RecordMoves(const std::vector<std::pair<Diagram::Block*, Diagram::Block::Data>>& moved) {
+	std::vector<UndoHistory::Change> changes;
+	for(const auto& [block, before]: moved) {
+		auto fields = UndoHistory::DiffFields(before, block->data);
+		if(fields.empty()) continue;
+		journal.RecordMove(block->id, block->data.position);
+		UndoHistory::Change change {UndoHistory::Kind::Fields, block};
+		change.fields = std::move(fields);
+		changes.push_back(std::move(change));
+	}
+	history.Record(std::move(changes));
+}
+
+bool DiagramData::Undo() {
+	// A running layout is recorded first, so this undoes it.
+	Interrupt(false);
+	auto entry = history.PopUndo();
+	if(!entry) return false;
+	bool isStructural = false;
+	for(auto& change: entry->changes | std::views::reverse) isStructural |= ApplyChange(change, true);
+	history.PushRedo(std::move(*entry));
+	if(isStructural) MarkStructureChanged();
+	return true;
+}
+
+bool DiagramData::Redo() {
+	Interrupt(false);
+	auto entry = history.PopRedo();
+	if(!entry) return false;
+	bool isStructural = false;
+	for(auto& change: entry->changes) isStructural |= ApplyChange(change, false);
+	history.PushUndo(std::move(*entry));
+	if(isStructural) MarkStructureChanged();
+	return true;
+}
+
+std::vector<std::unique_ptr<Diagram::ComponentBase>>::iterator DiagramData::FindComponent(const Diagram::ComponentBase* component, const std::size_t index) {
+	// The index holds unless something outside the history reordered the list.
+	if(index < componentList.size() && componentList[index].get() == component) return componentList.begin() + static_cast<std::ptrdiff_t>(index);
+	return std::ranges::find(componentList, component, &std::unique_ptr<Diagram::ComponentBase>::get);
+}
+
+bool DiagramData::ApplyChange(UndoHistory::Change& change, const bool isUndo) {
+	auto* component = change.component;
+	switch(change.kind) {
+		case UndoHistory::Kind::Fields:
+			if(auto* block = dynamic_cast<Diagram::Block*>(component)) {
+				UndoHistory::ApplyFields(block->data, change.fields, isUndo);
+				block->MarkDirty();
+				journal.RecordUpdate(*block);
+			} else if(auto* connector = dynamic_cast<Diagram::Connector*>(component)) {
+				UndoHistory::ApplyFields(connector->data, change.fields, isUndo);
+				connector->MarkDirty();
+				journal.RecordUpdate(*connector);
+			}
+			// The revision tells everything else; only the tree row holds a copy of the name.
+			Diagram::TreeRenderer::Relabel(*component);
+			return false;
+		case UndoHistory::Kind::Regroup:
+			component->groupId = isUndo ? change.before : change.after;
+			journal.RecordRegroup(component->id, component->groupId);
+			break;
+		case UndoHistory::Kind::RegroupGroup:
+			groupMap[change.groupId] = isUndo ? change.before : change.after;
+			journal.RecordRegroupGroup(change.groupId, groupMap[change.groupId]);
+			break;
+		case UndoHistory::Kind::Swap: {
+			// A swap is its own inverse, so each component sits in one of the two slots.
+			const auto slotOf = [this, &change](const Diagram::ComponentBase* target) {
+				const bool isFirst = change.index < componentList.size() && componentList[change.index].get() == target;
+				return FindComponent(target, isFirst ? change.index : change.otherIndex);
+			};
+			const auto first = slotOf(component);
+			const auto second = slotOf(change.other);
+			if(first != componentList.end() && second != componentList.end()) std::iter_swap(first, second);
+			std::swap(component->groupId, change.other->groupId);
+			journal.RecordRegroup(component->id, component->groupId);
+			journal.RecordRegroup(change.other->id, change.other->groupId);
+			break;
+		}
+		case UndoHistory::Kind::Insert:
+		case UndoHistory::Kind::Delete:
+			if((change.kind == UndoHistory::Kind::Insert) == isUndo) {
+				const auto position = FindComponent(component, change.index);
+				if(position == componentList.end()) break;
+				change.index = static_cast<std::size_t>(position - componentList.begin());
+				change.payload = std::move(*position);
+				componentList.erase(position);
+				if(Diagram::ComponentBase::GetSelected() == component) Diagram::ComponentBase::ClearSelection();
+				journal.RecordDelete(component->id);
+			} else if(change.payload) {
+				const auto index = std::min(change.index, componentList.size());
+				journal.RecordAdd(*change.payload);
+				componentList.insert(componentList.begin() + static_cast<std::ptrdiff_t>(index), std::move(change.payload));
+			}
+			break;
+	}
+	return true;
 }
@@ -1,8 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../Diagram/Block.hpp"
@@ -10,11 +20,24 @@
 #include "../Diagram/Component.hpp"
 #include "../Diagram/Grid.hpp"
 #include "../Diagram/TreeRenderer.hpp"
+#include "../Utils/AccountedJson.hpp"
+#include "../Utils/FrameArena.hpp"
+#include "DiagramWriter.hpp"
+#include "Journal.hpp"
+#include "LazyGroup.hpp"
+#include "UndoHistory.hpp"
+
+namespace Diagram {
+	class AlignmentGuides;
+	class ConnectorRouter;
+}
 
 class DiagramData
 {
 public:
+	// Starts out empty; the application loads the first document itself.
 	DiagramData() noexcept;
+	~DiagramData();
 
 	static DiagramData* GetInstance() noexcept { return instance; }
 	static void SetInstance(DiagramData* newInstance) noexcept { instance = newInstance; }
@@ -24,15 +47,75 @@ public:
 	DiagramData(DiagramData&&) = delete;
 	DiagramData& operator=(DiagramData&&) = delete;
 
+	// Both pick the document format from the file extension, see Utils::IsJsonDocument.
 	void Load(const std::string& filePath);
-	void Save(const std::string& filePath) const;
+	void Save(const std::string& filePath);
+
+	// Shared between a background load and the UI showing it.
+	struct LoadProgress {
+		std::atomic<std::uint64_t> bytesRead = 0;
+		std::atomic<std::uint64_t> totalBytes = 0;
+		std::atomic<std::uint64_t> componentsBuilt = 0;
+		std::atomic<bool> isCancelled = false;
+	};
+
+	// Parses the document on a worker into a staging model while the current one stays
+	// live; PollLoad swaps it in. Starting another load cancels the running one.
+	void LoadAsync(const std::string& filePath);
+	// Call at a frame boundary. Returns the path of the document that was swapped in; a
+	// failed or cancelled load leaves the current model untouched.
+	std::optional<std::string> PollLoad();
+	void CancelLoad() noexcept;
+	bool IsLoading() const noexcept { return pendingLoad.has_value(); }
+	const std::string* GetLoadingPath() const noexcept { return pendingLoad ? &pendingLoad->filePath : nullptr; }
+	const LoadProgress* GetLoadProgress() const noexcept { return pendingLoad ? pendingLoad->progress.get() : nullptr; }
+
+	// Applies a change of the open file on disk as a component-level diff: components whose
+	// serialized form in the file did not change are left alone, so the camera, selection
+	// and unsaved edits to them survive. Rewrites by our own saves are recognized and skipped.
+	// The file is read and compared on a worker; PollReload applies the difference.
+	void Reload(const std::string& filePath);
+	void PollReload();
+	bool IsReloading() const noexcept { return pendingReload.has_value(); }
+
+	// Snapshots the model on the calling thread and writes it on a worker. A save requested
+	// while one is running is merged into a single follow-up save of the newest state.
+	void SaveAsync(const std::string& filePath, bool isQuiet = false);
+	void PollSave();
+	void WaitForSave();
+	bool IsSaving() const noexcept { return pendingSave.valid(); }
+
+	// Bumped by every change that reshapes the component tree: components added, removed
+	// or reordered, groups changed, labels edited. Views rebuild their models off it.
+	std::uint64_t GetStructureVersion() const noexcept { return structureVersion; }
+	void MarkStructureChanged() noexcept { ++structureVersion; }
+
+	Journal& GetJournal() noexcept { return journal; }
+	static Journal* GetActiveJournal() noexcept { return instance ? &instance->journal : nullptr; }
+
+	UndoHistory& GetHistory() noexcept { return history; }
+	const UndoHistory& GetHistory() const noexcept { return history; }
+	static UndoHistory* GetActiveHistory() noexcept { return instance ? &instance->history : nullptr; }
+	// Both journal what they apply, so recovery after a crash sees the undone state. Only
+	// entries that reshape the tree move the structure version; field edits are seen
+	// through revisions.
+	bool Undo();
+	bool Redo();
+	// Journals each block that moved from its `before` state and records them as one undo step.
+	void RecordMoves(const std::vector<std::pair<Diagram::Block*, Diagram::Block::Data>>& moved);
+
+	// For a command that moves blocks over several frames, such as a layout run. Called with
+	// true before the model is replaced, when the command should drop what it holds, and
+	// with false before an undo or redo, when it should record its moves first.
+	void SetInterruptHandler(std::function<void(bool isDiscarded)> handler) noexcept { onInterrupt = std::move(handler); }
 
 	const std::vector<std::unique_ptr<Diagram::ComponentBase>>& GetComponentList() const noexcept { return componentList; }
 	std::vector<std::unique_ptr<Diagram::ComponentBase>>& GetComponentList() noexcept { return componentList; }
 
+	// From the frame arena unless told otherwise, so only valid until the frame ends.
 	template<typename T>
-	std::vector<T*> GetComponentsOfType() const noexcept {
-		std::vector<T*> result;
+	std::pmr::vector<T*> GetComponentsOfType(std::pmr::memory_resource* resource = &Utils::FrameArena::Instance()) const noexcept {
+		std::pmr::vector<T*> result(resource);
 		for(const auto& comp: componentList) {
 			if(auto* typed = dynamic_cast<T*>(comp.get()))
 				result.push_back(typed);
@@ -40,31 +123,166 @@ public:
 		return result;
 	}
 
+	template<typename T>
+	std::size_t CountComponentsOfType() const noexcept {
+		return static_cast<std::size_t>(std::ranges::count_if(componentList, [](const auto& comp) { return dynamic_cast<const T*>(comp.get()) != nullptr; }));
+	}
+
+	// Sets the Strings line of the memory accounting to the heap bytes of the component
+	// strings and group ids and names. One pass over the components; run it when the
+	// accounting samples, not every frame.
+	void MeasureStrings() const noexcept;
+
 	const Diagram::Camera& GetCamera() const noexcept { return cameraData; }
 	Diagram::Camera& GetCamera() noexcept { return cameraData; }
 
 	const Diagram::Grid& GetGrid() const noexcept { return gridData; }
 	Diagram::Grid& GetGrid() noexcept { return gridData; }
 
+	// Guides of the block being dragged; empty while there is no drag.
+	const Diagram::AlignmentGuides& GetAlignmentGuides() const noexcept { return *alignmentGuides; }
+	Diagram::AlignmentGuides& GetAlignmentGuides() noexcept { return *alignmentGuides; }
+
 	Diagram::TreeRenderer::GroupState GetGroupState() const noexcept {
-		return {groupMap, groupNameMap, isGroupExpandedMap, nullptr, nullptr};
+		// Assigned rather than copy-constructed, which would leave the hierarchy resource.
+		Diagram::TreeRenderer::GroupState state;
+		state.parents = groupMap;
+		state.names = groupNameMap;
+		state.expanded = isGroupExpandedMap;
+		for(const auto& [id, group]: lazyGroups) state.unloaded.emplace(id, group.components);
+		return state;
 	}
-	void UpdateGroups(const std::map<std::string, std::string>& groups) noexcept { groupMap = groups; }
-	void UpdateGroupExpanded(const std::map<std::string, bool>& expanded) noexcept { isGroupExpandedMap = expanded; }
+	void UpdateGroups(const Diagram::GroupMap<std::string>& groups) noexcept;
+	// Expanding a group that is still lazy builds its components.
+	void UpdateGroupExpanded(const Diagram::GroupMap<bool>& expanded) noexcept;
+
+	// With lazy loading on, collapsed groups of XML documents are indexed at load and built
+	// on demand: when expanded, when their bounds enter the viewport, or before anything
+	// that needs the whole model (journal replay, JSON saves).
+	bool IsLazyLoading() const noexcept { return isLazyLoading; }
+	void SetLazyLoading(bool isEnabled);
+	bool MaterializeGroup(const std::string& groupId);
+	void MaterializeAllGroups();
+	void MaterializeVisibleGroups(glm::vec2 screenSize);
+	std::size_t GetUnloadedComponentCount() const noexcept;
 
 	void AddBlock(bool isUseCursorPosition = false, SDL_Window* window = nullptr) noexcept;
+	Diagram::Connector* AddConnector(const std::string& source, const std::string& target) noexcept;
+
+	// Re-routes the connectors affected by what changed since the last call, within a frame budget.
+	void UpdateRoutes();
+	const Diagram::ConnectorRouter& GetRouter() const noexcept { return *router; }
 
 private:
 	inline static DiagramData* instance = nullptr;
 
+	struct Snapshot;
+	struct ReloadState;
+	using ComponentHashes = DiagramWriter::ComponentHashes;
+	using FileSignature = std::pair<std::filesystem::file_time_type, std::uintmax_t>;
+
+	struct PendingLoad {
+		std::string filePath;
+		std::unique_ptr<LoadProgress> progress;
+		std::unique_ptr<DiagramData> staging;
+		// Last, so it is destroyed first and waits for the worker that uses the others.
+		std::future<bool> isLoaded;
+	};
+
+	struct PendingReload {
+		std::string filePath;
+		FileSignature signature;
+		std::uint64_t structureVersion = 0;
+		// Set when another document replaced the one being compared.
+		bool isDiscarded = false;
+		std::future<std::unique_ptr<ReloadState>> state;
+	};
+
+	struct SaveResult {
+		bool isSaved = false;
+		std::string filePath;
+		std::string error;
+		std::unique_ptr<DiagramWriter> writer;
+		std::uint64_t checkpoint = 0;
+		bool isQuiet = false;
+		ComponentHashes componentHashes;
+		std::optional<FileSignature> signature;
+	};
+
 	std::unique_ptr<Diagram::ComponentBase> CreateComponent(const std::string& type) const;
-	void LoadHierarchy(pugi::xml_node node, const std::string& parentGroupId);
-	void SaveHierarchy(pugi::xml_node node, const std::string& groupId) const;
+	bool Parse(const std::string& filePath);
+	void FinishLoad(const std::string& filePath);
+	void Adopt(DiagramData& staged);
+	bool IsLoadCancelled() const noexcept { return loadProgress && loadProgress->isCancelled.load(std::memory_order_relaxed); }
+	bool LoadXml(const std::string& filePath);
+	bool LoadJson(const std::string& filePath);
+	// `document` is the text the nodes were parsed from, starting at `baseOffset`; without it
+	// every group is built eagerly.
+	void LoadHierarchy(pugi::xml_node node, const std::string& parentGroupId, const std::shared_ptr<const std::string>& document = nullptr, std::size_t baseOffset = 0);
+	void LoadJsonHierarchy(const Utils::AccountedJson& node, const std::string& parentGroupId);
+	// Worker side of Reload.
+	static void ReadReload(const std::string& filePath, ReloadState& state);
+	static void ScanXmlHierarchy(const pugi::xml_node& node, const std::string& parentGroupId, const std::shared_ptr<const std::string>& document, ReloadState& state);
+	static void ScanJsonHierarchy(const Utils::AccountedJson& node, const std::string& parentGroupId, ReloadState& state);
+	void ApplyReload(ReloadState& state);
+	// Position of the first component with `id` in the list.
+	std::optional<std::size_t> FindIndexedComponent(const std::string& id);
+	// The baseline, copied first if a reload is reading it.
+	ComponentHashes& EditComponentHashes();
+	// Builds only the lazy groups holding what the entries touch, so a recovered edit
+	// leaves the rest of the file lazy.
+	void MaterializeJournaledGroups(const std::vector<Journal::Entry>& entries);
+	void ApplyJournal(const std::vector<Journal::Entry>& entries);
+	// Returns whether the change reshaped the component list or the groups.
+	bool ApplyChange(UndoHistory::Change& change, bool isUndo);
+	// Where `component` is in the list, trying the recorded `index` before searching.
+	std::vector<std::unique_ptr<Diagram::ComponentBase>>::iterator FindComponent(const Diagram::ComponentBase* component, std::size_t index);
+	void Interrupt(bool isDiscarded) {
+		if(onInterrupt) onInterrupt(isDiscarded);
+	}
+	void StartSave(const std::string& filePath, bool isQuiet);
+	void FinishSave();
 
 	std::vector<std::unique_ptr<Diagram::ComponentBase>> componentList;
 	Diagram::Camera cameraData;
 	Diagram::Grid gridData;
-	std::map<std::string, std::string> groupMap;
-	std::map<std::string, std::string> groupNameMap;
-	std::map<std::string, bool> isGroupExpandedMap;
+	std::unique_ptr<Diagram::AlignmentGuides> alignmentGuides;
+	Diagram::GroupMap<std::string> groupMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<std::string> groupNameMap{Diagram::GroupMapResource()};
+	Diagram::GroupMap<bool> isGroupExpandedMap{Diagram::GroupMapResource()};
+	std::map<std::string, LazyGroup> lazyGroups;
+	bool isLazyLoading = true;
+	std::uint64_t structureVersion = 0;
+	std::unique_ptr<Diagram::ConnectorRouter> router;
+	std::function<void(bool isDiscarded)> onInterrupt;
+
+	// Hash of each built component's text as last read from or written to the open file;
+	// a reload only touches components whose hash in the file differs. Shared with the
+	// reload worker, so it is replaced or copied rather than changed under it.
+	std::shared_ptr<ComponentHashes> componentHashes = std::make_shared<ComponentHashes>();
+	std::optional<FileSignature> syncedSignature;
+	// Journal mark of the open file as last read or written; recovery replays what the
+	// journal holds after it.
+	std::string journalMark;
+	std::optional<PendingReload> pendingReload;
+	std::optional<std::string> queuedReloadPath;
+	// Component ids to their positions in the list, rebuilt when the structure version
+	// moved past `indexedVersion`.
+	std::unordered_map<std::string, std::size_t> componentIndex;
+	std::optional<std::uint64_t> indexedVersion;
+
+	// Owned by the save worker while a save is in flight.
+	std::unique_ptr<DiagramWriter> writer = std::make_unique<DiagramWriter>();
+	std::future<SaveResult> pendingSave;
+	std::optional<std::string> queuedSavePath;
+	bool isQueuedSaveQuiet = true;
+
+	std::optional<PendingLoad> pendingLoad;
+	// Cancelled loads whose workers have not noticed yet; reaped by PollLoad.
+	std::vector<PendingLoad> cancelledLoads;
+	// Set on staging models only; the worker reports into it and polls it for cancellation.
+	LoadProgress* loadProgress = nullptr;
+
+	Journal journal;
+	UndoHistory history;
 };
@@ -0,0 +1,290 @@
+#include "DiagramWriter.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+#include "../Utils/AtomicFile.hpp"
+#include "../Utils/Path.hpp"
+
+namespace {
+	// Stand-in child whose printed line marks where cached fragments are spliced in.
+	constexpr const char* SPLICE_NAME = "_splice";
+	constexpr const char* SPLICE_ELEMENT = "<_splice />";
+
+	struct StringWriter final : pugi::xml_writer {
+		std::string& out;
+
+		explicit StringWriter(std::string& target) : out(target) {}
+		void write(const void* data, size_t size) override { out.append(static_cast<const char*>(data), size); }
+	};
+
+	// Printing through pugixml keeps its escaping and indentation, which is what makes
+	// the spliced output byte-identical to a save of the full document.
+	std::string PrintNode(const pugi::xml_node& node, const unsigned depth) {
+		std::string text;
+		StringWriter writer(text);
+		node.print(writer, "\t", pugi::format_default, pugi::encoding_auto, depth);
+		return text;
+	}
+
+	// A printed fragment without its indentation and line break, which is the element as
+	// a parser of the file finds it.
+	std::string_view TrimFragment(std::string_view fragment) noexcept {
+		fragment.remove_prefix(std::min(fragment.find_first_not_of('\t'), fragment.size()));
+		while(!fragment.empty() && (fragment.back() == '\n' || fragment.back() == '\r')) fragment.remove_suffix(1);
+		return fragment;
+	}
+
+	std::string IdOf(const Diagram::ComponentBase& component) {
+		return component.id.empty() ? "comp" + std::to_string(reinterpret_cast<uintptr_t>(&component)) : component.id;
+	}
+}
+
+std::size_t DiagramWriter::HashComponent(const std::string_view element, const std::string_view groupId) noexcept {
+	const std::size_t hash = std::hash<std::string_view> {}(element);
+	// With the group folded in, a component moved to another group counts as changed.
+	return hash ^ (std::hash<std::string_view> {}(groupId) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+bool DiagramWriter::Write(const std::string& filePath, const Source& source, std::string& error, ComponentHashes* hashes) {
+	if(Utils::IsJsonDocument(filePath)) return WriteJson(filePath, source, error, hashes);
+
+	pugi::xml_document doc;
+	auto declarationNode = doc.append_child(pugi::node_declaration);
+	declarationNode.append_attribute("version") = "1.0";
+	declarationNode.append_attribute("encoding") = "UTF-8";
+
+	auto diagram = doc.append_child("Diagram");
+	if(!source.journalMark.empty()) diagram.append_attribute("journal").set_value(std::string(source.journalMark).c_str());
+
+	auto cameraNode = diagram.append_child("Camera");
+	source.camera.XmlSerialize(cameraNode);
+
+	auto gridNode = diagram.append_child("Grid");
+	source.grid.XmlSerialize(gridNode);
+
+	auto rootNode = diagram.append_child("Root");
+
+	const auto index = BuildHierarchyIndex(source);
+	Utils::AtomicFile file(filePath);
+	if(!file.IsOpen()) {
+		error = "cannot open " + filePath + ".tmp";
+		return false;
+	}
+	pugi::xml_writer_file out(file.Get());
+
+	if(!index.HasChildren("")) {
+		doc.save(out, "\t", pugi::format_default, pugi::encoding_auto);
+	} else {
+		// Only the small document head is rebuilt through pugixml; the hierarchy is
+		// streamed from the per-group caches into the gap left by the placeholder.
+		rootNode.append_child(SPLICE_NAME);
+		const std::string head = PrintNode(doc, 0);
+		const auto placeholder = head.find(SPLICE_ELEMENT);
+		const auto lineBegin = head.rfind('\n', placeholder) + 1;
+		const auto lineEnd = head.find('\n', placeholder) + 1;
+
+		out.write(head.data(), lineBegin);
+		WriteHierarchy(out, source, "", 2, index, hashes);
+		out.write(head.data() + lineEnd, head.size() - lineEnd);
+	}
+
+	std::erase_if(cache, [&index](const auto& entry) { return !index.components.contains(entry.first) && !index.IsClean(entry.first); });
+	return file.Commit(error);
+}
+
+std::unordered_set<std::string> DiagramWriter::FindCleanGroups(const Source& source) const {
+	std::unordered_set<std::string> cleanGroups;
+	const auto revisionOf = [](const Diagram::ComponentBase* component) { return component->GetRevision(); };
+	for(const auto& [groupId, components]: BuildHierarchyIndex(source).components) {
+		const auto it = cache.find(groupId);
+		if(it == cache.end() || !std::ranges::equal(it->second.revisions, components, {}, {}, revisionOf)) continue;
+		if(it->second.depth == DepthOf(source, groupId)) cleanGroups.insert(groupId);
+	}
+	return cleanGroups;
+}
+
+unsigned DiagramWriter::DepthOf(const Source& source, const std::string& groupId) {
+	// The root's components sit in <Diagram><Root>, and each group nests one deeper. The
+	// walk stops after as many steps as there are groups, in case of a cycle.
+	unsigned depth = 2;
+	const std::string* current = &groupId;
+	for(std::size_t steps = 0; !current->empty() && steps <= source.groups.size(); ++steps) {
+		const auto parent = source.groups.find(*current);
+		if(parent == source.groups.end()) break;
+		current = &parent->second;
+		++depth;
+	}
+	return depth;
+}
+
+DiagramWriter::HierarchyIndex DiagramWriter::BuildHierarchyIndex(const Source& source) {
+	HierarchyIndex index;
+	index.cleanGroups = source.cleanGroups;
+	for(const auto& [id, parent]: source.groups) {
+		index.childGroups[parent].push_back(&id);
+	}
+	for(const auto& component: source.components) {
+		index.components[component->groupId].push_back(component.get());
+	}
+	return index;
+}
+
+// Mirrors the XML layout: {"Camera", "Grid", "Root"}, where every group object holds
+// its nested "groups" and "components" arrays.
+bool DiagramWriter::WriteJson(const std::string& filePath, const Source& source, std::string& error, ComponentHashes* hashes) {
+	nlohmann::json doc;
+	auto& diagram = doc["Diagram"];
+	if(!source.journalMark.empty()) diagram["journal"] = source.journalMark;
+	source.camera.JsonSerialize(diagram["Camera"]);
+	source.grid.JsonSerialize(diagram["Grid"]);
+	BuildJsonHierarchy(diagram["Root"], source, "", BuildHierarchyIndex(source), hashes);
+
+	Utils::AtomicFile file(filePath);
+	if(!file.IsOpen()) {
+		error = "cannot open " + filePath + ".tmp";
+		return false;
+	}
+	const std::string text = doc.dump(1, '\t');
+	if(std::fwrite(text.data(), 1, text.size(), file.Get()) != text.size()) {
+		error = "cannot write " + filePath + ".tmp";
+		return false;
+	}
+	return file.Commit(error);
+}
+
+void DiagramWriter::BuildJsonHierarchy(nlohmann::json& node, const Source& source, const std::string& groupId, const HierarchyIndex& index, ComponentHashes* hashes) {
+	node = nlohmann::json::object();
+	if(const auto it = index.childGroups.find(groupId); it != index.childGroups.end()) {
+		auto& groups = node["groups"] = nlohmann::json::array();
+		for(const std::string* childId: it->second) {
+			nlohmann::json groupNode;
+			BuildJsonHierarchy(groupNode, source, *childId, index, hashes);
+			groupNode["id"] = *childId;
+			groupNode["name"] = source.groupNames.contains(*childId) ? source.groupNames.at(*childId) : *childId;
+			groupNode["expanded"] = source.groupExpanded.contains(*childId) && source.groupExpanded.at(*childId);
+			groups.push_back(std::move(groupNode));
+		}
+	}
+
+	if(const auto it = index.components.find(groupId); it != index.components.end()) {
+		auto& components = node["components"] = nlohmann::json::array();
+		for(const auto* component: it->second) {
+			nlohmann::json componentNode;
+			const std::string id = IdOf(*component);
+			componentNode["id"] = id;
+			componentNode["type"] = component->GetTypeName();
+			component->JsonSerialize(componentNode["data"]);
+			if(hashes) hashes->insert_or_assign(id, HashComponent(componentNode["data"].dump(), groupId));
+			components.push_back(std::move(componentNode));
+		}
+	}
+}
+
+void DiagramWriter::WriteHierarchy(pugi::xml_writer& out, const Source& source, const std::string& groupId, const unsigned depth, const HierarchyIndex& index, ComponentHashes* hashes) {
+	if(const auto it = index.childGroups.find(groupId); it != index.childGroups.end()) {
+		for(const std::string* childId: it->second) {
+			pugi::xml_document scratch;
+			auto groupNode = scratch.append_child("Group");
+			groupNode.append_attribute("id").set_value(childId->c_str());
+			groupNode.append_attribute("name").set_value(source.groupNames.contains(*childId) ? source.groupNames.at(*childId).c_str() : childId->c_str());
+			groupNode.append_attribute("expanded").set_value(source.groupExpanded.contains(*childId) && source.groupExpanded.at(*childId));
+
+			const auto lazy = source.lazyGroups.find(*childId);
+			const bool isLazy = lazy != source.lazyGroups.end();
+			if(!isLazy && !index.HasChildren(*childId)) {
+				groupNode.print(out, "\t", pugi::format_default, pugi::encoding_auto, depth);
+				continue;
+			}
+
+			groupNode.append_child(SPLICE_NAME);
+			const std::string element = PrintNode(groupNode, depth);
+			const auto openEnd = element.find('\n') + 1;
+			const auto closeBegin = element.rfind('\n', element.size() - 2) + 1;
+
+			out.write(element.data(), openEnd);
+			if(isLazy) {
+				// Never built, so the loaded text is still exactly what the group holds.
+				const auto content = lazy->second.Content();
+				out.write(content.data(), content.size());
+			}
+			WriteHierarchy(out, source, *childId, depth + 1, index, hashes);
+			out.write(element.data() + closeBegin, element.size() - closeBegin);
+		}
+	}
+
+	const GroupCache* groupCache = nullptr;
+	if(index.IsClean(groupId)) {
+		groupCache = &cache.at(groupId);
+	} else if(const auto it = index.components.find(groupId); it != index.components.end()) {
+		groupCache = &CacheGroupComponents(groupId, it->second, depth);
+	}
+	if(groupCache) {
+		out.write(groupCache->content.data(), groupCache->content.size());
+		if(hashes) {
+			for(std::size_t i = 0; i < groupCache->ids.size(); ++i) hashes->insert_or_assign(groupCache->ids[i], groupCache->hashes[i]);
+		}
+	}
+}
+
+const DiagramWriter::GroupCache& DiagramWriter::CacheGroupComponents(const std::string& groupId, const std::vector<const Diagram::ComponentBase*>& components, const unsigned depth) {
+	auto& groupCache = cache[groupId];
+	const auto revisionOf = [](const Diagram::ComponentBase* component) { return component->GetRevision(); };
+	if(groupCache.depth == depth && std::ranges::equal(groupCache.revisions, components, {}, {}, revisionOf)) {
+		return groupCache;
+	}
+
+	GroupCache rebuilt;
+	rebuilt.depth = depth;
+	rebuilt.revisions.reserve(components.size());
+	rebuilt.offsets.reserve(components.size() + 1);
+	rebuilt.hashes.reserve(components.size());
+	rebuilt.ids.reserve(components.size());
+	rebuilt.content.reserve(groupCache.content.size());
+
+	// Fragments are indented for their depth, so they only survive a save at the same depth.
+	const bool canReuse = groupCache.depth == depth && !groupCache.revisions.empty();
+	std::unordered_map<std::uint64_t, std::size_t> previousIndex;
+	pugi::xml_document scratch;
+
+	for(std::size_t i = 0; i < components.size(); ++i) {
+		const auto* component = components[i];
+		const std::uint64_t revision = component->GetRevision();
+		rebuilt.revisions.push_back(revision);
+		rebuilt.offsets.push_back(rebuilt.content.size());
+
+		std::size_t previous = SIZE_MAX;
+		if(canReuse) {
+			if(i < groupCache.revisions.size() && groupCache.revisions[i] == revision) {
+				previous = i;
+			} else {
+				if(previousIndex.empty()) {
+					for(std::size_t j = 0; j < groupCache.revisions.size(); ++j) previousIndex.emplace(groupCache.revisions[j], j);
+				}
+				if(const auto found = previousIndex.find(revision); found != previousIndex.end()) previous = found->second;
+			}
+		}
+
+		if(previous != SIZE_MAX) {
+			rebuilt.content.append(groupCache.content, groupCache.offsets[previous], groupCache.offsets[previous + 1] - groupCache.offsets[previous]);
+			rebuilt.hashes.push_back(groupCache.hashes[previous]);
+			rebuilt.ids.push_back(groupCache.ids[previous]);
+			continue;
+		}
+
+		scratch.remove_children();
+		auto componentNode = scratch.append_child("Component");
+		rebuilt.ids.push_back(IdOf(*component));
+		componentNode.append_attribute("id").set_value(rebuilt.ids.back().c_str());
+		componentNode.append_attribute("type").set_value(component->GetTypeName().c_str());
+		component->XmlSerialize(componentNode);
+		StringWriter writer(rebuilt.content);
+		componentNode.print(writer, "\t", pugi::format_default, pugi::encoding_auto, depth);
+		rebuilt.hashes.push_back(HashComponent(TrimFragment(std::string_view(rebuilt.content).substr(rebuilt.offsets.back())), groupId));
+	}
+	rebuilt.offsets.push_back(rebuilt.content.size());
+
+	groupCache = std::move(rebuilt);
+	return groupCache;
+}
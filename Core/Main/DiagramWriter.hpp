@@ -0,0 +1,95 @@
+#pragma once
+
+#include <pugixml.hpp>
+#include <nlohmann/json_fwd.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../Diagram/Camera.hpp"
+#include "../Diagram/Component.hpp"
+#include "../Diagram/Grid.hpp"
+#include "../Diagram/GroupMap.hpp"
+#include "LazyGroup.hpp"
+
+// Incremental XML writer for diagram documents. It keeps the serialized fragments
+// of every group's direct components between saves, so a save re-serializes only
+// what changed and splices it between cached bytes of the untouched parts.
+// Paths with a .json extension are written as JSON instead, always in full.
+class DiagramWriter
+{
+public:
+	struct Source {
+		const Diagram::Camera& camera;
+		const Diagram::Grid& grid;
+		const Diagram::GroupMap<std::string>& groups;
+		const Diagram::GroupMap<std::string>& groupNames;
+		const Diagram::GroupMap<bool>& groupExpanded;
+		const std::vector<std::unique_ptr<Diagram::ComponentBase>>& components;
+		const std::map<std::string, LazyGroup>& lazyGroups;
+		// Groups written from their cached fragments as they are; `components` may leave
+		// out what is in them. See FindCleanGroups.
+		const std::unordered_set<std::string>* cleanGroups = nullptr;
+		// Written into the document, so recovery knows which journal entries it holds.
+		std::string_view journalMark;
+	};
+
+	// Component id to HashComponent of what was written for it.
+	using ComponentHashes = std::unordered_map<std::string, std::size_t>;
+
+	// With `hashes`, also reports the hash of every component written, taken from the
+	// fragments themselves so the file need not be read back.
+	bool Write(const std::string& filePath, const Source& source, std::string& error, ComponentHashes* hashes = nullptr);
+	void Reset() noexcept { cache.clear(); }
+
+	// Groups whose cached fragments match their components, revisions and depth, so that
+	// a snapshot for a later Write need not copy the components in them.
+	std::unordered_set<std::string> FindCleanGroups(const Source& source) const;
+
+	// The baseline a reload compares the file against: a <Component> element as it stands
+	// in the text, or the dumped "data" object of a JSON component, together with the
+	// group it is in.
+	static std::size_t HashComponent(std::string_view element, std::string_view groupId) noexcept;
+
+private:
+	// Serialized <Component> fragments of one group's direct components, back to back.
+	// A group is re-serialized only when its component sequence or a revision changed,
+	// and even then clean fragments are copied over instead of being rebuilt.
+	struct GroupCache {
+		unsigned depth = 0;
+		std::vector<std::uint64_t> revisions;
+		std::vector<std::size_t> offsets;
+		std::vector<std::size_t> hashes;
+		std::vector<std::string> ids;
+		std::string content;
+	};
+
+	struct HierarchyIndex {
+		std::unordered_map<std::string, std::vector<const std::string*>> childGroups;
+		std::unordered_map<std::string, std::vector<const Diagram::ComponentBase*>> components;
+		const std::unordered_set<std::string>* cleanGroups = nullptr;
+
+		bool IsClean(const std::string& groupId) const noexcept {
+			return cleanGroups && cleanGroups->contains(groupId);
+		}
+		bool HasChildren(const std::string& groupId) const noexcept {
+			return childGroups.contains(groupId) || components.contains(groupId) || IsClean(groupId);
+		}
+	};
+
+	static HierarchyIndex BuildHierarchyIndex(const Source& source);
+	static bool WriteJson(const std::string& filePath, const Source& source, std::string& error, ComponentHashes* hashes);
+	static void BuildJsonHierarchy(nlohmann::json& node, const Source& source, const std::string& groupId, const HierarchyIndex& index, ComponentHashes* hashes);
+	void WriteHierarchy(pugi::xml_writer& out, const Source& source, const std::string& groupId, unsigned depth, const HierarchyIndex& index, ComponentHashes* hashes);
+	// The depth WriteHierarchy writes the components of a group at.
+	static unsigned DepthOf(const Source& source, const std::string& groupId);
+	const GroupCache& CacheGroupComponents(const std::string& groupId, const std::vector<const Diagram::ComponentBase*>& components, unsigned depth);
+
+	std::unordered_map<std::string, GroupCache> cache;
+};
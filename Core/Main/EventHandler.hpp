@@ -6,8 +6,10 @@
 #include <glm/vec2.hpp>
 #include <ranges>
 
+#include "../Diagram/Block.hpp"
 #include "../Diagram/Camera.hpp"
 #include "../Diagram/Component.hpp"
+#include "DiagramData.hpp"
 
 class EventHandler
 {
@@ -26,6 +28,8 @@ public:
 				camera.panStart = camera.data.position;
 				camera.mouseStart = {static_cast<float>(event.button.x), static_cast<float>(event.button.y)};
 			} else if(event.button.button == SDL_BUTTON_LEFT) {
+				// Shift-clicking another block connects the selected block to it.
+				const auto *source = (SDL_GetModState() & KMOD_SHIFT) ? dynamic_cast<const Diagram::Block *>(Diagram::ComponentBase::GetSelected()) : nullptr;
 				Diagram::ComponentBase::ClearSelection();
 				for(auto &item: std::ranges::reverse_view(componentList)) {
 					if(item->HandleEvent(event, camera, screenSize)) {
@@ -33,6 +37,10 @@ public:
 						break;
 					}
 				}
+				const auto *target = dynamic_cast<const Diagram::Block *>(Diagram::ComponentBase::GetSelected());
+				if(source && target && target != source) {
+					if(auto *diagramData = DiagramData::GetInstance()) diagramData->AddConnector(source->id, target->id);
+				}
 			}
 		} else if(event.type == SDL_MOUSEBUTTONUP && event.button.button == SDL_BUTTON_MIDDLE) {
 			camera.panning = false;
@@ -44,8 +52,11 @@ public:
 														  return comp.get() == selected;
 													  });
 					   it != componentList.end()) {
+						if(auto *journal = DiagramData::GetActiveJournal()) journal->RecordDelete(selected->id);
+						if(auto *history = DiagramData::GetActiveHistory()) history->RecordDelete(*it, static_cast<std::size_t>(it - componentList.begin()));
 						componentList.erase(it);
 						Diagram::ComponentBase::ClearSelection();
+						if(auto *diagramData = DiagramData::GetInstance()) diagramData->MarkStructureChanged();
 					}
 				}
 			}
@@ -0,0 +1,145 @@
+#include "FontCache.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <span>
+
+#include "../Utils/AtomicFile.hpp"
+#include "../Utils/Path.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr int INDEX_VERSION = 1;
+
+#ifdef __EMSCRIPTEN__
+	// Preloaded with the page.
+	const char* const TEXT_FONT_PATHS[] = {
+		"Assets/fonts/LiberationSans-Regular.ttf"};
+#else
+	const char* const TEXT_FONT_PATHS[] = {
+		"/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+		"/usr/share/fonts/TTF/arial.ttf",
+		"/System/Library/Fonts/Helvetica.ttc",
+		"/Windows/Fonts/arial.ttf",
+		"/Windows/Fonts/segoeui.ttf"};
+#endif
+
+	const std::string ICON_FONT_PATHS[] = {
+		"Assets/fonts/fa-solid-900.ttf",
+		std::string(PROJECT_SOURCE_DIR) + "/Assets/fonts/fa-solid-900.ttf"};
+
+	struct Stamp {
+		std::int64_t modifiedTime = 0;
+		std::uintmax_t size = 0;
+	};
+
+	std::optional<Stamp> StampOf(const fs::path& path) {
+		std::error_code error;
+		const auto size = fs::file_size(path, error);
+		if(error) return std::nullopt;
+		const auto modifiedTime = fs::last_write_time(path, error);
+		if(error) return std::nullopt;
+		return Stamp {static_cast<std::int64_t>(modifiedTime.time_since_epoch().count()), size};
+	}
+
+	std::optional<std::vector<std::uint8_t>> ReadFile(const fs::path& path) {
+		std::ifstream stream(path, std::ios::binary);
+		if(!stream) return std::nullopt;
+		std::vector<std::uint8_t> data {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+		if(data.empty()) return std::nullopt;
+		return data;
+	}
+
+	// A recorded font is used as is while its size and mtime match; its hash is then
+	// taken from the index instead of over the file again.
+	std::optional<FontCache::Font> ReadRecorded(const nlohmann::json& record) {
+		if(!record.is_object()) return std::nullopt;
+		const auto path = record.value("path", std::string());
+		const auto stamp = StampOf(path);
+		if(!stamp || stamp->modifiedTime != record.value("modifiedTime", std::int64_t {0}) || stamp->size != record.value("size", std::uintmax_t {0})) return std::nullopt;
+
+		auto data = ReadFile(path);
+		if(!data || data->size() != stamp->size) return std::nullopt;
+		return FontCache::Font {path, std::move(*data), record.value("hash", std::uint64_t {0})};
+	}
+
+	std::optional<FontCache::Font> Probe(const std::span<const std::string> candidates) {
+		for(const auto& path: candidates) {
+			if(!fs::exists(path)) continue;
+			auto data = ReadFile(path);
+			if(!data) continue;
+			const auto hash = FontCache::Hash(data->data(), data->size());
+			return FontCache::Font {path, std::move(*data), hash};
+		}
+		return std::nullopt;
+	}
+
+	nlohmann::json Record(const std::optional<FontCache::Font>& font) {
+		if(!font) return nullptr;
+		const auto stamp = StampOf(font->path);
+		if(!stamp) return nullptr;
+		return {{"path", font->path}, {"modifiedTime", stamp->modifiedTime}, {"size", stamp->size}, {"hash", font->hash}};
+	}
+}
+
+FontCache::FontCache(fs::path cacheDirectory, const std::uint64_t configKey)
+	: cacheDirectory(std::move(cacheDirectory)), configKey(configKey) {
+#ifdef __EMSCRIPTEN__
+	Load();
+#else
+	worker = std::thread(&FontCache::Load, this);
+#endif
+}
+
+FontCache::~FontCache() {
+	if(worker.joinable()) worker.join();
+}
+
+const FontCache::Fonts& FontCache::Wait() {
+	if(worker.joinable()) worker.join();
+	return fonts;
+}
+
+std::uint64_t FontCache::Hash(const void* data, const std::size_t size, std::uint64_t seed) noexcept {
+	// FNV-1a; only compared against itself.
+	const auto* bytes = static_cast<const std::uint8_t*>(data);
+	for(std::size_t i = 0; i < size; ++i) {
+		seed ^= bytes[i];
+		seed *= 0x100000001b3ull;
+	}
+	return seed;
+}
+
+void FontCache::Load() {
+	const auto indexPath = cacheDirectory / "index.json";
+	const std::vector<std::string> textPaths(std::begin(TEXT_FONT_PATHS), std::end(TEXT_FONT_PATHS));
+
+	nlohmann::json index;
+	if(std::ifstream stream(indexPath); stream) index = nlohmann::json::parse(stream, nullptr, false);
+	const bool isIndexValid = index.is_object() && index.value("version", 0) == INDEX_VERSION && index.value("configKey", std::uint64_t {0}) == configKey;
+
+	if(isIndexValid) {
+		fonts.text = ReadRecorded(index["text"]);
+		fonts.icons = ReadRecorded(index["icons"]);
+	}
+	fonts.isFromCache = fonts.text && fonts.icons;
+	if(fonts.isFromCache) return;
+
+	// A font that went missing since the index was written is looked for again too.
+	if(!fonts.text) fonts.text = Probe(textPaths);
+	if(!fonts.icons) fonts.icons = Probe(ICON_FONT_PATHS);
+	if(!fonts.text && !fonts.icons) return;
+
+	// A lost index write only costs probing again next time.
+	std::error_code error;
+	fs::create_directories(cacheDirectory, error);
+	const nlohmann::json updated = {{"version", INDEX_VERSION}, {"configKey", configKey}, {"text", Record(fonts.text)}, {"icons", Record(fonts.icons)}};
+	const auto text = updated.dump(1, '\t');
+	Utils::AtomicFile file(indexPath);
+	if(!file.IsOpen()) return;
+	std::fwrite(text.data(), 1, text.size(), file.Get());
+	std::string ignored;
+	file.Commit(ignored);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Finds and reads the UI fonts on a worker thread while the window and renderer come
+// up, so ImGui gets them from memory. The resolved paths are kept on disk with the size,
+// mtime and content hash of each file and a hash of the font config; while all of those
+// still match, a warm start reads the recorded files directly instead of probing the
+// candidate locations again.
+class FontCache
+{
+public:
+	struct Font {
+		std::string path;
+		std::vector<std::uint8_t> data;
+		std::uint64_t hash = 0;
+	};
+
+	struct Fonts {
+		std::optional<Font> text;
+		std::optional<Font> icons;
+		bool isFromCache = false;
+	};
+
+	// `configKey` is a hash of everything that shapes the atlas besides the files.
+	FontCache(std::filesystem::path cacheDirectory, std::uint64_t configKey);
+	~FontCache();
+
+	FontCache(const FontCache&) = delete;
+	FontCache& operator=(const FontCache&) = delete;
+	FontCache(FontCache&&) = delete;
+	FontCache& operator=(FontCache&&) = delete;
+
+	// Blocks until the fonts are read. The data stays owned here, so the atlas must not
+	// outlive this object.
+	const Fonts& Wait();
+
+	static std::uint64_t Hash(const void* data, std::size_t size, std::uint64_t seed = 0xcbf29ce484222325ull) noexcept;
+
+private:
+	void Load();
+
+	std::filesystem::path cacheDirectory;
+	std::uint64_t configKey = 0;
+	Fonts fonts;
+	std::thread worker;
+};
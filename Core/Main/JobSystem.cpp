@@ -0,0 +1,252 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <limits>
+
+namespace {
+	// The system and worker the current thread belongs to, if it is a worker.
+	thread_local const void* currentSystem = nullptr;
+	thread_local std::size_t currentIndex = 0;
+
+	constexpr std::size_t NO_WORKER = std::numeric_limits<std::size_t>::max();
+}
+
+std::size_t JobSystem::DefaultWorkerCount() noexcept {
+#ifdef __EMSCRIPTEN__
+	return 0;
+#else
+	const unsigned hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 1;
+#endif
+}
+
+JobSystem::JobSystem(std::size_t workerCount) {
+#ifdef __EMSCRIPTEN__
+	workerCount = 0;
+#endif
+	workers.reserve(workerCount);
+	for(std::size_t index = 0; index < workerCount; ++index) workers.push_back(std::make_unique<Worker>());
+	stats.resize(workerCount);
+	// Started once all exist, since they steal from each other.
+	for(std::size_t index = 0; index < workerCount; ++index) workers[index]->thread = std::thread(&JobSystem::WorkerLoop, this, index);
+}
+
+JobSystem::~JobSystem() {
+	// Jobs still queued are dropped; owners wait for what they need before this.
+	{
+		std::lock_guard lock(wakeMutex);
+		isStopping = true;
+	}
+	wake.notify_all();
+	waiterWake.notify_all();
+	for(auto& worker: workers) worker->thread.join();
+}
+
+JobSystem::Handle JobSystem::Schedule(std::function<void()> work, const std::initializer_list<Handle> dependencies) {
+	return Schedule(std::move(work), std::vector<Handle>(dependencies));
+}
+
+JobSystem::Handle JobSystem::Schedule(std::function<void()> work, const std::vector<Handle>& dependencies) {
+	auto job = std::make_shared<Job>();
+	job->work = std::move(work);
+	for(const auto& dependency: dependencies) {
+		if(dependency) AddDependency(job, dependency);
+	}
+	Release(job);
+	return job;
+}
+
+void JobSystem::ParallelFor(const std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body) {
+	if(count == 0) return;
+	grain = std::max<std::size_t>(grain, 1);
+	const std::size_t chunkCount = (count + grain - 1) / grain;
+	if(workers.empty() || chunkCount == 1) {
+		body(0, count);
+		return;
+	}
+
+	// Chunks are claimed from a shared counter, so whoever is free takes the next one.
+	std::atomic<std::size_t> next = 0;
+	const auto drain = [&next, chunkCount, count, grain, &body] {
+		for(std::size_t chunk; (chunk = next.fetch_add(1, std::memory_order_relaxed)) < chunkCount;) {
+			body(chunk * grain, std::min(count, (chunk + 1) * grain));
+		}
+	};
+	std::vector<Handle> helpers;
+	const std::size_t helperCount = std::min(chunkCount - 1, workers.size());
+	helpers.reserve(helperCount);
+	for(std::size_t i = 0; i < helperCount; ++i) helpers.push_back(Schedule(drain));
+	drain();
+	for(const auto& helper: helpers) Wait(helper);
+}
+
+void JobSystem::Wait(const Handle& job) {
+	const std::size_t index = currentSystem == this ? currentIndex : NO_WORKER;
+	Worker* worker = index != NO_WORKER ? workers[index].get() : nullptr;
+	while(!IsDone(job)) {
+		if(auto other = FindJob(index)) {
+			Run(other, worker);
+			continue;
+		}
+		// Nothing to help with: sleep until a job finishes or new work arrives.
+		std::unique_lock lock(wakeMutex);
+		++waiterCount;
+		waiterWake.wait(lock, [this, &job] { return IsDone(job) || queuedCount.load() > 0 || isStopping.load(); });
+		--waiterCount;
+	}
+}
+
+bool JobSystem::IsDone(const Handle& job) noexcept {
+	return !job || job->isDone.load(std::memory_order_acquire);
+}
+
+void JobSystem::PostToMainThread(std::function<void()> work) {
+	std::lock_guard lock(mainThreadMutex);
+	mainThreadWork.push_back(std::move(work));
+}
+
+void JobSystem::RunMainThreadWork() {
+	std::vector<std::function<void()>> work;
+	{
+		std::lock_guard lock(mainThreadMutex);
+		work.swap(mainThreadWork);
+	}
+	for(auto& item: work) item();
+	SampleStats();
+}
+
+void JobSystem::AddDependency(const Handle& job, const Handle& dependency) {
+	std::lock_guard lock(dependency->mutex);
+	if(dependency->isDone.load(std::memory_order_relaxed)) return;
+	job->pendingCount.fetch_add(1, std::memory_order_relaxed);
+	dependency->dependents.push_back(job);
+}
+
+void JobSystem::Release(const Handle& job) {
+	if(job->pendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1) Enqueue(job);
+}
+
+void JobSystem::Enqueue(Handle job) {
+	if(workers.empty()) {
+		Run(job, nullptr);
+		return;
+	}
+
+	// Counted before it is visible, so a thief's decrement cannot come first and wrap.
+	queuedCount.fetch_add(1);
+	if(currentSystem == this) {
+		auto& worker = *workers[currentIndex];
+		std::lock_guard lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+	} else {
+		std::lock_guard lock(injectionMutex);
+		injected.push_back(std::move(job));
+	}
+	// Taking the lock orders this with a worker or waiter that is about to sleep.
+	{
+		std::lock_guard lock(wakeMutex);
+		if(waiterCount > 0) waiterWake.notify_all();
+	}
+	wake.notify_one();
+}
+
+JobSystem::Handle JobSystem::FindJob(const std::size_t workerIndex) {
+	if(queuedCount.load() == 0) return nullptr;
+
+	Handle job;
+	if(workerIndex != NO_WORKER) {
+		auto& own = *workers[workerIndex];
+		std::lock_guard lock(own.mutex);
+		if(!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+		}
+	}
+	if(!job) {
+		std::lock_guard lock(injectionMutex);
+		if(!injected.empty()) {
+			job = std::move(injected.front());
+			injected.pop_front();
+		}
+	}
+	if(!job) {
+		// Oldest first from the others, starting with the next worker over.
+		const std::size_t start = workerIndex != NO_WORKER ? workerIndex + 1 : 0;
+		for(std::size_t offset = 0; offset < workers.size() && !job; ++offset) {
+			const std::size_t victimIndex = (start + offset) % workers.size();
+			if(victimIndex == workerIndex) continue;
+			auto& victim = *workers[victimIndex];
+			std::lock_guard lock(victim.mutex);
+			if(victim.jobs.empty()) continue;
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			if(workerIndex != NO_WORKER) workers[workerIndex]->stealCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	if(job) queuedCount.fetch_sub(1);
+	return job;
+}
+
+void JobSystem::Run(const Handle& job, Worker* worker) {
+	const auto start = std::chrono::steady_clock::now();
+	try {
+		job->work();
+	} catch(const std::exception& e) {
+		std::cerr << "Job failed: " << e.what() << std::endl;
+	}
+	// Drops whatever the work captured.
+	job->work = nullptr;
+
+	std::vector<Handle> dependents;
+	{
+		std::lock_guard lock(job->mutex);
+		job->isDone.store(true, std::memory_order_release);
+		dependents.swap(job->dependents);
+	}
+	for(const auto& dependent: dependents) Release(dependent);
+	{
+		std::lock_guard lock(wakeMutex);
+		if(waiterCount > 0) waiterWake.notify_all();
+	}
+
+	if(worker) {
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		worker->busyNanoseconds.fetch_add(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+		worker->jobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void JobSystem::WorkerLoop(const std::size_t index) {
+	currentSystem = this;
+	currentIndex = index;
+	auto& worker = *workers[index];
+	while(true) {
+		if(auto job = FindJob(index)) {
+			Run(job, &worker);
+			continue;
+		}
+		std::unique_lock lock(wakeMutex);
+		wake.wait(lock, [this] { return queuedCount.load() > 0 || isStopping.load(); });
+		if(isStopping) return;
+	}
+}
+
+void JobSystem::SampleStats() {
+	const auto now = std::chrono::steady_clock::now();
+	const auto window = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sampleStart);
+	if(window < SAMPLE_INTERVAL) return;
+	sampleStart = now;
+
+	for(std::size_t index = 0; index < workers.size(); ++index) {
+		auto& worker = *workers[index];
+		const std::uint64_t busy = worker.busyNanoseconds.load(std::memory_order_relaxed);
+		// A job is counted when it ends, so one spanning windows can exceed a window.
+		const double share = static_cast<double>(busy - worker.sampledBusyNanoseconds) / static_cast<double>(window.count());
+		worker.sampledBusyNanoseconds = busy;
+		stats[index].utilization = static_cast<float>(std::min(share, 1.0));
+		stats[index].jobCount = worker.jobCount.load(std::memory_order_relaxed);
+		stats[index].stealCount = worker.stealCount.load(std::memory_order_relaxed);
+	}
+}
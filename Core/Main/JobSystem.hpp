@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing job scheduler shared by the whole application. Each worker owns a deque:
+// jobs it spawns go to its back and are taken from there (newest first, while their data
+// is still in cache), idle workers steal from the front of the others. Jobs from outside
+// the pool enter through a shared queue. A job may depend on others and only becomes
+// runnable once they finished, which is also how continuations are expressed. Threads
+// that wait for a job run other jobs meanwhile, so waiting inside a job cannot starve
+// the pool. Results for the UI are posted back and run on the main thread at frame start.
+class JobSystem
+{
+	struct Job;
+
+public:
+	using Handle = std::shared_ptr<Job>;
+
+	struct WorkerStats {
+		// Share of the last sampling window spent running jobs, 0 to 1.
+		float utilization = 0.0f;
+		std::uint64_t jobCount = 0;
+		std::uint64_t stealCount = 0;
+	};
+
+	// How often the utilization figures are refreshed.
+	static constexpr auto SAMPLE_INTERVAL = std::chrono::milliseconds(500);
+
+	// One worker per hardware thread besides the main thread; none on Emscripten, where
+	// jobs run inline as soon as they are runnable.
+	static std::size_t DefaultWorkerCount() noexcept;
+
+	explicit JobSystem(std::size_t workerCount = DefaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	static JobSystem* GetInstance() noexcept { return instance; }
+	static void SetInstance(JobSystem* newInstance) noexcept { instance = newInstance; }
+
+	// Runs `work` once every job in `dependencies` finished. Null handles are ignored.
+	Handle Schedule(std::function<void()> work, std::initializer_list<Handle> dependencies = {});
+	Handle Schedule(std::function<void()> work, const std::vector<Handle>& dependencies);
+	// Runs `work` after `job`.
+	Handle Then(const Handle& job, std::function<void()> work) { return Schedule(std::move(work), {job}); }
+
+	// Calls `body(begin, end)` over [0, count) in chunks of at least `grain` items, on the
+	// workers and the calling thread, and returns once all are done.
+	void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+	// Blocks until `job` finished, running other jobs meanwhile and sleeping when there
+	// are none.
+	void Wait(const Handle& job);
+	static bool IsDone(const Handle& job) noexcept;
+
+	// Queues `work` to run on the main thread in the next RunMainThreadWork.
+	void PostToMainThread(std::function<void()> work);
+	// Main thread, at frame start: runs what was posted and refreshes the statistics.
+	void RunMainThreadWork();
+
+	std::size_t GetWorkerCount() const noexcept { return workers.size(); }
+	const std::vector<WorkerStats>& GetStats() const noexcept { return stats; }
+
+private:
+	struct Job {
+		std::function<void()> work;
+		// Unfinished dependencies, plus one while Schedule is still adding them.
+		std::atomic<std::uint32_t> pendingCount = 1;
+		std::atomic<bool> isDone = false;
+		std::mutex mutex;
+		// Jobs waiting for this one; taken when it finishes.
+		std::vector<Handle> dependents;
+	};
+
+	struct Worker {
+		std::thread thread;
+		std::mutex mutex;
+		std::deque<Handle> jobs;
+		std::atomic<std::uint64_t> busyNanoseconds = 0;
+		std::atomic<std::uint64_t> jobCount = 0;
+		std::atomic<std::uint64_t> stealCount = 0;
+		std::uint64_t sampledBusyNanoseconds = 0;
+	};
+
+	void AddDependency(const Handle& job, const Handle& dependency);
+	void Release(const Handle& job);
+	void Enqueue(Handle job);
+	Handle FindJob(std::size_t workerIndex);
+	void Run(const Handle& job, Worker* worker);
+	void WorkerLoop(std::size_t index);
+	void SampleStats();
+
+	inline static JobSystem* instance = nullptr;
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::mutex injectionMutex;
+	std::deque<Handle> injected;
+
+	std::atomic<std::size_t> queuedCount = 0;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	// Threads in Wait with nothing to run; they wake when a job finishes or is queued.
+	std::condition_variable waiterWake;
+	// Guarded by wakeMutex.
+	std::size_t waiterCount = 0;
+	std::atomic<bool> isStopping = false;
+
+	std::mutex mainThreadMutex;
+	std::vector<std::function<void()>> mainThreadWork;
+
+	// Main thread only.
+	std::vector<WorkerStats> stats;
+	std::chrono::steady_clock::time_point sampleStart = std::chrono::steady_clock::now();
+};
@@ -0,0 +1,378 @@
+#include "Journal.hpp"
+
+#include <pugixml.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <string_view>
+
+#include "../Diagram/Component.hpp"
+#include "../Utils/AtomicFile.hpp"
+#include "../Utils/Notification.hpp"
+
+namespace {
+#ifdef __EMSCRIPTEN__
+	// The browser build has no threads and an in-memory filesystem; journaling is off.
+	constexpr bool IS_JOURNAL_AVAILABLE = false;
+#else
+	constexpr bool IS_JOURNAL_AVAILABLE = true;
+#endif
+
+	constexpr std::string_view HEADER = "negentropy-journal 1\n";
+
+	// Entries are single lines of tab-separated fields, so text fields escape
+	// backslashes, tabs and line breaks.
+	void AppendEscaped(std::string& out, const std::string_view text) {
+		for(const char c: text) {
+			switch(c) {
+				case '\\': out += "\\\\"; break;
+				case '\t': out += "\\t"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				default: out += c; break;
+			}
+		}
+	}
+
+	std::string Unescape(const std::string_view text) {
+		std::string out;
+		out.reserve(text.size());
+		for(std::size_t i = 0; i < text.size(); ++i) {
+			if(text[i] != '\\' || i + 1 == text.size()) {
+				out += text[i];
+				continue;
+			}
+			switch(text[++i]) {
+				case 't': out += '\t'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				default: out += text[i]; break;
+			}
+		}
+		return out;
+	}
+
+	bool IsCoalescable(const Journal::Op op) noexcept {
+		return op != Journal::Op::Add && op != Journal::Op::Delete;
+	}
+}
+
+Journal::Journal() : sessionId((static_cast<std::uint64_t>(std::random_device {}()) << 32) ^ static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count())) {
+	if(IS_JOURNAL_AVAILABLE) writer = std::thread(&Journal::WriterLoop, this);
+}
+
+Journal::~Journal() {
+	if(!writer.joinable()) return;
+	{
+		std::lock_guard lock(mutex);
+		isStopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+}
+
+std::filesystem::path Journal::PathFor(const std::string& documentPath) {
+	return documentPath + ".journal";
+}
+
+std::vector<Journal::Entry> Journal::Recover(const std::string& documentPath, const std::string& documentMark) {
+	if(!IS_JOURNAL_AVAILABLE) return {};
+
+	const auto path = PathFor(documentPath);
+	std::ifstream in(path, std::ios::binary);
+	if(!in) return {};
+	std::string line;
+	if(!std::getline(in, line) || line + '\n' != HEADER) return {};
+
+	std::vector<Entry> entries;
+	bool isMarkFound = documentMark.empty();
+	while(std::getline(in, line)) {
+		std::string_view fields[5];
+		std::size_t fieldCount = 0;
+		std::size_t begin = 0;
+		while(fieldCount < 5) {
+			const auto end = line.find('\t', begin);
+			fields[fieldCount++] = std::string_view(line).substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+			if(end == std::string::npos) break;
+			begin = end + 1;
+		}
+		// A torn final line from a crash mid-write is simply dropped.
+		if(fieldCount != 5 || fields[0].size() != 1) continue;
+
+		Entry entry;
+		entry.op = static_cast<Op>(fields[0][0]);
+		entry.id = Unescape(fields[1]);
+		entry.text = Unescape(fields[2]);
+		entry.value = {std::strtof(std::string(fields[3]).c_str(), nullptr), std::strtof(std::string(fields[4]).c_str(), nullptr)};
+		if(entry.op != Op::Mark) {
+			entries.push_back(std::move(entry));
+		} else if(!documentMark.empty() && entry.id == documentMark) {
+			// Everything so far is in the document.
+			entries.clear();
+			isMarkFound = true;
+		}
+	}
+	in.close();
+
+	if(!isMarkFound) entries.clear();
+	if(entries.empty()) {
+		std::error_code ignored;
+		std::filesystem::remove(path, ignored);
+	}
+	return entries;
+}
+
+void Journal::Open(const std::string& documentPath, const std::string& documentMark) {
+	Command command {CommandKind::Open};
+	command.entry.id = documentMark;
+	command.entry.text = PathFor(documentPath).string();
+	Push(std::move(command));
+}
+
+void Journal::Flush() {
+	if(!writer.joinable()) return;
+
+	std::unique_lock lock(mutex);
+	const std::uint64_t sequence = ++nextSequence;
+	queue.push_back({CommandKind::Flush, {}, sequence});
+	isFlushRequested = true;
+	wake.notify_one();
+	flushed.wait(lock, [this, sequence] { return flushedSequence >= sequence; });
+}
+
+bool Journal::PollFlush() {
+	if(!writer.joinable()) return true;
+
+	std::lock_guard lock(mutex);
+	if(flushedSequence >= nextSequence) return true;
+	// One pending flush covers everything before it; records after it come back here.
+	if(queue.empty() || queue.back().kind != CommandKind::Flush) {
+		queue.push_back({CommandKind::Flush, {}, ++nextSequence});
+		isFlushRequested = true;
+		wake.notify_one();
+	}
+	return false;
+}
+
+void Journal::RecordAdd(const Diagram::ComponentBase& component) {
+	if(IS_JOURNAL_AVAILABLE) Record({Op::Add, component.id, SerializeComponent(component)});
+}
+
+void Journal::RecordUpdate(const Diagram::ComponentBase& component) {
+	if(IS_JOURNAL_AVAILABLE) Record({Op::Update, component.id, SerializeComponent(component)});
+}
+
+std::uint64_t Journal::Checkpoint() {
+	uncompactedCount.store(0, std::memory_order_relaxed);
+	std::lock_guard lock(mutex);
+	const std::uint64_t sequence = ++nextSequence;
+	queue.push_back({CommandKind::Checkpoint, {Op::Mark, MarkOf(sequence)}, sequence, sequence});
+	return sequence;
+}
+
+std::string Journal::MarkOf(const std::uint64_t checkpoint) const {
+	char mark[40];
+	const int length = std::snprintf(mark, sizeof(mark), "%016llx-%llu", static_cast<unsigned long long>(sessionId), static_cast<unsigned long long>(checkpoint));
+	return {mark, static_cast<std::size_t>(length)};
+}
+
+void Journal::Compact(const std::uint64_t checkpoint) {
+	Command command {CommandKind::Compact};
+	command.checkpoint = checkpoint;
+	Push(std::move(command));
+}
+
+std::string Journal::SerializeComponent(const Diagram::ComponentBase& component) {
+	pugi::xml_document doc;
+	auto node = doc.append_child("Component");
+	node.append_attribute("id").set_value(component.id.c_str());
+	node.append_attribute("type").set_value(component.GetTypeName().c_str());
+	node.append_attribute("group").set_value(component.groupId.c_str());
+	component.XmlSerialize(node);
+
+	std::ostringstream stream;
+	node.print(stream, "", pugi::format_raw);
+	return stream.str();
+}
+
+void Journal::Record(Entry entry) {
+	if(!IS_JOURNAL_AVAILABLE) return;
+
+	std::lock_guard lock(mutex);
+	// Continuous edits (drags, typing) collapse into their latest value while queued.
+	if(!queue.empty() && IsCoalescable(entry.op)) {
+		auto& last = queue.back();
+		if(last.kind == CommandKind::Record && last.entry.op == entry.op && last.entry.id == entry.id) {
+			last.entry = std::move(entry);
+			return;
+		}
+	}
+	queue.push_back({CommandKind::Record, std::move(entry), ++nextSequence});
+	uncompactedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Journal::Push(Command command) {
+	if(!IS_JOURNAL_AVAILABLE) return;
+
+	std::lock_guard lock(mutex);
+	command.sequence = ++nextSequence;
+	queue.push_back(std::move(command));
+}
+
+void Journal::WriterLoop() {
+	std::vector<Command> batch;
+	std::unique_lock lock(mutex);
+	while(true) {
+		// Records accumulate for FLUSH_INTERVAL so one fsync covers the whole batch.
+		wake.wait_for(lock, FLUSH_INTERVAL, [this] { return isStopping || isFlushRequested; });
+		batch.swap(queue);
+		const bool isStopRequested = isStopping;
+		isFlushRequested = false;
+		lock.unlock();
+
+		std::uint64_t lastSequence = 0;
+		for(auto& command: batch) {
+			switch(command.kind) {
+				case CommandKind::Record:
+					WriteEntry(command.entry);
+					break;
+				case CommandKind::Open:
+					Sync();
+					if(file) std::fclose(file);
+					file = nullptr;
+					journalPath = command.entry.text;
+					checkpointOffsets.clear();
+					unwrittenMarks.clear();
+					if(!command.entry.id.empty()) unwrittenMarks.push_back(std::move(command.entry.id));
+					break;
+				case CommandKind::Checkpoint:
+					checkpointOffsets[command.checkpoint] = WriteMark(command.entry.id);
+					break;
+				case CommandKind::Compact:
+					CompactFile(command.checkpoint);
+					break;
+				case CommandKind::Flush:
+					break;
+			}
+			lastSequence = command.sequence;
+		}
+		Sync();
+		batch.clear();
+
+		lock.lock();
+		if(lastSequence > flushedSequence) flushedSequence = lastSequence;
+		flushed.notify_all();
+		if(isStopRequested && queue.empty()) break;
+	}
+	lock.unlock();
+
+	if(file) std::fclose(file);
+	file = nullptr;
+}
+
+void Journal::WriteEntry(const Entry& entry) {
+	if(!EnsureFile()) return;
+
+	std::string line;
+	line += static_cast<char>(entry.op);
+	line += '\t';
+	AppendEscaped(line, entry.id);
+	line += '\t';
+	AppendEscaped(line, entry.text);
+
+	char numbers[64];
+	const int length = std::snprintf(numbers, sizeof(numbers), "\t%.9g\t%.9g\n", entry.value.x, entry.value.y);
+	line.append(numbers, static_cast<std::size_t>(length));
+
+	std::fwrite(line.data(), 1, line.size(), file);
+	isDirty = true;
+}
+
+void Journal::Sync() {
+	if(!file || !isDirty) return;
+	std::fflush(file);
+	Utils::AtomicFile::SyncFile(file);
+	isDirty = false;
+}
+
+long Journal::WriteMark(const std::string& mark) {
+	std::error_code ignored;
+	if(!file && !std::filesystem::exists(journalPath, ignored)) {
+		// Nothing recorded since the file went away: the first record creates it, header
+		// and marks first, so compacting to here keeps the marks.
+		unwrittenMarks.push_back(mark);
+		return static_cast<long>(HEADER.size());
+	}
+	if(!EnsureFile()) return static_cast<long>(HEADER.size());
+	// Compaction keeps the mark, so recovery still finds the document's place.
+	const long offset = std::ftell(file);
+	WriteEntry({Op::Mark, mark});
+	return offset;
+}
+
+bool Journal::EnsureFile() {
+	if(file) return true;
+	if(journalPath.empty()) return false;
+
+	file = std::fopen(journalPath.string().c_str(), "ab");
+	if(!file) {
+		// Runs on the writer thread; a failure repeating every batch merges into one toast.
+		Notify::Warning("Cannot write the edit journal " + journalPath.filename().string());
+		return false;
+	}
+
+	std::fseek(file, 0, SEEK_END);
+	if(std::ftell(file) == 0) {
+		std::fwrite(HEADER.data(), 1, HEADER.size(), file);
+		isDirty = true;
+	}
+	const auto marks = std::move(unwrittenMarks);
+	unwrittenMarks.clear();
+	for(const auto& mark: marks) WriteEntry({Op::Mark, mark});
+	return true;
+}
+
+void Journal::CompactFile(const std::uint64_t checkpoint) {
+	const auto it = checkpointOffsets.find(checkpoint);
+	if(it == checkpointOffsets.end()) return;
+
+	const long offset = it->second;
+	checkpointOffsets.erase(checkpointOffsets.begin(), std::next(it));
+	Sync();
+
+	// Everything before the checkpoint is in the saved document; keep only the tail.
+	std::string tail;
+	{
+		std::ifstream in(journalPath, std::ios::binary);
+		in.seekg(offset);
+		tail.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	if(file) std::fclose(file);
+	file = nullptr;
+	const long shift = offset - static_cast<long>(HEADER.size());
+	for(auto& laterOffset: checkpointOffsets | std::views::values) laterOffset -= shift;
+
+	// No file: its marks are still unwritten.
+	if(tail.empty()) return;
+	std::error_code ignored;
+	if(tail.find('\n') + 1 == tail.size()) {
+		// Only the checkpoint's own mark is left; it is written again with the next record.
+		std::filesystem::remove(journalPath, ignored);
+		unwrittenMarks = {MarkOf(checkpoint)};
+		return;
+	}
+
+	Utils::AtomicFile compacted(journalPath);
+	std::string error;
+	if(compacted.IsOpen()) {
+		std::fwrite(HEADER.data(), 1, HEADER.size(), compacted.Get());
+		std::fwrite(tail.data(), 1, tail.size(), compacted.Get());
+		compacted.Commit(error);
+	}
+}
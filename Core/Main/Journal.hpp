@@ -0,0 +1,142 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Diagram {
+	class ComponentBase;
+}
+
+// Append-only write-ahead log of the edits made to the open document, kept next to it
+// as "<document>.journal". Recording only appends to an in-memory batch under a short
+// lock; a writer thread appends the batches to disk and fsyncs at most every
+// FLUSH_INTERVAL, so a frame never waits on the disk.
+class Journal
+{
+public:
+	enum class Op : char {
+		Move = 'M',
+		Resize = 'S',
+		Relabel = 'L',
+		Regroup = 'G',
+		RegroupGroup = 'P',
+		Add = 'A',
+		Delete = 'D',
+		Update = 'U',
+		// The state a saved document with this mark in its id holds; see Checkpoint.
+		Mark = 'C'
+	};
+
+	struct Entry {
+		Op op = Op::Move;
+		std::string id;
+		std::string text; // label, target group id or serialized component
+		glm::vec2 value {0.0f};
+	};
+
+	static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(250);
+
+	Journal();
+	~Journal();
+
+	Journal(const Journal&) = delete;
+	Journal& operator=(const Journal&) = delete;
+	Journal(Journal&&) = delete;
+	Journal& operator=(Journal&&) = delete;
+
+	static std::filesystem::path PathFor(const std::string& documentPath);
+
+	// Returns the entries a document is missing: those after the mark it was saved with,
+	// or all of them for a document saved without one. A journal lacking the mark only
+	// holds edits from before that save, whose mark never reached the disk; it is
+	// deleted, as is a journal with nothing to replay.
+	static std::vector<Entry> Recover(const std::string& documentPath, const std::string& documentMark);
+
+	// Directs subsequent records to the journal of another document, which is in the
+	// state of `documentMark`.
+	void Open(const std::string& documentPath, const std::string& documentMark);
+	// Blocks until everything recorded so far is on disk.
+	void Flush();
+	// The same without blocking: requests the flush and returns whether it is done.
+	bool PollFlush();
+
+	void RecordMove(const std::string& id, glm::vec2 position) { Record({Op::Move, id, {}, position}); }
+	void RecordResize(const std::string& id, glm::vec2 size) { Record({Op::Resize, id, {}, size}); }
+	void RecordRelabel(const std::string& id, const std::string& label) { Record({Op::Relabel, id, label}); }
+	void RecordRegroup(const std::string& id, const std::string& groupId) { Record({Op::Regroup, id, groupId}); }
+	void RecordRegroupGroup(const std::string& groupId, const std::string& parentId) { Record({Op::RegroupGroup, groupId, parentId}); }
+	void RecordDelete(const std::string& id) { Record({Op::Delete, id}); }
+	void RecordAdd(const Diagram::ComponentBase& component);
+	void RecordUpdate(const Diagram::ComponentBase& component);
+
+	// A checkpoint marks the state captured by a save snapshot; the save stores MarkOf it
+	// in the document, and the journal writes it as an entry. Once that save is on disk,
+	// Compact drops everything recorded before the mark. Neither creates the journal
+	// file; only a record does, and a mark without a file is written along with it.
+	std::uint64_t Checkpoint();
+	void Compact(std::uint64_t checkpoint);
+	// Unique across sessions, so a document never matches the mark of another save.
+	std::string MarkOf(std::uint64_t checkpoint) const;
+
+	std::size_t GetUncompactedCount() const noexcept { return uncompactedCount.load(std::memory_order_relaxed); }
+
+	static std::string SerializeComponent(const Diagram::ComponentBase& component);
+
+private:
+	enum class CommandKind {
+		Record,
+		Open,
+		Checkpoint,
+		Compact,
+		Flush
+	};
+
+	struct Command {
+		CommandKind kind = CommandKind::Record;
+		Entry entry;
+		std::uint64_t sequence = 0;
+		std::uint64_t checkpoint = 0;
+	};
+
+	void Record(Entry entry);
+	void Push(Command command);
+	void WriterLoop();
+
+	// Writer thread only.
+	void WriteEntry(const Entry& entry);
+	void Sync();
+	void CompactFile(std::uint64_t checkpoint);
+	long WriteMark(const std::string& mark);
+	bool EnsureFile();
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable flushed;
+	std::vector<Command> queue;
+	std::uint64_t nextSequence = 0;
+	std::uint64_t flushedSequence = 0;
+	bool isStopping = false;
+	bool isFlushRequested = false;
+	std::atomic<std::size_t> uncompactedCount = 0;
+	const std::uint64_t sessionId;
+
+	std::filesystem::path journalPath;
+	std::FILE* file = nullptr;
+	bool isDirty = false;
+	std::map<std::uint64_t, long> checkpointOffsets;
+	// Marks taken while there was no file, written right after its header.
+	std::vector<std::string> unwrittenMarks;
+
+	std::thread writer;
+};
@@ -0,0 +1,151 @@
+#include "LayoutCommands.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "../Utils/Notification.hpp"
+#include "DiagramData.hpp"
+
+LayoutCommands::LayoutCommands(DiagramData& diagramData) : diagramData(diagramData) {
+	diagramData.SetInterruptHandler([this](const bool isDiscarded) {
+		if(isDiscarded) DiscardAutoLayout();
+		else StopAutoLayout();
+	});
+}
+
+LayoutCommands::~LayoutCommands() {
+	diagramData.SetInterruptHandler(nullptr);
+	autoLayout.Stop();
+}
+
+void LayoutCommands::StartAutoLayout() {
+	StopAutoLayout();
+	// Blocks in lazy groups take part too.
+	diagramData.MaterializeAllGroups();
+
+	LayoutRun run;
+	std::vector<glm::vec2> centers;
+	std::vector<std::uint32_t> groups;
+	std::unordered_map<std::string, std::uint32_t> groupIndices;
+	float extentSum = 0.0f;
+	for(const auto& component: diagramData.GetComponentList()) {
+		auto* block = dynamic_cast<Diagram::Block*>(component.get());
+		if(!block) continue;
+		run.blocks.push_back(block);
+		run.before.push_back(block->data);
+		centers.push_back(block->data.position + block->data.size * 0.5f);
+		groups.push_back(groupIndices.try_emplace(block->groupId, static_cast<std::uint32_t>(groupIndices.size())).first->second);
+		extentSum += std::max(std::abs(block->data.size.x), std::abs(block->data.size.y));
+	}
+	if(run.blocks.empty()) return;
+
+	// Room for about one block between neighbors.
+	const float idealDistance = std::max(2.0f * extentSum / static_cast<float>(run.blocks.size()), diagramData.GetGrid().settings.smallStep);
+	run.structureVersion = diagramData.GetStructureVersion();
+	layoutRun = std::move(run);
+	autoLayout.Start(std::move(centers), std::move(groups), idealDistance);
+}
+
+void LayoutCommands::StopAutoLayout() {
+	if(!layoutRun) return;
+	autoLayout.Stop();
+	FinishAutoLayout();
+}
+
+void LayoutCommands::PollAutoLayout() {
+	if(!layoutRun) return;
+	if(layoutRun->structureVersion != diagramData.GetStructureVersion()) {
+		StopAutoLayout();
+		return;
+	}
+	const auto frame = autoLayout.Poll();
+	if(!frame) return;
+	for(std::size_t i = 0; i < layoutRun->blocks.size(); ++i) {
+		auto* block = layoutRun->blocks[i];
+		block->data.position = frame->centers[i] - block->data.size * 0.5f;
+		block->MarkDirty();
+	}
+	if(frame->isFinal) FinishAutoLayout();
+}
+
+void LayoutCommands::FinishAutoLayout() {
+	auto run = std::exchange(layoutRun, std::nullopt);
+	// Blocks deleted during the run are skipped; their pointers are only compared.
+	std::unordered_set<const Diagram::ComponentBase*> live;
+	for(const auto& component: diagramData.GetComponentList()) live.insert(component.get());
+
+	const auto& grid = diagramData.GetGrid();
+	std::vector<std::pair<Diagram::Block*, Diagram::Block::Data>> moved;
+	for(std::size_t i = 0; i < run->blocks.size(); ++i) {
+		auto* block = run->blocks[i];
+		if(!live.contains(block)) continue;
+		block->data.position = grid.SnapToGrid(block->data.position);
+		block->MarkDirty();
+		moved.emplace_back(block, std::move(run->before[i]));
+	}
+	diagramData.RecordMoves(moved);
+}
+
+void LayoutCommands::DiscardAutoLayout() noexcept {
+	// The blocks belong to the model being replaced.
+	autoLayout.Stop();
+	layoutRun.reset();
+}
+
+void LayoutCommands::UpdateOverlaps() {
+	if(!layoutRun) overlapDetector.Update(diagramData.GetComponentList(), diagramData.GetStructureVersion());
+}
+
+std::size_t LayoutCommands::ResolveOverlaps() {
+	StopAutoLayout();
+	const auto& componentList = diagramData.GetComponentList();
+	const auto& grid = diagramData.GetGrid();
+	overlapDetector.Update(componentList, diagramData.GetStructureVersion());
+	const std::size_t initialCount = overlapDetector.GetOverlapCount();
+	if(initialCount == 0) return 0;
+
+	// Every overlapping pair is pushed apart by half its overlap each, along the axis
+	// where that is shorter; the pushes on a block add up and are applied together.
+	std::unordered_map<Diagram::Block*, Diagram::Block::Data> before;
+	const float step = grid.settings.smallStep;
+	for(int iteration = 0; iteration < MAX_RESOLVE_ITERATIONS && overlapDetector.GetOverlapCount() > 0; ++iteration) {
+		std::unordered_map<Diagram::Block*, glm::vec2> pushes;
+		overlapDetector.ForEachPair([&pushes](Diagram::Block& first, Diagram::Block& second) {
+			const glm::vec2 firstMin = glm::min(first.data.position, first.data.position + first.data.size);
+			const glm::vec2 firstMax = glm::max(first.data.position, first.data.position + first.data.size);
+			const glm::vec2 secondMin = glm::min(second.data.position, second.data.position + second.data.size);
+			const glm::vec2 secondMax = glm::max(second.data.position, second.data.position + second.data.size);
+			const glm::vec2 overlap = glm::min(firstMax, secondMax) - glm::max(firstMin, secondMin);
+			const int axis = overlap.x <= overlap.y ? 0 : 1;
+			const float firstCenter = (firstMin[axis] + firstMax[axis]) * 0.5f;
+			const float secondCenter = (secondMin[axis] + secondMax[axis]) * 0.5f;
+			// Stacked blocks have no direction of their own; the address order spreads them.
+			const float direction = secondCenter != firstCenter ? (secondCenter > firstCenter ? 1.0f : -1.0f) : (&first < &second ? 1.0f : -1.0f);
+			pushes[&first][axis] -= direction * overlap[axis] * 0.5f;
+			pushes[&second][axis] += direction * overlap[axis] * 0.5f;
+		});
+
+		for(const auto& [block, push]: pushes) {
+			before.try_emplace(block, block->data);
+			glm::vec2 position = grid.SnapToGrid(block->data.position + push);
+			for(int axis = 0; axis < 2; ++axis) {
+				// Snapping back onto the same line would undo the push.
+				if(push[axis] != 0.0f && position[axis] == block->data.position[axis]) position[axis] += std::copysign(step, push[axis]);
+			}
+			block->data.position = position;
+			block->MarkDirty();
+		}
+		overlapDetector.Update(componentList, diagramData.GetStructureVersion());
+	}
+
+	diagramData.RecordMoves({std::make_move_iterator(before.begin()), std::make_move_iterator(before.end())});
+	const std::size_t remaining = overlapDetector.GetOverlapCount();
+	if(remaining == 0) Notify::Success("Resolved " + std::to_string(initialCount) + " overlaps");
+	else Notify::Warning(std::to_string(remaining) + " of " + std::to_string(initialCount) + " overlaps remain");
+	return remaining;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../Diagram/Block.hpp"
+#include "../Diagram/OverlapDetector.hpp"
+#include "AutoLayout.hpp"
+
+class DiagramData;
+
+// Commands that move many blocks of a DiagramData at once: an AutoLayout run, whose
+// positions stream in over several frames, and the resolution of overlapping blocks.
+// Both go through DiagramData::RecordMoves, so each is undone as one step.
+class LayoutCommands
+{
+public:
+	static constexpr int MAX_RESOLVE_ITERATIONS = 100;
+
+	explicit LayoutCommands(DiagramData& diagramData);
+	~LayoutCommands();
+
+	LayoutCommands(const LayoutCommands&) = delete;
+	LayoutCommands& operator=(const LayoutCommands&) = delete;
+	LayoutCommands(LayoutCommands&&) = delete;
+	LayoutCommands& operator=(LayoutCommands&&) = delete;
+
+	// Lays out all blocks with AutoLayout. Positions stream in through PollAutoLayout each
+	// frame and are snapped to the grid once the layout settles or is stopped; the whole
+	// run is undone as one step. A structural change stops it where it is, an undo or redo
+	// records it first and loading another document drops it.
+	void StartAutoLayout();
+	void StopAutoLayout();
+	void PollAutoLayout();
+	bool IsAutoLayoutRunning() const noexcept { return layoutRun.has_value(); }
+	const AutoLayout& GetAutoLayout() const noexcept { return autoLayout; }
+
+	// Keeps the overlapping block pairs current; see OverlapDetector.
+	// Skipped while a layout run moves every block each frame; the first update after it
+	// takes the full sort.
+	void UpdateOverlaps();
+	const Diagram::OverlapDetector& GetOverlapDetector() const noexcept { return overlapDetector; }
+	// Pushes overlapping blocks apart on the grid, as one undo step. Returns the overlaps
+	// left after MAX_RESOLVE_ITERATIONS rounds.
+	std::size_t ResolveOverlaps();
+
+private:
+	struct LayoutRun {
+		std::vector<Diagram::Block*> blocks;
+		std::vector<Diagram::Block::Data> before;
+		std::uint64_t structureVersion = 0;
+	};
+
+	void FinishAutoLayout();
+	void DiscardAutoLayout() noexcept;
+
+	DiagramData& diagramData;
+	Diagram::OverlapDetector overlapDetector;
+	AutoLayout autoLayout;
+	std::optional<LayoutRun> layoutRun;
+};
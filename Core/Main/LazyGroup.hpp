@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "../Diagram/SearchIndex.hpp"
+
+// A collapsed <Group> whose subtree was only indexed at load. Its children stay as text
+// of the loaded document until the group is expanded or scrolled into view, and a save
+// writes that text back verbatim.
+struct LazyGroup {
+	std::shared_ptr<const std::string> document;
+	std::size_t contentBegin = 0;
+	std::size_t contentEnd = 0;
+
+	std::size_t componentCount = 0;
+	// Every component inside, nested groups included, shared with the tree's search.
+	Diagram::LazyComponentList components;
+	// Set when a component has no position, which leaves the extent of the group unknown.
+	bool hasUnplacedComponent = false;
+	glm::vec2 boundsMin {std::numeric_limits<float>::max()};
+	glm::vec2 boundsMax {std::numeric_limits<float>::lowest()};
+
+	std::string_view Content() const noexcept {
+		return std::string_view(*document).substr(contentBegin, contentEnd - contentBegin);
+	}
+
+	bool Intersects(const glm::vec2 min, const glm::vec2 max) const noexcept {
+		if(hasUnplacedComponent) return true;
+		return componentCount > 0 && boundsMin.x <= max.x && min.x <= boundsMax.x && boundsMin.y <= max.y && min.y <= boundsMax.y;
+	}
+};
@@ -0,0 +1,319 @@
+#include "PreviewCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <glm/vec4.hpp>
+#include <nlohmann/json.hpp>
+#include <pugixml.hpp>
+
+#include "../Utils/AccountedJson.hpp"
+#include "../Utils/AtomicFile.hpp"
+#include "../Utils/JSONSerialization.hpp"
+#include "../Utils/Path.hpp"
+#include "../Utils/XMLSerialization.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr char CACHE_MAGIC[4] = {'N', 'P', 'V', '1'};
+	constexpr std::size_t PIXEL_BYTES = PreviewCache::THUMBNAIL_WIDTH * PreviewCache::THUMBNAIL_HEIGHT * 4;
+
+	// Fixed-size part of a cache file, followed by the thumbnail pixels.
+	struct CacheHeader {
+		char magic[4];
+		std::int64_t modifiedTime;
+		std::uint64_t fileSize;
+		std::uint64_t componentCount;
+		std::uint64_t groupCount;
+		std::uint32_t hasBounds;
+		float bounds[4];
+	};
+
+	struct Shape {
+		glm::vec2 position {0.0f};
+		glm::vec2 size {0.0f};
+		glm::vec4 color {0.5f, 0.5f, 0.5f, 1.0f};
+	};
+
+	struct Scan {
+		PreviewCache::Preview preview;
+		std::vector<Shape> shapes;
+
+		void Add(const Shape& shape) {
+			const glm::vec2 min = glm::min(shape.position, shape.position + shape.size);
+			const glm::vec2 max = glm::max(shape.position, shape.position + shape.size);
+			preview.boundsMin = preview.hasBounds ? glm::min(preview.boundsMin, min) : min;
+			preview.boundsMax = preview.hasBounds ? glm::max(preview.boundsMax, max) : max;
+			preview.hasBounds = true;
+			shapes.push_back(shape);
+		}
+	};
+
+	// Only the counts and the "position", "size" and "backgroundColor" fields are read,
+	// with pugixml's minimal parse, since nothing is built from the document.
+	std::optional<Scan> ScanXml(const fs::path& path) {
+		pugi::xml_document doc;
+		if(!doc.load_file(path.string().c_str(), pugi::parse_minimal)) return std::nullopt;
+
+		Scan scan;
+		const auto visit = [&scan](const auto& self, const pugi::xml_node& node) -> void {
+			for(const auto child: node.children()) {
+				const std::string_view name = child.name();
+				if(name == "Group") {
+					++scan.preview.groupCount;
+					self(self, child);
+				} else if(name == "Component") {
+					++scan.preview.componentCount;
+					const auto positionNode = child.child("position");
+					if(!positionNode) continue;
+					Shape shape;
+					XML::deserialize_value(positionNode, shape.position);
+					XML::deserialize_field(child, "size", shape.size);
+					XML::deserialize_field(child, "backgroundColor", shape.color);
+					scan.Add(shape);
+				}
+			}
+		};
+		visit(visit, doc.child("Diagram").child("Root"));
+		return scan;
+	}
+
+	std::optional<Scan> ScanJson(const fs::path& path) {
+		std::ifstream stream(path);
+		if(!stream) return std::nullopt;
+		const auto doc = Utils::AccountedJson::parse(stream, nullptr, false);
+		if(!doc.is_object()) return std::nullopt;
+
+		Scan scan;
+		const auto visit = [&scan](const auto& self, const Utils::AccountedJson& node) -> void {
+			if(!node.is_object()) return;
+			if(const auto groups = node.find("groups"); groups != node.end() && groups->is_array()) {
+				for(const auto& child: *groups) {
+					++scan.preview.groupCount;
+					self(self, child);
+				}
+			}
+			if(const auto components = node.find("components"); components != node.end() && components->is_array()) {
+				for(const auto& child: *components) {
+					++scan.preview.componentCount;
+					const auto dataNode = child.is_object() ? child.find("data") : child.end();
+					if(dataNode == child.end() || !dataNode->is_object()) continue;
+					const nlohmann::json data(*dataNode);
+					const auto position = data.find("position");
+					if(position == data.end()) continue;
+					Shape shape;
+					JSON::deserialize_value(*position, shape.position);
+					if(const auto size = data.find("size"); size != data.end()) JSON::deserialize_value(*size, shape.size);
+					if(const auto color = data.find("backgroundColor"); color != data.end()) JSON::deserialize_value(*color, shape.color);
+					scan.Add(shape);
+				}
+			}
+		};
+		if(const auto diagram = doc.find("Diagram"); diagram != doc.end() && diagram->is_object()) {
+			if(const auto root = diagram->find("Root"); root != diagram->end()) visit(visit, *root);
+		}
+		return scan;
+	}
+
+	// Fits the bounds into the thumbnail, keeping the aspect ratio, and blends every
+	// shape in at least one pixel so small components in large diagrams stay visible.
+	void Rasterize(Scan& scan) {
+		constexpr int W = PreviewCache::THUMBNAIL_WIDTH;
+		constexpr int H = PreviewCache::THUMBNAIL_HEIGHT;
+		constexpr float MARGIN = 2.0f;
+
+		auto& pixels = scan.preview.pixels;
+		pixels.resize(PIXEL_BYTES);
+		for(std::size_t i = 0; i < pixels.size(); i += 4) {
+			pixels[i] = 30;
+			pixels[i + 1] = 30;
+			pixels[i + 2] = 30;
+			pixels[i + 3] = 255;
+		}
+		if(!scan.preview.hasBounds) return;
+
+		const glm::vec2 extent = glm::max(scan.preview.boundsMax - scan.preview.boundsMin, glm::vec2(1.0f));
+		const float scale = std::min((W - 2.0f * MARGIN) / extent.x, (H - 2.0f * MARGIN) / extent.y);
+		const glm::vec2 offset = (glm::vec2(W, H) - extent * scale) * 0.5f;
+
+		for(const auto& shape: scan.shapes) {
+			const glm::vec2 min = (glm::min(shape.position, shape.position + shape.size) - scan.preview.boundsMin) * scale + offset;
+			const glm::vec2 max = (glm::max(shape.position, shape.position + shape.size) - scan.preview.boundsMin) * scale + offset;
+			const int x0 = std::clamp(static_cast<int>(std::floor(min.x)), 0, W - 1);
+			const int y0 = std::clamp(static_cast<int>(std::floor(min.y)), 0, H - 1);
+			const int x1 = std::clamp(static_cast<int>(std::ceil(max.x)), x0 + 1, W);
+			const int y1 = std::clamp(static_cast<int>(std::ceil(max.y)), y0 + 1, H);
+
+			const float alpha = std::clamp(shape.color.a, 0.0f, 1.0f);
+			for(int y = y0; y < y1; ++y) {
+				for(int x = x0; x < x1; ++x) {
+					auto* pixel = &pixels[(static_cast<std::size_t>(y) * W + x) * 4];
+					for(int c = 0; c < 3; ++c) {
+						const float source = std::clamp(shape.color[c], 0.0f, 1.0f) * 255.0f;
+						pixel[c] = static_cast<std::uint8_t>(source * alpha + pixel[c] * (1.0f - alpha));
+					}
+				}
+			}
+		}
+		scan.shapes.clear();
+	}
+
+	std::optional<PreviewCache::Preview> ReadCached(const fs::path& cachePath, const std::int64_t modifiedTime, const std::uintmax_t fileSize) {
+		std::ifstream stream(cachePath, std::ios::binary);
+		if(!stream) return std::nullopt;
+
+		CacheHeader header {};
+		if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header))) return std::nullopt;
+		if(!std::equal(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic)) return std::nullopt;
+		if(header.modifiedTime != modifiedTime || header.fileSize != fileSize) return std::nullopt;
+
+		PreviewCache::Preview preview;
+		preview.componentCount = header.componentCount;
+		preview.groupCount = header.groupCount;
+		preview.hasBounds = header.hasBounds != 0;
+		preview.boundsMin = {header.bounds[0], header.bounds[1]};
+		preview.boundsMax = {header.bounds[2], header.bounds[3]};
+		preview.pixels.resize(PIXEL_BYTES);
+		if(!stream.read(reinterpret_cast<char*>(preview.pixels.data()), static_cast<std::streamsize>(PIXEL_BYTES))) return std::nullopt;
+		return preview;
+	}
+
+	void WriteCached(const fs::path& cachePath, const std::int64_t modifiedTime, const std::uintmax_t fileSize, const PreviewCache::Preview& preview) {
+		std::error_code error;
+		fs::create_directories(cachePath.parent_path(), error);
+
+		CacheHeader header {};
+		std::copy(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic);
+		header.modifiedTime = modifiedTime;
+		header.fileSize = fileSize;
+		header.componentCount = preview.componentCount;
+		header.groupCount = preview.groupCount;
+		header.hasBounds = preview.hasBounds ? 1 : 0;
+		header.bounds[0] = preview.boundsMin.x;
+		header.bounds[1] = preview.boundsMin.y;
+		header.bounds[2] = preview.boundsMax.x;
+		header.bounds[3] = preview.boundsMax.y;
+
+		// A lost cache write only costs a rebuild next time.
+		Utils::AtomicFile file(cachePath);
+		if(!file.IsOpen()) return;
+		std::fwrite(&header, sizeof(header), 1, file.Get());
+		std::fwrite(preview.pixels.data(), 1, preview.pixels.size(), file.Get());
+		std::string ignored;
+		file.Commit(ignored);
+	}
+}
+
+PreviewCache::PreviewCache(fs::path directory, fs::path cacheDirectory)
+	: directory(std::move(directory)), cacheDirectory(std::move(cacheDirectory)) {
+#ifndef __EMSCRIPTEN__
+	worker = std::thread(&PreviewCache::WorkerLoop, this);
+#endif
+}
+
+PreviewCache::~PreviewCache() {
+	Shutdown();
+}
+
+const PreviewCache::Entry* PreviewCache::Find(const std::string& fileName) {
+	if(const auto it = entries.find(fileName); it != entries.end()) return &it->second;
+
+	if(requested.insert(fileName).second) {
+		std::lock_guard lock(mutex);
+		queue.push_back(fileName);
+		wake.notify_one();
+	}
+	return nullptr;
+}
+
+void PreviewCache::Invalidate(const std::string& fileName) {
+	if(const auto it = entries.find(fileName); it != entries.end()) {
+		DestroyTexture(it->second);
+		entries.erase(it);
+	}
+	requested.erase(fileName);
+}
+
+void PreviewCache::Poll(SDL_Renderer* renderer) {
+	std::vector<Result> finished;
+	{
+		std::lock_guard lock(mutex);
+#ifdef __EMSCRIPTEN__
+		// No threads: build one preview per frame instead.
+		if(!queue.empty()) {
+			const std::string fileName = std::move(queue.front());
+			queue.pop_front();
+			results.push_back({fileName, Build(fileName)});
+		}
+#endif
+		finished.swap(results);
+	}
+
+	for(auto& result: finished) {
+		// Dropped in the meantime by Invalidate; a fresh request is on its way.
+		if(!result.preview || !requested.contains(result.fileName)) continue;
+
+		auto& entry = entries[result.fileName];
+		DestroyTexture(entry);
+		entry.preview = std::move(*result.preview);
+		entry.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT);
+		if(entry.texture) SDL_UpdateTexture(entry.texture, nullptr, entry.preview.pixels.data(), THUMBNAIL_WIDTH * 4);
+	}
+}
+
+void PreviewCache::Shutdown() noexcept {
+	{
+		std::lock_guard lock(mutex);
+		isStopping = true;
+		queue.clear();
+	}
+	wake.notify_all();
+	if(worker.joinable()) worker.join();
+
+	for(auto& entry: entries | std::views::values) DestroyTexture(entry);
+	entries.clear();
+	requested.clear();
+}
+
+void PreviewCache::WorkerLoop() {
+	std::unique_lock lock(mutex);
+	while(true) {
+		wake.wait(lock, [this] { return isStopping || !queue.empty(); });
+		if(isStopping) return;
+
+		const std::string fileName = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+		auto preview = Build(fileName);
+		lock.lock();
+		results.push_back({fileName, std::move(preview)});
+	}
+}
+
+std::optional<PreviewCache::Preview> PreviewCache::Build(const std::string& fileName) const {
+	const fs::path path = directory / fileName;
+	std::error_code error;
+	const auto modifiedTime = fs::last_write_time(path, error);
+	if(error) return std::nullopt;
+	const auto fileSize = fs::file_size(path, error);
+	if(error) return std::nullopt;
+
+	const std::int64_t stamp = modifiedTime.time_since_epoch().count();
+	const fs::path cachePath = cacheDirectory / (fileName + ".preview");
+	if(auto cached = ReadCached(cachePath, stamp, fileSize)) return cached;
+
+	auto scan = Utils::IsJsonDocument(path) ? ScanJson(path) : ScanXml(path);
+	if(!scan) return std::nullopt;
+	Rasterize(*scan);
+	WriteCached(cachePath, stamp, fileSize, scan->preview);
+	return std::move(scan->preview);
+}
+
+void PreviewCache::DestroyTexture(Entry& entry) noexcept {
+	if(entry.texture) SDL_DestroyTexture(entry.texture);
+	entry.texture = nullptr;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <SDL.h>
+#include <glm/vec2.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Thumbnails and stats of the workspace documents for the Load menu. A worker thread
+// builds them from a lightweight parse (no components are constructed) and keeps them
+// on disk, keyed by the document's mtime and size, so a warm start reads a few bytes
+// per document. The UI only ever looks up what is ready and queues the rest.
+class PreviewCache
+{
+public:
+	static constexpr int THUMBNAIL_WIDTH = 96;
+	static constexpr int THUMBNAIL_HEIGHT = 64;
+
+	struct Preview {
+		std::size_t componentCount = 0;
+		std::size_t groupCount = 0;
+		bool hasBounds = false;
+		glm::vec2 boundsMin {0.0f};
+		glm::vec2 boundsMax {0.0f};
+		// THUMBNAIL_WIDTH x THUMBNAIL_HEIGHT, RGBA.
+		std::vector<std::uint8_t> pixels;
+	};
+
+	struct Entry {
+		Preview preview;
+		SDL_Texture* texture = nullptr;
+	};
+
+	PreviewCache(std::filesystem::path directory, std::filesystem::path cacheDirectory);
+	~PreviewCache();
+
+	PreviewCache(const PreviewCache&) = delete;
+	PreviewCache& operator=(const PreviewCache&) = delete;
+	PreviewCache(PreviewCache&&) = delete;
+	PreviewCache& operator=(PreviewCache&&) = delete;
+
+	// Returns nullptr and queues the document while its preview is not ready.
+	const Entry* Find(const std::string& fileName);
+	void Invalidate(const std::string& fileName);
+	// Takes over finished previews and uploads their thumbnails. Main thread only.
+	void Poll(SDL_Renderer* renderer);
+	// Stops the worker and releases the textures; call while the renderer is alive.
+	void Shutdown() noexcept;
+
+private:
+	struct Result {
+		std::string fileName;
+		std::optional<Preview> preview;
+	};
+
+	void WorkerLoop();
+	std::optional<Preview> Build(const std::string& fileName) const;
+	static void DestroyTexture(Entry& entry) noexcept;
+
+	std::filesystem::path directory;
+	std::filesystem::path cacheDirectory;
+
+	// Main thread only.
+	std::map<std::string, Entry> entries;
+	std::set<std::string> requested;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::string> queue;
+	std::vector<Result> results;
+	bool isStopping = false;
+	std::thread worker;
+};
@@ -0,0 +1,148 @@
+#include "RenderThread.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "AllocationTracker.hpp"
+
+namespace {
+	SDL_Color ToColor(const glm::vec4& color) noexcept {
+		const auto channel = [](const float value) { return static_cast<Uint8>(std::clamp(value, 0.0f, 1.0f) * 255.0f); };
+		return {channel(color.r), channel(color.g), channel(color.b), channel(color.a)};
+	}
+
+	// Two triangles over corners given in order around the quad.
+	void AddQuad(RenderThread::Frame& frame, const glm::vec2 a, const glm::vec2 b, const glm::vec2 c, const glm::vec2 d, const SDL_Color color) {
+		const int first = static_cast<int>(frame.vertices.size());
+		for(const glm::vec2 corner: {a, b, c, d}) frame.vertices.push_back({{corner.x, corner.y}, color, {0.0f, 0.0f}});
+		for(const int offset: {0, 1, 2, 0, 2, 3}) frame.indices.push_back(first + offset);
+	}
+
+	void AddRect(RenderThread::Frame& frame, const glm::vec2 min, const glm::vec2 max, const SDL_Color color) {
+		AddQuad(frame, min, {max.x, min.y}, max, {min.x, max.y}, color);
+	}
+
+	// One pixel wide, extended by half a pixel at both ends so corners of a polyline close.
+	void AddLine(RenderThread::Frame& frame, const glm::vec2 from, const glm::vec2 to, const SDL_Color color) {
+		const glm::vec2 delta = to - from;
+		const float length = std::hypot(delta.x, delta.y);
+		if(length <= 0.0f) return;
+		const glm::vec2 along = delta / length * 0.5f;
+		const glm::vec2 across {-along.y, along.x};
+		AddQuad(frame, from - along + across, to + along + across, to + along - across, from - along - across, color);
+	}
+}
+
+RenderThread::RenderThread() {
+#ifndef __EMSCRIPTEN__
+	thread = std::thread(&RenderThread::ThreadLoop, this);
+#endif
+}
+
+RenderThread::~RenderThread() {
+#ifndef __EMSCRIPTEN__
+	{
+		std::lock_guard lock(mutex);
+		isStopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+#endif
+}
+
+Diagram::SceneSnapshot& RenderThread::BeginScene(const Diagram::Camera& camera, const glm::vec2 screenSize) {
+	{
+		// Only if last frame's scene was published but never collected.
+		std::unique_lock lock(mutex);
+		done.wait(lock, [this] { return !hasWork; });
+	}
+	auto& scene = scenes[back];
+	scene.Reset(camera, screenSize);
+	return scene;
+}
+
+void RenderThread::Publish() {
+#ifdef __EMSCRIPTEN__
+	Tessellate(scenes[back], frames[back]);
+#else
+	{
+		std::lock_guard lock(mutex);
+		hasWork = true;
+	}
+	wake.notify_one();
+#endif
+}
+
+const RenderThread::Frame& RenderThread::Collect() {
+	{
+		std::unique_lock lock(mutex);
+		done.wait(lock, [this] { return !hasWork; });
+	}
+	const auto& frame = frames[back];
+	back ^= 1;
+	return frame;
+}
+
+void RenderThread::ThreadLoop() {
+	// Tessellation is part of every frame, so it counts toward the frame's allocations.
+	AllocationTracker::SetThreadPhase(AllocationTracker::Phase::Tessellate);
+	std::unique_lock lock(mutex);
+	while(true) {
+		wake.wait(lock, [this] { return hasWork || isStopping; });
+		if(isStopping) return;
+		// The main thread leaves both buffers alone until hasWork is cleared.
+		const std::size_t index = back;
+		lock.unlock();
+		Tessellate(scenes[index], frames[index]);
+		lock.lock();
+		hasWork = false;
+		done.notify_one();
+	}
+}
+
+void RenderThread::Tessellate(const Diagram::SceneSnapshot& scene, Frame& frame) {
+	const auto start = std::chrono::steady_clock::now();
+	frame.scene = &scene;
+	frame.vertices.clear();
+	frame.indices.clear();
+	frame.labels.clear();
+	const float zoom = scene.camera.data.zoom;
+
+	for(std::uint32_t index = 0; index < scene.rects.size(); ++index) {
+		const auto& rect = scene.rects[index];
+		const glm::vec2 corner = scene.camera.WorldToScreen(rect.position, scene.screenSize);
+		const glm::vec2 min {std::min(corner.x, corner.x + rect.size.x * zoom), std::min(corner.y, corner.y + rect.size.y * zoom)};
+		const glm::vec2 max {std::max(corner.x, corner.x + rect.size.x * zoom), std::max(corner.y, corner.y + rect.size.y * zoom)};
+		AddRect(frame, min, max, ToColor(rect.fill));
+		// A one pixel border just inside, like SDL_RenderDrawRectF.
+		const SDL_Color border = ToColor(rect.border);
+		AddRect(frame, min, {max.x, min.y + 1.0f}, border);
+		AddRect(frame, {min.x, max.y - 1.0f}, max, border);
+		AddRect(frame, {min.x, min.y + 1.0f}, {min.x + 1.0f, max.y - 1.0f}, border);
+		AddRect(frame, {max.x - 1.0f, min.y + 1.0f}, {max.x, max.y - 1.0f}, border);
+		if(rect.labelLength > 0) frame.labels.push_back({(min + max) * 0.5f, zoom, index});
+	}
+
+	for(const auto& arrow: scene.arrows) {
+		if(arrow.count < 2) continue;
+		const SDL_Color color = ToColor(arrow.color);
+		glm::vec2 from = scene.camera.WorldToScreen(scene.points[arrow.first], scene.screenSize);
+		glm::vec2 tip = from;
+		for(std::uint32_t i = 1; i < arrow.count; ++i) {
+			from = tip;
+			tip = scene.camera.WorldToScreen(scene.points[arrow.first + i], scene.screenSize);
+			AddLine(frame, from, tip, color);
+		}
+
+		// Routes end axis-aligned, so the arrowhead is too.
+		const glm::vec2 delta = tip - from;
+		const float length = std::hypot(delta.x, delta.y);
+		if(length <= 0.0f) continue;
+		const glm::vec2 direction = delta / length;
+		const glm::vec2 normal {-direction.y, direction.x};
+		const glm::vec2 base = tip - direction * ARROW_LENGTH;
+		AddLine(frame, tip, base + normal * ARROW_WIDTH, color);
+		AddLine(frame, tip, base - normal * ARROW_WIDTH, color);
+	}
+	frame.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <glm/vec2.hpp>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Diagram/SceneSnapshot.hpp"
+
+// Turns the canvas into triangles off the main thread. Each frame the main thread fills a
+// scene snapshot from the components and publishes it, then builds the UI while this
+// thread tessellates the snapshot; the result is drawn with one SDL_RenderGeometry call.
+// Scenes and their geometry are double-buffered: the pair drawn last frame stays intact
+// while the next scene is filled. SDL_Renderer calls, and with them the present, have to
+// stay on the thread that created the renderer, so only the preparation moves here. On
+// Emscripten, which has no threads, the snapshot is tessellated when it is published.
+class RenderThread
+{
+public:
+	// Screen-space geometry for one scene.
+	struct Frame {
+		struct Label {
+			glm::vec2 center {0.0f};
+			float fontSize = 0.0f;
+			// Index into the scene's rects, whose label this is.
+			std::uint32_t rect = 0;
+		};
+
+		const Diagram::SceneSnapshot* scene = nullptr;
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+		// Text needs the UI font, so it is left to the main thread.
+		std::vector<Label> labels;
+		std::chrono::microseconds elapsed {0};
+	};
+
+	// Arrowhead size in pixels.
+	static constexpr float ARROW_LENGTH = 8.0f;
+	static constexpr float ARROW_WIDTH = 4.0f;
+
+	RenderThread();
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+	RenderThread(RenderThread&&) = delete;
+	RenderThread& operator=(RenderThread&&) = delete;
+
+	// Main thread: the scene to fill for this frame, emptied and set to `camera`.
+	Diagram::SceneSnapshot& BeginScene(const Diagram::Camera& camera, glm::vec2 screenSize);
+	// Main thread: hands the filled scene over for tessellation.
+	void Publish();
+	// Main thread: waits for the published scene's geometry. It and its scene stay valid
+	// until the BeginScene after next.
+	const Frame& Collect();
+
+	// Of the last collected frame.
+	const Frame& GetLastFrame() const noexcept { return frames[back ^ 1]; }
+
+private:
+	static void Tessellate(const Diagram::SceneSnapshot& scene, Frame& frame);
+	void ThreadLoop();
+
+	std::array<Diagram::SceneSnapshot, 2> scenes;
+	std::array<Frame, 2> frames;
+	// The buffer the main thread fills next.
+	std::size_t back = 0;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	// Set by Publish, cleared by the thread once frames[back] is ready.
+	bool hasWork = false;
+	bool isStopping = false;
+};
@@ -1,6 +1,11 @@
 #include "Renderer.hpp"
 
-#include "../Diagram/Block.hpp"
+#include <imgui.h>
+
+#include <cfloat>
+#include <string_view>
+
+#include "../Diagram/AlignmentGuides.hpp"
 #include "../Diagram/Camera.hpp"
 #include "../Diagram/Grid.hpp"
 
@@ -24,10 +29,36 @@ void Renderer::DrawGrid(const Diagram::Camera& camera, const Diagram::Grid& grid
 	grid.Render(rendererPtr, camera);
 }
 
+void Renderer::DrawAlignmentGuides(const Diagram::Camera& camera, const Diagram::AlignmentGuides& guides) const noexcept {
+	guides.Render(rendererPtr, camera);
+}
+
+void Renderer::DrawScene(const RenderThread::Frame& frame) const noexcept {
+	if(!frame.indices.empty()) {
+		SDL_RenderGeometry(rendererPtr, nullptr, frame.vertices.data(), static_cast<int>(frame.vertices.size()), frame.indices.data(), static_cast<int>(frame.indices.size()));
+	}
+	if(frame.labels.empty()) return;
+
+	ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+	ImFont* font = ImGui::GetFont();
+	for(const auto& label: frame.labels) {
+		const std::string_view text = frame.scene->GetLabel(frame.scene->rects[label.rect]);
+		const ImVec2 textSize = font->CalcTextSizeA(label.fontSize, FLT_MAX, 0.0f, text.data(), text.data() + text.size());
+		const ImVec2 textPos(label.center.x - textSize.x * 0.5f, label.center.y - textSize.y * 0.5f);
+		drawList->AddText(font, label.fontSize, textPos, IM_COL32(255, 255, 255, 255), text.data(), text.data() + text.size());
+	}
+}
+
 void Renderer::Present() const noexcept {
 	SDL_RenderPresent(rendererPtr);
 }
 
 SDL_Renderer* Renderer::GetSDLRenderer() const noexcept {
 	return rendererPtr;
+}
+
+glm::vec2 Renderer::GetOutputSize() const noexcept {
+	int width, height;
+	SDL_GetRendererOutputSize(rendererPtr, &width, &height);
+	return {static_cast<float>(width), static_cast<float>(height)};
 }
\ No newline at end of file
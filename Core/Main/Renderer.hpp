@@ -3,13 +3,12 @@
 #include <SDL.h>
 
 #include <glm/vec2.hpp>
-#include <memory>
-#include <vector>
 
-#include "../Diagram/Component.hpp"
+#include "RenderThread.hpp"
 
 namespace Diagram
 {
+	class AlignmentGuides;
 	struct Camera;
 	struct Grid;
 }
@@ -28,20 +27,15 @@ public:
 	bool Initialize(SDL_Window* window) noexcept;
 	void Clear() const noexcept;
 	void DrawGrid(const Diagram::Camera& camera, const Diagram::Grid& grid) const noexcept;
+	void DrawAlignmentGuides(const Diagram::Camera& camera, const Diagram::AlignmentGuides& guides) const noexcept;
 
-	void DrawComponents(const std::vector<std::unique_ptr<Diagram::ComponentBase>>& componentList, const Diagram::Camera& camera) const noexcept {
-		int rendererWidth, rendererHeight;
-		SDL_GetRendererOutputSize(rendererPtr, &rendererWidth, &rendererHeight);
-		const glm::vec2 screenSize {static_cast<float>(rendererWidth), static_cast<float>(rendererHeight)};
-
-		for(const auto& item: componentList) {
-			item->Render(rendererPtr, camera, screenSize);
-		}
-	}
+	// The canvas geometry from the render thread, and the block labels over it.
+	void DrawScene(const RenderThread::Frame& frame) const noexcept;
 
 	void Present() const noexcept;
 
 	SDL_Renderer* GetSDLRenderer() const noexcept;
+	glm::vec2 GetOutputSize() const noexcept;
 
 private:
 	SDL_Renderer* rendererPtr = nullptr;
@@ -0,0 +1,172 @@
+#include "UndoHistory.hpp"
+
+#include <algorithm>
+
+namespace {
+	// Rough heap cost of a component held by an insert or delete entry.
+	constexpr std::size_t PAYLOAD_BYTES = 256;
+
+	std::size_t StringBytes(const std::string& text) noexcept {
+		return text.capacity() > 15 ? text.capacity() + 1 : 0;
+	}
+
+	std::size_t ValueBytes(const UndoHistory::FieldValue& value) noexcept {
+		const auto* text = std::get_if<std::string>(&value);
+		return text ? StringBytes(*text) : 0;
+	}
+}
+
+void UndoHistory::RecordFields(Diagram::Block& block, const Diagram::Block::Data& before, const bool isContinuing) {
+	RecordDeltas(block, DiffFields(before, block.data), isContinuing);
+}
+
+void UndoHistory::RecordFields(Diagram::Connector& connector, const Diagram::Connector::Data& before, const bool isContinuing) {
+	RecordDeltas(connector, DiffFields(before, connector.data), isContinuing);
+}
+
+void UndoHistory::RecordRegroup(Diagram::ComponentBase& component, std::string before) {
+	if(before == component.groupId) return;
+	Change change {Kind::Regroup, &component};
+	change.before = std::move(before);
+	change.after = component.groupId;
+	std::vector<Change> changes;
+	changes.push_back(std::move(change));
+	Record(std::move(changes));
+}
+
+void UndoHistory::RecordSwap(Diagram::ComponentBase& first, const std::size_t firstIndex, Diagram::ComponentBase& second, const std::size_t secondIndex) {
+	Change change {Kind::Swap, &first, &second};
+	change.index = firstIndex;
+	change.otherIndex = secondIndex;
+	std::vector<Change> changes;
+	changes.push_back(std::move(change));
+	Record(std::move(changes));
+}
+
+void UndoHistory::RecordInsert(Diagram::ComponentBase& component, const std::size_t index) {
+	Change change {Kind::Insert, &component};
+	change.index = index;
+	std::vector<Change> changes;
+	changes.push_back(std::move(change));
+	Record(std::move(changes));
+}
+
+void UndoHistory::RecordDelete(std::unique_ptr<Diagram::ComponentBase>& component, const std::size_t index) {
+	Change change {Kind::Delete, component.get()};
+	change.payload = std::move(component);
+	change.index = index;
+	std::vector<Change> changes;
+	changes.push_back(std::move(change));
+	Record(std::move(changes));
+}
+
+void UndoHistory::Record(std::vector<Change> changes) {
+	if(changes.empty()) return;
+	Entry entry;
+	entry.changes = std::move(changes);
+	Push(std::move(entry), false);
+}
+
+void UndoHistory::Clear() noexcept {
+	undoEntries.clear();
+	redoEntries.clear();
+	totalBytes = 0;
+	isLastOpen = false;
+}
+
+std::optional<UndoHistory::Entry> UndoHistory::PopUndo() {
+	if(undoEntries.empty()) return std::nullopt;
+	isLastOpen = false;
+	Entry entry = std::move(undoEntries.back());
+	undoEntries.pop_back();
+	totalBytes -= entry.bytes;
+	return entry;
+}
+
+std::optional<UndoHistory::Entry> UndoHistory::PopRedo() {
+	if(redoEntries.empty()) return std::nullopt;
+	isLastOpen = false;
+	Entry entry = std::move(redoEntries.back());
+	redoEntries.pop_back();
+	totalBytes -= entry.bytes;
+	return entry;
+}
+
+void UndoHistory::PushUndo(Entry entry) {
+	// Ownership of payloads moves while applying, so the size is taken again.
+	entry.bytes = ApproximateBytes(entry);
+	totalBytes += entry.bytes;
+	undoEntries.push_back(std::move(entry));
+	Evict();
+}
+
+void UndoHistory::PushRedo(Entry entry) {
+	entry.bytes = ApproximateBytes(entry);
+	totalBytes += entry.bytes;
+	redoEntries.push_back(std::move(entry));
+}
+
+void UndoHistory::SetMemoryLimit(const std::size_t bytes) {
+	memoryLimit = bytes;
+	Evict();
+}
+
+void UndoHistory::RecordDeltas(Diagram::ComponentBase& component, std::vector<FieldDelta> deltas, const bool isContinuing) {
+	if(deltas.empty()) return;
+
+	if(isLastOpen && !undoEntries.empty()) {
+		auto& last = undoEntries.back();
+		if(last.changes.size() == 1 && last.changes.front().kind == Kind::Fields && last.changes.front().component == &component) {
+			// Keep the value from before the gesture, take the newest one after it.
+			auto& fields = last.changes.front().fields;
+			for(auto& delta: deltas) {
+				const auto it = std::ranges::find(fields, delta.field, &FieldDelta::field);
+				if(it != fields.end()) it->after = std::move(delta.after);
+				else fields.push_back(std::move(delta));
+			}
+			totalBytes -= last.bytes;
+			last.bytes = ApproximateBytes(last);
+			totalBytes += last.bytes;
+			isLastOpen = isContinuing;
+			Evict();
+			return;
+		}
+	}
+
+	Change change {Kind::Fields, &component};
+	change.fields = std::move(deltas);
+	Entry entry;
+	entry.changes.push_back(std::move(change));
+	Push(std::move(entry), isContinuing);
+}
+
+std::size_t UndoHistory::ApproximateBytes(const Entry& entry) noexcept {
+	std::size_t bytes = sizeof(Entry) + entry.changes.capacity() * sizeof(Change);
+	for(const auto& change: entry.changes) {
+		bytes += StringBytes(change.groupId) + StringBytes(change.before) + StringBytes(change.after);
+		bytes += change.fields.capacity() * sizeof(FieldDelta);
+		for(const auto& delta: change.fields) bytes += ValueBytes(delta.before) + ValueBytes(delta.after);
+		if(change.payload) bytes += PAYLOAD_BYTES + StringBytes(change.payload->id) + StringBytes(change.payload->groupId);
+	}
+	return bytes;
+}
+
+void UndoHistory::Push(Entry entry, const bool isOpen) {
+	// A new edit forks history; whatever was undone cannot be redone anymore.
+	for(const auto& redone: redoEntries) totalBytes -= redone.bytes;
+	redoEntries.clear();
+
+	entry.bytes = ApproximateBytes(entry);
+	totalBytes += entry.bytes;
+	undoEntries.push_back(std::move(entry));
+	isLastOpen = isOpen;
+	Evict();
+}
+
+void UndoHistory::Evict() {
+	// The newest entry always stays, however large, so the last edit can be undone.
+	while(totalBytes > memoryLimit && undoEntries.size() > 1) {
+		totalBytes -= undoEntries.front().bytes;
+		undoEntries.pop_front();
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <boost/pfr.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "../Diagram/Block.hpp"
+#include "../Diagram/Component.hpp"
+#include "../Diagram/Connector.hpp"
+
+// Edit history for Undo/Redo. Entries hold deltas, never document snapshots: the
+// Block::Data and Connector::Data fields that changed with their old and new values, group moves as
+// parent ids, and the component itself for inserts and deletes, so an undo or redo
+// costs the size of the change. Changes point at components directly; a deleted
+// component is owned by its entry until it is restored or the entry goes away, which
+// keeps those pointers valid. The oldest entries are evicted once the approximate
+// footprint exceeds the memory limit.
+class UndoHistory
+{
+public:
+	using FieldValue = std::variant<glm::vec2, glm::vec4, std::string, Diagram::Block::Type>;
+
+	struct FieldDelta {
+		std::uint8_t field = 0;
+		FieldValue before;
+		FieldValue after;
+	};
+
+	enum class Kind : char {
+		Fields,
+		Regroup,
+		RegroupGroup,
+		Swap,
+		Insert,
+		Delete
+	};
+
+	struct Change {
+		Kind kind = Kind::Fields;
+		Diagram::ComponentBase* component = nullptr;
+		Diagram::ComponentBase* other = nullptr; // Swap
+		std::string groupId;					 // RegroupGroup
+		std::string before;						 // Regroup, RegroupGroup: parent id
+		std::string after;
+		std::vector<FieldDelta> fields;
+		// Insert, Delete: owns the component while it is not in the component list.
+		std::unique_ptr<Diagram::ComponentBase> payload;
+		// Insert, Delete, Swap: list position of `component`; Swap: and of `other`. Only a
+		// hint, checked before use.
+		std::size_t index = 0;
+		std::size_t otherIndex = 0;
+	};
+
+	struct Entry {
+		std::vector<Change> changes;
+		std::size_t bytes = 0;
+	};
+
+	static constexpr std::size_t DEFAULT_MEMORY_LIMIT = std::size_t(32) << 20;
+
+	// Fields edited by a continuing gesture (a drag, typing into a field) keep merging
+	// into one entry until the gesture ends or anything else is recorded.
+	void RecordFields(Diagram::Block& block, const Diagram::Block::Data& before, bool isContinuing = false);
+	void RecordFields(Diagram::Connector& connector, const Diagram::Connector::Data& before, bool isContinuing = false);
+	void RecordRegroup(Diagram::ComponentBase& component, std::string before);
+	// The indices are the two list positions involved.
+	void RecordSwap(Diagram::ComponentBase& first, std::size_t firstIndex, Diagram::ComponentBase& second, std::size_t secondIndex);
+	void RecordInsert(Diagram::ComponentBase& component, std::size_t index);
+	// Takes over the removed component; the caller erases the emptied slot.
+	void RecordDelete(std::unique_ptr<Diagram::ComponentBase>& component, std::size_t index);
+	void Record(std::vector<Change> changes);
+	// Ends the gesture, if any, that the last entry is still merging.
+	void Seal() noexcept { isLastOpen = false; }
+	void Clear() noexcept;
+
+	bool CanUndo() const noexcept { return !undoEntries.empty(); }
+	bool CanRedo() const noexcept { return !redoEntries.empty(); }
+	std::optional<Entry> PopUndo();
+	std::optional<Entry> PopRedo();
+	void PushUndo(Entry entry);
+	void PushRedo(Entry entry);
+
+	std::size_t GetUndoCount() const noexcept { return undoEntries.size(); }
+	std::size_t GetRedoCount() const noexcept { return redoEntries.size(); }
+	std::size_t GetMemoryUsage() const noexcept { return totalBytes; }
+	std::size_t GetMemoryLimit() const noexcept { return memoryLimit; }
+	void SetMemoryLimit(std::size_t bytes);
+
+	template<typename T>
+	static std::vector<FieldDelta> DiffFields(const T& before, const T& after) {
+		std::vector<FieldDelta> deltas;
+		DiffFields(before, after, deltas, std::make_index_sequence<boost::pfr::tuple_size_v<T>> {});
+		return deltas;
+	}
+
+	template<typename T>
+	static void ApplyFields(T& target, const std::vector<FieldDelta>& deltas, const bool isUndo) {
+		for(const auto& delta: deltas) {
+			ApplyField(target, delta.field, isUndo ? delta.before : delta.after, std::make_index_sequence<boost::pfr::tuple_size_v<T>> {});
+		}
+	}
+
+private:
+	template<typename T, std::size_t... I>
+	static void DiffFields(const T& before, const T& after, std::vector<FieldDelta>& deltas, std::index_sequence<I...>) {
+		((boost::pfr::get<I>(before) != boost::pfr::get<I>(after) ? deltas.push_back({static_cast<std::uint8_t>(I), boost::pfr::get<I>(before), boost::pfr::get<I>(after)}) : void()), ...);
+	}
+
+	template<typename T, std::size_t... I>
+	static void ApplyField(T& target, const std::size_t field, const FieldValue& value, std::index_sequence<I...>) {
+		((field == I ? void(boost::pfr::get<I>(target) = std::get<std::remove_cvref_t<decltype(boost::pfr::get<I>(target))>>(value)) : void()), ...);
+	}
+
+	void RecordDeltas(Diagram::ComponentBase& component, std::vector<FieldDelta> deltas, bool isContinuing);
+	static std::size_t ApproximateBytes(const Entry& entry) noexcept;
+	void Push(Entry entry, bool isOpen);
+	void Evict();
+
+	std::deque<Entry> undoEntries;
+	std::vector<Entry> redoEntries;
+	std::size_t totalBytes = 0;
+	std::size_t memoryLimit = DEFAULT_MEMORY_LIMIT;
+	bool isLastOpen = false;
+};
@@ -0,0 +1,96 @@
+#include "WorkspaceWatcher.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <spdlog/spdlog.h>
+
+#include "../Utils/Path.hpp"
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define IS_INOTIFY_AVAILABLE 1
+#endif
+
+namespace fs = std::filesystem;
+
+WorkspaceWatcher::WorkspaceWatcher(fs::path directory) : directory(std::move(directory)) {
+#ifdef IS_INOTIFY_AVAILABLE
+	notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(notifyDescriptor >= 0) {
+		constexpr std::uint32_t MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+		if(inotify_add_watch(notifyDescriptor, this->directory.c_str(), MASK) >= 0) return;
+		close(notifyDescriptor);
+		notifyDescriptor = -1;
+	}
+	spdlog::warn("inotify unavailable for {}, falling back to directory scans", this->directory.string());
+#endif
+	listing = ScanDirectory();
+	lastScan = std::chrono::steady_clock::now();
+}
+
+WorkspaceWatcher::~WorkspaceWatcher() {
+#ifdef IS_INOTIFY_AVAILABLE
+	if(notifyDescriptor >= 0) close(notifyDescriptor);
+#endif
+}
+
+WorkspaceWatcher::Changes WorkspaceWatcher::Poll() {
+	return notifyDescriptor >= 0 ? PollNotifications() : PollByScanning();
+}
+
+WorkspaceWatcher::Changes WorkspaceWatcher::PollNotifications() {
+	Changes changes;
+#ifdef IS_INOTIFY_AVAILABLE
+	const auto addModified = [&changes](std::string name) {
+		if(std::ranges::find(changes.modifiedFiles, name) == changes.modifiedFiles.end()) changes.modifiedFiles.push_back(std::move(name));
+	};
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length;
+	while((length = read(notifyDescriptor, buffer, sizeof(buffer))) > 0) {
+		for(const char* cursor = buffer; cursor < buffer + length;) {
+			const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+			cursor += sizeof(inotify_event) + event->len;
+
+			if(event->mask & IN_Q_OVERFLOW) {
+				// Events were dropped; report everything and let the consumers sort it out.
+				changes.isListingChanged = true;
+				for(const auto& name: ScanDirectory() | std::views::keys) addModified(name);
+				continue;
+			}
+			if(event->len == 0 || !Utils::IsDiagramDocument(event->name)) continue;
+
+			if(event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) changes.isListingChanged = true;
+			// Saves land either as a rewrite in place or as a rename over the old file.
+			if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) addModified(event->name);
+		}
+	}
+#endif
+	return changes;
+}
+
+WorkspaceWatcher::Changes WorkspaceWatcher::PollByScanning() {
+	Changes changes;
+	const auto now = std::chrono::steady_clock::now();
+	if(now - lastScan < SCAN_INTERVAL) return changes;
+	lastScan = now;
+
+	auto current = ScanDirectory();
+	changes.isListingChanged = !std::ranges::equal(current | std::views::keys, listing | std::views::keys);
+	for(const auto& [name, signature]: current) {
+		if(const auto it = listing.find(name); it != listing.end() && it->second != signature) changes.modifiedFiles.push_back(name);
+	}
+	listing = std::move(current);
+	return changes;
+}
+
+WorkspaceWatcher::Listing WorkspaceWatcher::ScanDirectory() const {
+	Listing result;
+	std::error_code error;
+	for(const auto& entry: fs::directory_iterator(directory, error)) {
+		if(!entry.is_regular_file(error) || !Utils::IsDiagramDocument(entry.path())) continue;
+		result.emplace(entry.path().filename().string(), std::pair {entry.last_write_time(error), entry.file_size(error)});
+	}
+	return result;
+}
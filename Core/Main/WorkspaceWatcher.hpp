@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reports diagram documents being added to, removed from or rewritten in the workspace
+// directory. On Linux it reads an inotify descriptor without blocking, so polling it
+// every frame costs one syscall; elsewhere it compares directory listings at most every
+// SCAN_INTERVAL.
+class WorkspaceWatcher
+{
+public:
+	struct Changes {
+		bool isListingChanged = false;
+		// File names, relative to the watched directory.
+		std::vector<std::string> modifiedFiles;
+	};
+
+	static constexpr auto SCAN_INTERVAL = std::chrono::seconds(1);
+
+	explicit WorkspaceWatcher(std::filesystem::path directory);
+	~WorkspaceWatcher();
+
+	WorkspaceWatcher(const WorkspaceWatcher&) = delete;
+	WorkspaceWatcher& operator=(const WorkspaceWatcher&) = delete;
+	WorkspaceWatcher(WorkspaceWatcher&&) = delete;
+	WorkspaceWatcher& operator=(WorkspaceWatcher&&) = delete;
+
+	Changes Poll();
+
+private:
+	using Listing = std::map<std::string, std::pair<std::filesystem::file_time_type, std::uintmax_t>>;
+
+	Changes PollNotifications();
+	Changes PollByScanning();
+	Listing ScanDirectory() const;
+
+	std::filesystem::path directory;
+	int notifyDescriptor = -1;
+
+	Listing listing;
+	std::chrono::steady_clock::time_point lastScan;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MemoryAccounting.hpp"
+
+namespace Utils {
+    // Stateless allocator charging the serialization line of the memory accounting.
+    template<typename T>
+    struct SerializationAllocator {
+        using value_type = T;
+
+        SerializationAllocator() noexcept = default;
+        template<typename U>
+        SerializationAllocator(const SerializationAllocator<U>&) noexcept {}
+
+        T* allocate(const std::size_t count) {
+            return static_cast<T*>(MemoryAccounting::Allocate(MemoryAccounting::Subsystem::Serialization, count * sizeof(T)));
+        }
+        void deallocate(T* pointer, const std::size_t count) noexcept {
+            MemoryAccounting::Deallocate(MemoryAccounting::Subsystem::Serialization, pointer, count * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const SerializationAllocator<U>&) const noexcept { return true; }
+    };
+
+    // What whole JSON documents are parsed into, so they are charged like pugixml's. The
+    // codecs take nlohmann::json, which converts from it, one component at a time.
+    using AccountedJson = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, SerializationAllocator>;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Utils {
+    // Writes go to "<path>.tmp"; Commit() flushes, fsyncs and renames it over the
+    // target, so readers only ever see the old file or the complete new one.
+    class AtomicFile {
+    public:
+        explicit AtomicFile(std::filesystem::path targetPath)
+            : target(std::move(targetPath)), temporary(target.string() + ".tmp") {
+            file = std::fopen(temporary.string().c_str(), "wb");
+        }
+
+        ~AtomicFile() {
+            if (file) std::fclose(file);
+            if (!committed) {
+                std::error_code ignored;
+                std::filesystem::remove(temporary, ignored);
+            }
+        }
+
+        AtomicFile(const AtomicFile&) = delete;
+        AtomicFile& operator=(const AtomicFile&) = delete;
+
+        bool IsOpen() const noexcept { return file != nullptr; }
+        std::FILE* Get() const noexcept { return file; }
+
+        bool Commit(std::string& error) {
+            if (!file) {
+                error = "cannot open " + temporary.string();
+                return false;
+            }
+
+            const bool isWritten = std::fflush(file) == 0 && !std::ferror(file) && SyncFile(file);
+            const bool isClosed = std::fclose(file) == 0;
+            file = nullptr;
+            if (!isWritten || !isClosed) {
+                error = "cannot write " + temporary.string();
+                return false;
+            }
+
+            std::error_code renameError;
+            std::filesystem::rename(temporary, target, renameError);
+            if (renameError) {
+                error = "cannot replace " + target.string() + ": " + renameError.message();
+                return false;
+            }
+
+            committed = true;
+            SyncDirectory(target.parent_path());
+            return true;
+        }
+
+        static bool SyncFile(std::FILE* stream) noexcept {
+#ifdef _WIN32
+            return _commit(_fileno(stream)) == 0;
+#else
+            return fsync(fileno(stream)) == 0;
+#endif
+        }
+
+    private:
+        // Makes the rename itself durable; best effort, there is nothing to undo on failure.
+        static void SyncDirectory(const std::filesystem::path& directory) noexcept {
+#ifndef _WIN32
+            const std::string path = directory.empty() ? "." : directory.string();
+            if (const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY); fd >= 0) {
+                fsync(fd);
+                close(fd);
+            }
+#endif
+        }
+
+        std::filesystem::path target;
+        std::filesystem::path temporary;
+        std::FILE* file = nullptr;
+        bool committed = false;
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace Utils {
+    // Bump allocator for data that lives no longer than the current frame; main thread only.
+    // Allocating moves a pointer and deallocating does nothing, and Reset at the end of the
+    // frame releases everything at once. A frame that outgrows the buffer spills onto the
+    // heap, and the next Reset grows the buffer to cover it, so steady-state frames settle
+    // at no heap traffic. Nothing allocated here may be kept past Reset.
+    class FrameArena final : public std::pmr::memory_resource {
+    public:
+        static constexpr std::size_t INITIAL_CAPACITY = 256 * 1024;
+
+        static FrameArena& Instance() {
+            static FrameArena instance;
+            return instance;
+        }
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void Reset() {
+            m_lastFrameBytes = m_frameBytes;
+            m_peakFrameBytes = std::max(m_peakFrameBytes, m_frameBytes);
+            m_frameBytes = 0;
+            m_resource.reset();
+            if (m_isSpilled) {
+                // Alignment padding is not counted in the bytes, hence the headroom.
+                m_capacity = std::max(m_capacity * 2, m_lastFrameBytes + m_lastFrameBytes / 2);
+                m_buffer = std::make_unique<std::byte[]>(m_capacity);
+                m_isSpilled = false;
+            }
+            m_resource.emplace(m_buffer.get(), m_capacity, &m_spill);
+        }
+
+        std::size_t GetCapacity() const noexcept { return m_capacity; }
+        std::size_t GetFrameBytes() const noexcept { return m_frameBytes; }
+        std::size_t GetLastFrameBytes() const noexcept { return m_lastFrameBytes; }
+        std::size_t GetPeakFrameBytes() const noexcept { return m_peakFrameBytes; }
+
+    private:
+        // The heap behind the buffer; notes that the buffer ran out.
+        class SpillResource final : public std::pmr::memory_resource {
+        public:
+            explicit SpillResource(bool& isSpilled) : m_isSpilled(isSpilled) {}
+
+        private:
+            void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+                m_isSpilled = true;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void* pointer, const std::size_t bytes, const std::size_t alignment) override {
+                std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+            bool& m_isSpilled;
+        };
+
+        FrameArena() { m_resource.emplace(m_buffer.get(), m_capacity, &m_spill); }
+
+        void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+            m_frameBytes += bytes;
+            return m_resource->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        std::size_t m_capacity = INITIAL_CAPACITY;
+        std::unique_ptr<std::byte[]> m_buffer = std::make_unique<std::byte[]>(INITIAL_CAPACITY);
+        bool m_isSpilled = false;
+        SpillResource m_spill{m_isSpilled};
+        // Rebuilt by every Reset, which may also have replaced the buffer.
+        std::optional<std::pmr::monotonic_buffer_resource> m_resource;
+        std::size_t m_frameBytes = 0;
+        std::size_t m_lastFrameBytes = 0;
+        std::size_t m_peakFrameBytes = 0;
+    };
+}
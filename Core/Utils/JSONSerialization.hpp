@@ -0,0 +1,100 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <boost/pfr.hpp>
+#include <magic_enum/magic_enum.hpp>
+#include <array>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "XMLSerialization.hpp"
+
+// JSON counterpart of XMLSerialization.hpp, driven by the same reflected field tables:
+// structs become objects keyed by field name, vectors become {"x": .., "y": ..}
+// objects and enums are stored by name.
+namespace JSON {
+    using XML::detail::comp_count;
+    using XML::detail::component_index;
+    using XML::detail::component_policy;
+    using XML::detail::field_table;
+    using XML::detail::Indexable;
+
+    template<typename T>
+    void auto_serialize(const T& obj, nlohmann::json& node);
+
+    template<typename T>
+    void auto_deserialize(T& obj, const nlohmann::json& node);
+
+    template<class T>
+    void serialize_value(nlohmann::json& node, const T& field) {
+        if constexpr (std::is_enum_v<T>) {
+            node = std::string(magic_enum::enum_name(field));
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
+            node = field;
+        } else if constexpr (Indexable<T>) {
+            constexpr std::size_t N = comp_count<T>();
+            node = nlohmann::json::object();
+            for (std::size_t i = 0; i < N; ++i) {
+                node[component_policy<T>::names[i].data()] = field[i];
+            }
+        } else {
+            auto_serialize(field, node);
+        }
+    }
+
+    template<class T>
+    void deserialize_value(const nlohmann::json& node, T& field) {
+        if constexpr (std::is_enum_v<T>) {
+            if (!node.is_string()) return;
+            if (auto v = magic_enum::enum_cast<T>(node.get_ref<const std::string&>())) field = *v;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (node.is_boolean()) field = node.get<bool>();
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            if (node.is_number()) field = node.get<T>();
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (node.is_string()) field = node.get<std::string>();
+        } else if constexpr (Indexable<T>) {
+            if (!node.is_object()) return;
+            constexpr std::size_t N = comp_count<T>();
+            for (auto it = node.begin(); it != node.end(); ++it) {
+                const std::size_t i = component_index<T>(it.key());
+                if (i == N || !it.value().is_number()) continue;
+                field[i] = static_cast<std::remove_reference_t<decltype(field[i])>>(it.value().template get<double>());
+            }
+        } else {
+            auto_deserialize(field, node);
+        }
+    }
+
+    namespace detail {
+        template<class T, std::size_t I>
+        void deserialize_member(T& obj, const nlohmann::json& node) {
+            deserialize_value(node, boost::pfr::get<I>(obj));
+        }
+
+        template<class T, std::size_t... I>
+        constexpr auto make_member_dispatch(std::index_sequence<I...>) {
+            return std::array<void (*)(T&, const nlohmann::json&), sizeof...(I)>{&deserialize_member<T, I>...};
+        }
+
+        template<class T>
+        inline constexpr auto member_dispatch = make_member_dispatch<T>(std::make_index_sequence<field_table<T>::count>{});
+    }
+
+    template<typename T>
+    void auto_serialize(const T& obj, nlohmann::json& node) {
+        node = nlohmann::json::object();
+        boost::pfr::for_each_field(obj, [&]<typename F>(const F& f, std::size_t i) {
+            serialize_value(node[field_table<T>::names[i].data()], f);
+        });
+    }
+
+    // Same single pass as the XML codec: each key is routed through the perfect hash.
+    template<typename T>
+    void auto_deserialize(T& obj, const nlohmann::json& node) {
+        if (!node.is_object()) return;
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            const std::size_t i = field_table<T>::find(it.key());
+            if (i != field_table<T>::count) detail::member_dispatch<T>[i](obj, it.value());
+        }
+    }
+}
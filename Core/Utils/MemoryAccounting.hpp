@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+namespace Utils {
+    // Live bytes, peaks and allocation rates per subsystem. Each subsystem is charged through
+    // the hook that fits it: class-level operator new for components and tree nodes, a
+    // std::pmr resource for strings and containers, and the allocator callbacks of pugixml
+    // and ImGui. std::string members no hook sees are measured instead, see SetMeasured.
+    // The counters are atomic, since documents are parsed on workers.
+    class MemoryAccounting {
+    public:
+        enum class Subsystem {
+            Components,
+            Strings,
+            Hierarchy,
+            Serialization,
+            UI,
+            Count
+        };
+
+        static constexpr std::size_t SUBSYSTEM_COUNT = static_cast<std::size_t>(Subsystem::Count);
+
+        struct Stats {
+            std::int64_t liveBytes = 0;
+            std::int64_t peakBytes = 0;
+            std::uint64_t allocationCount = 0;
+            double allocationsPerSecond = 0.0;
+            double bytesPerSecond = 0.0;
+        };
+
+        // How often the rates are refreshed.
+        static constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+
+        static const char* GetName(const Subsystem subsystem) noexcept {
+            static constexpr const char* names[SUBSYSTEM_COUNT] = {"Components", "Strings", "Hierarchy", "Serialization", "UI"};
+            return names[Index(subsystem)];
+        }
+
+        static void* Allocate(const Subsystem subsystem, const std::size_t bytes) {
+            void* pointer = ::operator new(bytes);
+            Charge(subsystem, bytes);
+            return pointer;
+        }
+
+        static void Deallocate(const Subsystem subsystem, void* pointer, const std::size_t bytes) noexcept {
+            if (!pointer) return;
+            Refund(subsystem, bytes);
+            ::operator delete(pointer, bytes);
+        }
+
+        // For C-style callbacks that free without a size, which is kept in front of the
+        // block. Returns null on failure, as malloc would.
+        static void* AllocateWithHeader(const Subsystem subsystem, const std::size_t bytes) noexcept {
+            auto* block = static_cast<std::byte*>(::operator new(HEADER_SIZE + bytes, std::nothrow));
+            if (!block) return nullptr;
+            *reinterpret_cast<std::size_t*>(block) = bytes;
+            Charge(subsystem, bytes);
+            return block + HEADER_SIZE;
+        }
+
+        static void DeallocateWithHeader(const Subsystem subsystem, void* pointer) noexcept {
+            if (!pointer) return;
+            auto* block = static_cast<std::byte*>(pointer) - HEADER_SIZE;
+            Refund(subsystem, *reinterpret_cast<const std::size_t*>(block));
+            ::operator delete(block);
+        }
+
+        static std::pmr::memory_resource* GetResource(const Subsystem subsystem) noexcept {
+            // Never destroyed: containers with static storage may still free through these
+            // while the program exits.
+            static auto* resources = new std::array<Resource, SUBSYSTEM_COUNT> {
+                Resource(Subsystem::Components), Resource(Subsystem::Strings), Resource(Subsystem::Hierarchy),
+                Resource(Subsystem::Serialization), Resource(Subsystem::UI)};
+            return &(*resources)[Index(subsystem)];
+        }
+
+        // Replaces what was last measured for `subsystem` with `bytes` in its live bytes and
+        // peak. Measurements are not allocations and leave the rates alone.
+        static void SetMeasured(const Subsystem subsystem, const std::size_t bytes) noexcept {
+            auto& counters = s_counters[Index(subsystem)];
+            const auto size = static_cast<std::int64_t>(bytes);
+            const std::int64_t delta = size - counters.measuredBytes.exchange(size, std::memory_order_relaxed);
+            RaisePeak(counters, counters.liveBytes.fetch_add(delta, std::memory_order_relaxed) + delta);
+        }
+
+        // Heap bytes behind `text`; none while it fits the small-string buffer.
+        static std::size_t HeapBytes(const std::string& text) noexcept {
+            static const std::size_t inlineCapacity = std::string().capacity();
+            return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+        }
+
+        // Main thread, once a frame: takes the counters and refreshes the rates every
+        // SAMPLE_INTERVAL. Returns whether it did, which is when measurements are retaken.
+        static bool Sample() {
+            const auto now = std::chrono::steady_clock::now();
+            const std::chrono::duration<double> window = now - s_sampleStart;
+            const bool isRateDue = window >= SAMPLE_INTERVAL;
+            for (std::size_t index = 0; index < SUBSYSTEM_COUNT; ++index) {
+                const auto& counters = s_counters[index];
+                auto& stats = s_stats[index];
+                stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+                stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+                stats.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+                if (!isRateDue) continue;
+
+                auto& sampled = s_sampled[index];
+                const std::uint64_t allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+                stats.allocationsPerSecond = static_cast<double>(stats.allocationCount - sampled.allocationCount) / window.count();
+                stats.bytesPerSecond = static_cast<double>(allocatedBytes - sampled.allocatedBytes) / window.count();
+                sampled = {stats.allocationCount, allocatedBytes};
+            }
+            if (isRateDue) s_sampleStart = now;
+            return isRateDue;
+        }
+
+        static const Stats& GetStats(const Subsystem subsystem) noexcept { return s_stats[Index(subsystem)]; }
+
+    private:
+        struct Counters {
+            std::atomic<std::int64_t> liveBytes = 0;
+            std::atomic<std::int64_t> peakBytes = 0;
+            std::atomic<std::uint64_t> allocationCount = 0;
+            std::atomic<std::uint64_t> allocatedBytes = 0;
+            // The part of liveBytes last set by SetMeasured.
+            std::atomic<std::int64_t> measuredBytes = 0;
+        };
+
+        // Totals at the start of the current rate window.
+        struct Sampled {
+            std::uint64_t allocationCount = 0;
+            std::uint64_t allocatedBytes = 0;
+        };
+
+        class Resource final : public std::pmr::memory_resource {
+        public:
+            explicit Resource(const Subsystem subsystem) : m_subsystem(subsystem) {}
+
+        private:
+            void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+                void* pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+                Charge(m_subsystem, bytes);
+                return pointer;
+            }
+
+            void do_deallocate(void* pointer, const std::size_t bytes, const std::size_t alignment) override {
+                Refund(m_subsystem, bytes);
+                std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+            Subsystem m_subsystem;
+        };
+
+        static constexpr std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+        static constexpr std::size_t Index(const Subsystem subsystem) noexcept { return static_cast<std::size_t>(subsystem); }
+
+        static void Charge(const Subsystem subsystem, const std::size_t bytes) noexcept {
+            auto& counters = s_counters[Index(subsystem)];
+            const auto size = static_cast<std::int64_t>(bytes);
+            RaisePeak(counters, counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+            counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+            counters.allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        static void RaisePeak(Counters& counters, const std::int64_t live) noexcept {
+            std::int64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+            while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        }
+
+        static void Refund(const Subsystem subsystem, const std::size_t bytes) noexcept {
+            s_counters[Index(subsystem)].liveBytes.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+        }
+
+        // Constant-initialized and trivially destructible, so usable at any point of startup
+        // and exit.
+        static std::array<Counters, SUBSYSTEM_COUNT> s_counters;
+        // Main thread only.
+        static std::array<Stats, SUBSYSTEM_COUNT> s_stats;
+        static std::array<Sampled, SUBSYSTEM_COUNT> s_sampled;
+        static std::chrono::steady_clock::time_point s_sampleStart;
+    };
+
+    inline constinit std::array<MemoryAccounting::Counters, MemoryAccounting::SUBSYSTEM_COUNT> MemoryAccounting::s_counters {};
+    inline std::array<MemoryAccounting::Stats, MemoryAccounting::SUBSYSTEM_COUNT> MemoryAccounting::s_stats {};
+    inline std::array<MemoryAccounting::Sampled, MemoryAccounting::SUBSYSTEM_COUNT> MemoryAccounting::s_sampled {};
+    inline std::chrono::steady_clock::time_point MemoryAccounting::s_sampleStart {};
+}
@@ -3,8 +3,13 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ranges>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "IconsFontAwesome5.h"
@@ -24,6 +29,11 @@ namespace Notify
 		std::chrono::steady_clock::time_point createdAt;
 		float durationSeconds;
 		bool isDismissing = false;
+		// Identical messages arriving while this one is shown are folded into it.
+		std::size_t repeatCount = 1;
+		// Progress toasts are updated in place by key and show a bar.
+		std::string progressKey;
+		std::optional<float> progress;
 
 		Toast(const std::string& generalMessage, Type generalType, float generalDurationSeconds = 3.0f)
 			: message(generalMessage),
@@ -32,19 +42,43 @@ namespace Notify
 			  durationSeconds(generalDurationSeconds) {}
 	};
 
+	// Toasts can be posted from any thread. Posting pushes onto a lock-free intrusive
+	// stack (one compare-and-swap); the UI thread takes the whole stack with a single
+	// exchange at the start of Render and folds it into the shown toasts in posting order.
 	class Manager
 	{
 	public:
+		// Shown at once; older toasts wait behind a "+N more" line.
+		static constexpr std::size_t MAX_VISIBLE_TOASTS = 5;
+		// Kept at all; beyond this the oldest are dropped.
+		static constexpr std::size_t MAX_TOASTS = 32;
+
 		static Manager& Instance() {
 			static Manager instance;
 			return instance;
 		}
 
+		Manager() = default;
+		Manager(const Manager&) = delete;
+		Manager& operator=(const Manager&) = delete;
+
+		~Manager() {
+			for(Message* message = pending.exchange(nullptr, std::memory_order_acquire); message;) {
+				delete std::exchange(message, message->next);
+			}
+		}
+
 		void AddToast(const std::string& generalMessage, Type generalType, float generalDurationSeconds = 3.0f) {
-			toasts.emplace_back(generalMessage, generalType, generalDurationSeconds);
+			Post(new Message {nullptr, generalMessage, generalType, generalDurationSeconds});
+		}
+
+		// Creates or updates the progress toast of `key`. A fraction of 1 or more completes it.
+		void SetProgress(const std::string& key, const std::string& generalMessage, const float fraction) {
+			Post(new Message {nullptr, generalMessage, Type::Info, PROGRESS_LINGER_SECONDS, key, fraction});
 		}
 
 		void Render() {
+			Drain();
 			const auto now = std::chrono::steady_clock::now();
 
 			// Remove expired toasts
@@ -56,6 +90,7 @@ namespace Notify
 				toasts.end());
 
 			if(toasts.empty()) return;
+			const std::size_t hiddenCount = toasts.size() > MAX_VISIBLE_TOASTS ? toasts.size() - MAX_VISIBLE_TOASTS : 0;
 
 			const float padding = 10.0f;
 			const ImGuiViewport* mainViewport = ImGui::GetMainViewport();
@@ -70,7 +105,8 @@ namespace Notify
 							ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration |
 								ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
 								ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav)) {
-				for(auto& toast: toasts) {
+				if(hiddenCount > 0) ImGui::TextDisabled("+%zu more", hiddenCount);
+				for(auto& toast: toasts | std::views::drop(hiddenCount)) {
 					const auto elapsedSeconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - toast.createdAt).count() / 1000.0f;
 					float alpha = 1.0f;
 
@@ -104,13 +140,17 @@ namespace Notify
 					ImGui::PushStyleColor(ImGuiCol_Border, toastColor);
 					ImGui::PushStyleVar(ImGuiStyleVar_FrameBorderSize, 2.0f);
 
-					if(ImGui::BeginChild(("toast_" + std::to_string(reinterpret_cast<uintptr_t>(&toast))).c_str(),
-										 ImVec2(0, 0), ImGuiChildFlags_Border | ImGuiChildFlags_AutoResizeX | ImGuiChildFlags_AutoResizeY)) {
+					// Scoped by the toast's address rather than a formatted name, which would allocate.
+					ImGui::PushID(&toast);
+					if(ImGui::BeginChild("toast", ImVec2(0, 0), ImGuiChildFlags_Border | ImGuiChildFlags_AutoResizeX | ImGuiChildFlags_AutoResizeY)) {
 						ImGui::PushStyleColor(ImGuiCol_Text, toastColor);
-						ImGui::Text("%s %s", toastIcon, toast.message.c_str());
+						if(toast.repeatCount > 1) ImGui::Text("%s %s (x%zu)", toastIcon, toast.message.c_str(), toast.repeatCount);
+						else ImGui::Text("%s %s", toastIcon, toast.message.c_str());
 						ImGui::PopStyleColor();
+						if(toast.progress) ImGui::ProgressBar(std::clamp(*toast.progress, 0.0f, 1.0f), ImVec2(200.0f, 0.0f));
 					}
 					ImGui::EndChild();
+					ImGui::PopID();
 
 					ImGui::PopStyleVar(1);
 					ImGui::PopStyleColor();
@@ -121,6 +161,66 @@ namespace Notify
 		}
 
 	private:
+		struct Message {
+			Message* next = nullptr;
+			std::string message;
+			Type type = Type::Info;
+			float durationSeconds = 3.0f;
+			std::string progressKey;
+			std::optional<float> progress;
+		};
+
+		// Progress toasts stay up while updates keep coming and this long after the last one.
+		static constexpr float PROGRESS_LINGER_SECONDS = 2.0f;
+
+		void Post(Message* message) {
+			message->next = pending.load(std::memory_order_relaxed);
+			while(!pending.compare_exchange_weak(message->next, message, std::memory_order_release, std::memory_order_relaxed)) {}
+		}
+
+		void Drain() {
+			// The stack comes out newest first; reversing it restores posting order.
+			Message* ordered = nullptr;
+			for(Message* message = pending.exchange(nullptr, std::memory_order_acquire); message;) {
+				Message* next = message->next;
+				message->next = ordered;
+				ordered = message;
+				message = next;
+			}
+
+			for(Message* message = ordered; message;) {
+				Apply(*message);
+				delete std::exchange(message, message->next);
+			}
+
+			if(toasts.size() > MAX_TOASTS) toasts.erase(toasts.begin(), toasts.end() - MAX_TOASTS);
+		}
+
+		void Apply(Message& message) {
+			const auto now = std::chrono::steady_clock::now();
+			const auto existing = std::ranges::find_if(toasts, [&message](const Toast& toast) {
+				if(!message.progressKey.empty()) return toast.progressKey == message.progressKey;
+				return toast.progressKey.empty() && toast.type == message.type && toast.message == message.message;
+			});
+
+			if(existing == toasts.end()) {
+				auto& toast = toasts.emplace_back(message.message, message.type, message.durationSeconds);
+				toast.progressKey = std::move(message.progressKey);
+				toast.progress = message.progress;
+				return;
+			}
+
+			// A repeat restarts the timer of the toast it merges into.
+			existing->createdAt = now;
+			if(message.progressKey.empty()) {
+				++existing->repeatCount;
+			} else {
+				existing->message = std::move(message.message);
+				existing->progress = message.progress;
+			}
+		}
+
+		std::atomic<Message*> pending = nullptr;
 		std::vector<Toast> toasts;
 	};
 
@@ -140,6 +240,10 @@ namespace Notify
 		Manager::Instance().AddToast(generalMessage, Type::Error, generalDurationSeconds);
 	}
 
+	inline void Progress(const std::string& key, const std::string& generalMessage, float fraction) {
+		Manager::Instance().SetProgress(key, generalMessage, fraction);
+	}
+
 	inline void Render() {
 		Manager::Instance().Render();
 	}
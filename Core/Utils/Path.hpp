@@ -16,4 +16,18 @@ namespace Utils {
         return std::filesystem::path(PROJECT_SOURCE_DIR) / "Workspace";
 #endif
     }
+
+    // Derived data such as document previews; safe to delete at any time.
+    inline std::filesystem::path GetCachePath() {
+        return GetWorkspacePath() / ".cache";
+    }
+
+    // Documents are stored as XML unless they carry a .json extension.
+    inline bool IsJsonDocument(const std::filesystem::path& path) {
+        return path.extension() == ".json";
+    }
+
+    inline bool IsDiagramDocument(const std::filesystem::path& path) {
+        return path.extension() == ".xml" || IsJsonDocument(path);
+    }
 }
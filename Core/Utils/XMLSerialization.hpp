@@ -2,27 +2,23 @@
 #include <pugixml.hpp>
 #include <boost/pfr.hpp>
 #include <magic_enum/magic_enum.hpp>
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <type_traits>
 #include <string_view>
+#include <utility>
 #include <glm/glm.hpp>
 
 namespace XML::detail {
     template<class T>
     struct component_policy {
-        static std::string name(std::size_t i) { return "c" + std::to_string(i); }
+        static constexpr std::array<std::string_view, 4> names{"c0", "c1", "c2", "c3"};
     };
 
     template<int L, typename T, glm::qualifier Q>
     struct component_policy<glm::vec<L, T, Q>> {
-        static std::string name(std::size_t i) {
-            switch (i) {
-                case 0: return "x";
-                case 1: return "y";
-                case 2: return "z";
-                case 3: return "w";
-                default: return "c" + std::to_string(i);
-            }
-        }
+        static constexpr std::array<std::string_view, 4> names{"x", "y", "z", "w"};
     };
 
     template<class T>
@@ -42,11 +38,81 @@ namespace XML::detail {
         std::is_arithmetic_v<T> ||
         std::is_same_v<T, std::string> ||
         std::is_enum_v<T>;
+
+    // Component names are tiny (at most four one- or two-letter entries), so a linear scan beats any table.
+    template<class T>
+    constexpr std::size_t component_index(std::string_view name) noexcept {
+        constexpr std::size_t N = comp_count<T>();
+        for (std::size_t i = 0; i < N; ++i) {
+            if (component_policy<T>::names[i] == name) return i;
+        }
+        return N;
+    }
+
+    constexpr std::uint32_t hash_name(std::string_view name, std::uint32_t seed) noexcept {
+        std::uint32_t h = 2166136261u ^ seed;
+        for (const char c : name) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // Searches for a seed under which every field name of T lands in its own slot,
+    // so a lookup is one hash, one table read and one string compare.
+    template<std::size_t Slots, std::size_t N>
+    consteval std::uint32_t find_perfect_seed(const std::array<std::string_view, N>& names) {
+        for (std::uint32_t seed = 0; seed < (1u << 16); ++seed) {
+            std::array<bool, Slots> used{};
+            bool collision = false;
+            for (const auto name : names) {
+                const auto slot = hash_name(name, seed) & (Slots - 1);
+                if (used[slot]) { collision = true; break; }
+                used[slot] = true;
+            }
+            if (!collision) return seed;
+        }
+        return UINT32_MAX;
+    }
+
+    template<std::size_t Slots, std::size_t N>
+    consteval std::array<std::uint8_t, Slots> make_slot_table(const std::array<std::string_view, N>& names, std::uint32_t seed) {
+        std::array<std::uint8_t, Slots> slots{};
+        for (std::size_t i = 0; i < N; ++i) {
+            slots[hash_name(names[i], seed) & (Slots - 1)] = static_cast<std::uint8_t>(i + 1);
+        }
+        return slots;
+    }
+
+    template<class T>
+    struct field_table {
+        static constexpr auto names = boost::pfr::names_as_array<T>();
+        static constexpr std::size_t count = names.size();
+        static constexpr std::size_t slot_count = std::bit_ceil(count * 2 + 1);
+        static constexpr std::uint32_t seed = find_perfect_seed<slot_count>(names);
+        static constexpr auto slots = make_slot_table<slot_count>(names, seed);
+
+        static_assert(count < UINT8_MAX, "XML codec supports at most 254 fields per struct");
+        static_assert(seed != UINT32_MAX, "No perfect hash seed found for field names");
+
+        // Returns `count` when the name is not a field of T.
+        static constexpr std::size_t find(std::string_view name) noexcept {
+            const std::uint8_t entry = slots[hash_name(name, seed) & (slot_count - 1)];
+            if (entry == 0 || names[entry - 1] != name) return count;
+            return entry - 1;
+        }
+    };
 }
 
 namespace XML {
     using namespace detail;
 
+    template<typename T>
+    void auto_serialize(const T& obj, pugi::xml_node& node);
+
+    template<typename T>
+    void auto_deserialize(T& obj, const pugi::xml_node& node);
+
     template<class T>
     void serialize_field(pugi::xml_node& parent, std::string_view name, const T& field) {
         auto node = parent.append_child(name.data());
@@ -59,8 +125,9 @@ namespace XML {
             node.text().set(field.c_str());
         } else if constexpr (Indexable<T>) {
             constexpr std::size_t N = comp_count<T>();
+            static_assert(N <= component_policy<T>::names.size());
             for (std::size_t i = 0; i < N; ++i) {
-                node.append_attribute(component_policy<T>::name(i).c_str()).set_value(field[i]);
+                node.append_attribute(component_policy<T>::names[i].data()).set_value(field[i]);
             }
         } else {
             auto_serialize(field, node);
@@ -68,10 +135,7 @@ namespace XML {
     }
 
     template<class T>
-    void deserialize_field(const pugi::xml_node& parent, std::string_view name, T& field) {
-        auto node = parent.child(name.data());
-        if (!node) return;
-
+    void deserialize_value(const pugi::xml_node& node, T& field) {
         if constexpr (std::is_enum_v<T>) {
             if (auto v = magic_enum::enum_cast<T>(node.text().as_string())) field = *v;
         } else if constexpr (std::is_same_v<T, bool>) {
@@ -84,30 +148,61 @@ namespace XML {
             field = node.text().as_string();
         } else if constexpr (Indexable<T>) {
             constexpr std::size_t N = comp_count<T>();
-            for (std::size_t i = 0; i < N; ++i) {
-                if (auto attr = node.attribute(component_policy<T>::name(i).c_str())) {
-                    field[i] = static_cast<std::remove_reference_t<decltype(field[i])>>(attr.as_double());
-                }
+            std::array<bool, N> seen{};
+            for (auto attr = node.first_attribute(); attr; attr = attr.next_attribute()) {
+                const std::size_t i = component_index<T>(attr.name());
+                if (i == N || seen[i]) continue;
+                seen[i] = true;
+                field[i] = static_cast<std::remove_reference_t<decltype(field[i])>>(attr.as_double());
             }
         } else {
             auto_deserialize(field, node);
         }
     }
 
+    template<class T>
+    void deserialize_field(const pugi::xml_node& parent, std::string_view name, T& field) {
+        if (auto node = parent.child(name.data())) deserialize_value(node, field);
+    }
+
+    namespace detail {
+        template<class T, std::size_t I>
+        void deserialize_member(T& obj, const pugi::xml_node& node) {
+            deserialize_value(node, boost::pfr::get<I>(obj));
+        }
+
+        template<class T, std::size_t... I>
+        constexpr auto make_member_dispatch(std::index_sequence<I...>) {
+            return std::array<void (*)(T&, const pugi::xml_node&), sizeof...(I)>{&deserialize_member<T, I>...};
+        }
+
+        template<class T>
+        inline constexpr auto member_dispatch = make_member_dispatch<T>(std::make_index_sequence<field_table<T>::count>{});
+    }
+
     template<typename T>
     void auto_serialize(const T& obj, pugi::xml_node& node) {
         boost::pfr::for_each_field(obj, [&]<typename F>(const F& f, std::size_t i) {
-            constexpr auto names = boost::pfr::names_as_array<T>();
-            serialize_field(node, names[i], f);
+            serialize_field(node, field_table<T>::names[i], f);
         });
     }
 
+    // Walks the children once and routes each element to its field through the
+    // perfect hash; the first occurrence of a name wins, as with `child(name)`.
     template<typename T>
     void auto_deserialize(T& obj, const pugi::xml_node& node) {
-        boost::pfr::for_each_field(obj, [&]<typename F>(F& f, std::size_t i) {
-            constexpr auto names = boost::pfr::names_as_array<T>();
-            deserialize_field(node, names[i], f);
-        });
+        using table = field_table<T>;
+        std::array<bool, table::count> seen{};
+        std::size_t remaining = table::count;
+
+        for (auto child = node.first_child(); child && remaining > 0; child = child.next_sibling()) {
+            if (child.type() != pugi::node_element) continue;
+            const std::size_t i = table::find(child.name());
+            if (i == table::count || seen[i]) continue;
+            seen[i] = true;
+            --remaining;
+            member_dispatch<T>[i](obj, child);
+        }
     }
 
     template<typename T>
@@ -1,16 +1,49 @@
 #include "Main/Application.hpp"
+#include "Utils/MemoryAccounting.hpp"
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <pugixml.hpp>
 #include <stdexcept>
+#include <string_view>
 
-int main() noexcept {
+int main(int argc, char* argv[]) noexcept {
     enum class ExitCode : int {
         Success = 0,
         Error = -1,
         UnknownError = -2
     };
 
+    // Before anything parses, so every pugixml document is charged to serialization.
+    pugi::set_memory_management_functions(
+        [](const size_t size) { return Utils::MemoryAccounting::AllocateWithHeader(Utils::MemoryAccounting::Subsystem::Serialization, size); },
+        [](void* pointer) { Utils::MemoryAccounting::DeallocateWithHeader(Utils::MemoryAccounting::Subsystem::Serialization, pointer); });
+
+    Application::Options options {};
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        constexpr std::string_view ALLOCATION_CHECK = "--allocation-check";
+        if (argument == "--startup-report") {
+            options.isStartupReport = true;
+        } else if (argument.starts_with(ALLOCATION_CHECK)) {
+            // --allocation-check[=budget], allocations per frame.
+            std::uint64_t budget = Application::Options::DEFAULT_ALLOCATION_BUDGET;
+            const std::string_view value = argument.substr(ALLOCATION_CHECK.size());
+            if (!value.empty()) {
+                const auto [end, error] = std::from_chars(value.data() + 1, value.data() + value.size(), budget);
+                if (value.front() != '=' || error != std::errc() || end != value.data() + value.size()) {
+                    std::cerr << "Invalid allocation budget: " << argument << '\n';
+                    return static_cast<int>(ExitCode::Error);
+                }
+            }
+            options.allocationBudget = budget;
+        } else {
+            std::cerr << "Ignoring unknown option: " << argument << '\n';
+        }
+    }
+
     try {
-        Application app;
+        Application app(options);
         app.Run();
         return static_cast<int>(ExitCode::Success);
     } catch (const std::exception& e) {